@@ -0,0 +1,66 @@
+#!/usr/bin/env bash
+# Stress run for very large grids on Linux.
+# Generates a grid of several hundred million tiles headless and checks that
+# line counts, last indices and file sizes past 4 GB survive 64-bit offsets.
+#
+# Usage: Scripts/HexGridStress.sh [GridRange] [NeighborRange]
+# UE_ROOT must point at an engine install containing Engine/Binaries/Linux/UnrealEditor-Cmd.
+
+set -euo pipefail
+
+GRID_RANGE="${1:-12000}"
+NEIGHBOR_RANGE="${2:-1}"
+UE_ROOT="${UE_ROOT:?UE_ROOT is not set}"
+
+PROJECT_DIR="$(cd "$(dirname "$0")/.." && pwd)"
+PROJECT="${PROJECT_DIR}/CreateGridData.uproject"
+DATA_DIR="${PROJECT_DIR}/Data"
+EDITOR="${UE_ROOT}/Engine/Binaries/Linux/UnrealEditor-Cmd"
+
+TILE_COUNT=$(( 1 + 3 * GRID_RANGE * (GRID_RANGE + 1) ))
+FOUR_GB=$(( 4 * 1024 * 1024 * 1024 ))
+
+echo "GridRange ${GRID_RANGE}, NeighborRange ${NEIGHBOR_RANGE}, ${TILE_COUNT} tiles."
+rm -f "${DATA_DIR}"/*.data
+
+START=$(date +%s)
+"${EDITOR}" "${PROJECT}" /Game/EmptyLevel -game -nullrhi -unattended -nosound -stdout \
+	-GridRange="${GRID_RANGE}" -NeighborRange="${NEIGHBOR_RANGE}" \
+	-LowMemoryMode -FrameBudgetMs=250 -ExitWhenDone
+END=$(date +%s)
+echo "Generated in $(( END - START )) s."
+
+FAILED=0
+
+check_lines() {
+	local File="$1"
+	local Lines
+	Lines=$(wc -l < "${File}")
+	if [ "${Lines}" -ne "${TILE_COUNT}" ]; then
+		echo "FAIL ${File}: ${Lines} lines, expected ${TILE_COUNT}."
+		FAILED=1
+	else
+		echo "OK   ${File}: ${Lines} lines, $(stat -c %s "${File}") bytes."
+	fi
+}
+
+check_lines "${DATA_DIR}/Tiles.data"
+check_lines "${DATA_DIR}/TileIndices.data"
+for (( Radius = 1; Radius <= NEIGHBOR_RANGE; Radius++ ))
+do
+	check_lines "${DATA_DIR}/N${Radius}.data"
+done
+
+LAST_INDEX=$(tail -n 1 "${DATA_DIR}/TileIndices.data" | cut -d '|' -f 2)
+if [ "${LAST_INDEX}" -ne "$(( TILE_COUNT - 1 ))" ]; then
+	echo "FAIL last tile index ${LAST_INDEX}, expected $(( TILE_COUNT - 1 ))."
+	FAILED=1
+fi
+
+LARGEST=$(stat -c %s "${DATA_DIR}"/*.data | sort -n | tail -n 1)
+if [ "${LARGEST}" -le "${FOUR_GB}" ]; then
+	echo "FAIL largest output is ${LARGEST} bytes, the run did not pass 4 GB."
+	FAILED=1
+fi
+
+exit "${FAILED}"
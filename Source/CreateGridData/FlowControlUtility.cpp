@@ -27,21 +27,104 @@ void FlowControlUtility::InitLoopData(FStructLoopData& InOut_Data)
 	InOut_Data.Count = 0;
 }
 
-void FlowControlUtility::SaveLoopData(AActor* Owner, FStructLoopData& InOut_Data, int32 Count, const TArray<int32>& Indices,
-	const FTimerDynamicDelegate TimerDelegate, bool& Out_Success)
+Enum_LoopResult FlowControlUtility::RunNestedLoop(AActor* Owner, FStructLoopData& InOut_Data, int32 Depth,
+	FLoopBoundsFunc Bounds, FLoopBodyFunc Body, const FTimerDynamicDelegate& TimerDelegate)
 {
-	if (Count > InOut_Data.LoopCountLimit) {
-		for (int32 i = 0; i < Indices.Num() && i < InOut_Data.LoopDepthLimit; i++)
-		{
-			InOut_Data.IndexSaved[i] = Indices[i];
+	TArray<int64>& Indices = InOut_Data.IndexSaved;
+	bool Valid = true;
+	if (!InOut_Data.IsInitialized) {
+		InOut_Data.IsInitialized = true;
+		InOut_Data.Count = 0;
+		if (Indices.Num() < Depth) {
+			Indices.SetNumZeroed(Depth);
 		}
-		FTimerHandle TimerHandle;
-		Owner->GetWorldTimerManager().SetTimer(TimerHandle, TimerDelegate, InOut_Data.Rate, false);
-		Out_Success = true;
+		Valid = StepLoopIndices(Indices, Depth, 0, true, Bounds);
 	}
-	else {
+
+	double EndTime = FPlatformTime::Seconds() + InOut_Data.FrameBudgetMs * 0.001;
+	int32 Count = 0;
+	while (Valid)
+	{
+		if (!Body(Indices)) {
+			return Enum_LoopResult::Aborted;
+		}
 		InOut_Data.Count++;
-		Out_Success = false;
+		Valid = StepLoopIndices(Indices, Depth, Depth - 1, false, Bounds);
+
+		if (Valid && ++Count >= LOOP_TIME_CHECK_INTERVAL) {
+			Count = 0;
+			if (FPlatformTime::Seconds() >= EndTime) {
+				Owner->GetWorldTimerManager().SetTimerForNextTick(TimerDelegate);
+				return Enum_LoopResult::Yielded;
+			}
+		}
+	}
+	return Enum_LoopResult::Finished;
+}
+
+bool FlowControlUtility::StepLoopIndices(TArray<int64>& InOut_Indices, int32 Depth, int32 Level, bool Reset, FLoopBoundsFunc Bounds)
+{
+	//Odometer step: increase (or reset) Level, carry into outer levels when a range is exhausted
+	while (true)
+	{
+		FInt64Point Range = Bounds(Level, InOut_Indices);
+		if (Reset) {
+			InOut_Indices[Level] = Range.X;
+		}
+		else {
+			InOut_Indices[Level]++;
+		}
+
+		if (InOut_Indices[Level] <= Range.Y) {
+			if (Level == Depth - 1) {
+				return true;
+			}
+			Level++;
+			Reset = true;
+		}
+		else {
+			if (Level == 0) {
+				return false;
+			}
+			Level--;
+			Reset = false;
+		}
+	}
+}
 
+void FlowControlUtility::LoopDataToString(const FStructLoopData& Data, FString& Out_Str)
+{
+	Out_Str = FString::FromInt(Data.IsInitialized ? 1 : 0);
+	Out_Str.Append(TEXT("|")).Append(FString::Printf(TEXT("%lld"), Data.Count)).Append(TEXT("|"));
+	for (int32 i = 0; i < Data.IndexSaved.Num(); i++)
+	{
+		Out_Str.Append(FString::Printf(TEXT("%lld"), Data.IndexSaved[i]));
+		if (i != Data.IndexSaved.Num() - 1) {
+			Out_Str.Append(TEXT(","));
+		}
 	}
-}
\ No newline at end of file
+}
+
+bool FlowControlUtility::LoopDataFromString(const FString& Str, FStructLoopData& Out_Data)
+{
+	TArray<FString> Parts;
+	Str.ParseIntoArray(Parts, TEXT("|"), false);
+	if (Parts.Num() != 3) {
+		return false;
+	}
+
+	TArray<FString> IndexStrs;
+	Parts[2].ParseIntoArray(IndexStrs, TEXT(","), true);
+	if (IndexStrs.Num() == 0) {
+		return false;
+	}
+
+	Out_Data.IsInitialized = FCString::Atoi(*Parts[0]) != 0;
+	Out_Data.Count = FCString::Atoi64(*Parts[1]);
+	Out_Data.IndexSaved.Empty();
+	for (const FString& IndexStr : IndexStrs)
+	{
+		Out_Data.IndexSaved.Add(FCString::Atoi64(*IndexStr));
+	}
+	return true;
+}
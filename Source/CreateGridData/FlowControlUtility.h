@@ -4,6 +4,21 @@
 
 #include "CoreMinimal.h"
 
+//Check the frame budget once every N loop bodies, reading the clock is not free for tiny bodies
+#define LOOP_TIME_CHECK_INTERVAL	32
+
+enum class Enum_LoopResult : uint8
+{
+	Finished,
+	Yielded,
+	Aborted
+};
+
+//Returns the inclusive [First, Last] range of loop level Depth, outer indices are already set
+typedef TFunctionRef<FInt64Point(int32 Depth, const TArray<int64>& Indices)> FLoopBoundsFunc;
+//Loop body, return false to abort the loop
+typedef TFunctionRef<bool(const TArray<int64>& Indices)> FLoopBodyFunc;
+
 /**
  * 
  */
@@ -14,6 +29,19 @@ public:
 	~FlowControlUtility();
 
 	static void InitLoopData(struct FStructLoopData& InOut_Data);
-	static void SaveLoopData(AActor* Owner, struct FStructLoopData& InOut_Data, int32 Count, const TArray<int32>& Indices,
-		const FTimerDynamicDelegate TimerDelegate, bool& Out_Success);
+
+	/**
+	 * Runs a nested loop of Depth levels until it is finished or the frame budget of InOut_Data is spent.
+	 * The indices live in InOut_Data.IndexSaved, a yielded loop resumes from them on the next call,
+	 * TimerDelegate is scheduled for the next tick when the loop yields.
+	 */
+	static Enum_LoopResult RunNestedLoop(AActor* Owner, struct FStructLoopData& InOut_Data, int32 Depth,
+		FLoopBoundsFunc Bounds, FLoopBodyFunc Body, const FTimerDynamicDelegate& TimerDelegate);
+
+	//Checkpoint serialization, format: IsInitialized|Count|Index0,Index1,...
+	static void LoopDataToString(const struct FStructLoopData& Data, FString& Out_Str);
+	static bool LoopDataFromString(const FString& Str, struct FStructLoopData& Out_Data);
+
+private:
+	static bool StepLoopIndices(TArray<int64>& InOut_Indices, int32 Depth, int32 Level, bool Reset, FLoopBoundsFunc Bounds);
 };
@@ -0,0 +1,330 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GridBinaryUtility.h"
+#include "GridDataLoader.h"
+#include "HexMappedFile.h"
+#include "HexMath.h"
+#include <Async/ParallelFor.h>
+
+#include <atomic>
+
+DEFINE_LOG_CATEGORY(HexBinary);
+
+GridBinaryUtility::GridBinaryUtility()
+{
+}
+
+GridBinaryUtility::~GridBinaryUtility()
+{
+}
+
+bool GridBinaryUtility::WriteTiles(const FString& FullPath, int32 Range, float TileSize, const TArray64<FIntPoint>* Tiles)
+{
+	const int64 TileCount = Tiles != nullptr ? Tiles->Num() : HexMath::GetTileCount(Range);
+	FHexMappedFile File;
+	if (!File.Open(FullPath, GetTilesFileBytes(TileCount))) {
+		return false;
+	}
+	FillTiles(File.GetData(), Range, TileSize, Tiles);
+	return File.Commit();
+}
+
+bool GridBinaryUtility::WriteNeighbors(const FString& FullPath, int32 Range, int32 Radius, const TArray64<FIntPoint>* Tiles,
+	const TArray64<uint32>* SpiralTiles)
+{
+	const int64 TileCount = Tiles != nullptr ? Tiles->Num() : HexMath::GetTileCount(Range);
+	if (!CanWriteNeighbors(TileCount, Radius)) {
+		return false;
+	}
+	FHexMappedFile File;
+	if (!File.Open(FullPath, GetNeighborsFileBytes(TileCount, Radius))) {
+		return false;
+	}
+	FillNeighbors(File.GetData(), Range, Radius, Tiles, SpiralTiles);
+	return File.Commit();
+}
+
+int64 GridBinaryUtility::GetTilesFileBytes(int64 TileCount)
+{
+	return HeaderBytes + TileCount * 16;
+}
+
+int64 GridBinaryUtility::GetNeighborsFileBytes(int64 TileCount, int32 Radius)
+{
+	return HeaderBytes + TileCount * 6 * Radius * (int64)sizeof(uint32);
+}
+
+int64 GridBinaryUtility::GetTileIndicesFileBytes(int32 Range)
+{
+	return HeaderBytes + HexMath::GetTileCount(Range) * (int64)sizeof(uint32);
+}
+
+void GridBinaryUtility::FillTiles(uint8* Out_Data, int32 Range, float TileSize, const TArray64<FIntPoint>* Tiles)
+{
+	const int64 TileCount = Tiles != nullptr ? Tiles->Num() : HexMath::GetTileCount(Range);
+	WriteHeader(Out_Data, BINARY_TILES_MAGIC, Range, 0, TileCount);
+
+	//Every chunk owns the records of its tiles, nothing is ordered or buffered between chunks
+	uint8* Records = Out_Data + HeaderBytes;
+	int32 ChunkCount = (int32)((TileCount + BINARY_CHUNK_SIZE - 1) / BINARY_CHUNK_SIZE);
+	ParallelFor(ChunkCount, [Records, Tiles, TileSize, TileCount](int32 ChunkIndex) {
+		int64 End = FMath::Min((int64)(ChunkIndex + 1) * BINARY_CHUNK_SIZE, TileCount);
+		for (int64 i = (int64)ChunkIndex * BINARY_CHUNK_SIZE; i < End; i++)
+		{
+			FIntPoint Hex = Tiles != nullptr ? (*Tiles)[i] : HexMath::SpiralIndexToAxial(i).ToIntPoint();
+			//Narrowed to float like the text output
+			FVector2D Center = HexMath::AxialToPosition(Hex, TileSize);
+			float Position[2] = { (float)Center.X, (float)Center.Y };
+			int32 Axial[2] = { Hex.X, Hex.Y };
+			uint8* Record = Records + i * 16;
+			FMemory::Memcpy(Record, Axial, sizeof(Axial));
+			FMemory::Memcpy(Record + sizeof(Axial), Position, sizeof(Position));
+		}
+	});
+}
+
+void GridBinaryUtility::FillNeighbors(uint8* Out_Data, int32 Range, int32 Radius, const TArray64<FIntPoint>* Tiles,
+	const TArray64<uint32>* SpiralTiles)
+{
+	const int64 TileCount = Tiles != nullptr ? Tiles->Num() : HexMath::GetTileCount(Range);
+	WriteHeader(Out_Data, BINARY_NEIGHBORS_MAGIC, Range, Radius, TileCount);
+
+	uint32* Records = reinterpret_cast<uint32*>(Out_Data + HeaderBytes);
+	const int64 Width = 6 * (int64)Radius;
+	int32 ChunkCount = (int32)((TileCount + BINARY_CHUNK_SIZE - 1) / BINARY_CHUNK_SIZE);
+	ParallelFor(ChunkCount, [Records, Tiles, SpiralTiles, Range, Radius, Width, TileCount](int32 ChunkIndex) {
+		int64 End = FMath::Min((int64)(ChunkIndex + 1) * BINARY_CHUNK_SIZE, TileCount);
+		for (int64 i = (int64)ChunkIndex * BINARY_CHUNK_SIZE; i < End; i++)
+		{
+			HexMath::FAxial Hex = Tiles != nullptr ? HexMath::FAxial((*Tiles)[i]) : HexMath::SpiralIndexToAxial(i);
+			uint32* Record = Records + i * Width;
+			for (const HexMath::FAxial& Neighbor : HexMath::Ring(Hex, Radius))
+			{
+				//An unmasked grid lists the hexes beyond its range like WriteNeighborLine, a masked grid leaves them out
+				uint32 Tile = Tiles != nullptr ? BINARY_NONE : BINARY_OUTSIDE;
+				if (HexMath::Length(Neighbor) <= Range) {
+					int64 Spiral = HexMath::AxialToSpiralIndex(Neighbor);
+					Tile = SpiralTiles != nullptr ? (*SpiralTiles)[Spiral] : (uint32)Spiral;
+				}
+				*Record++ = Tile;
+			}
+		}
+	});
+}
+
+void GridBinaryUtility::FillTileIndices(uint8* Out_Data, int32 Range, const TArray64<uint32>* SpiralTiles)
+{
+	const int64 HexCount = HexMath::GetTileCount(Range);
+	WriteHeader(Out_Data, BINARY_TILE_INDICES_MAGIC, Range, 0, HexCount);
+	uint32* Records = reinterpret_cast<uint32*>(Out_Data + HeaderBytes);
+	if (SpiralTiles != nullptr) {
+		FMemory::Memcpy(Records, SpiralTiles->GetData(), HexCount * sizeof(uint32));
+		return;
+	}
+	//The full hexagon numbers its tiles in spiral order
+	for (int64 i = 0; i < HexCount; i++)
+	{
+		Records[i] = (uint32)i;
+	}
+}
+
+bool GridBinaryUtility::BuildPayload(int32 Range, float TileSize, int32 NeighborRange, const TArray64<FIntPoint>* Tiles,
+	const TArray64<uint32>* SpiralTiles, TArray64<uint8>& Out_Payload, TArray<FStructHexGridBulkSection>& Out_Sections)
+{
+	const int64 TileCount = Tiles != nullptr ? Tiles->Num() : HexMath::GetTileCount(Range);
+	if (!CanWriteNeighbors(TileCount, FMath::Max(NeighborRange, 1))) {
+		return false;
+	}
+
+	//Offsets first, so the sections fill one allocation side by side
+	auto AddSection = [&Out_Sections](const TCHAR* Name, int64 Bytes) {
+		int64 Offset = Out_Sections.Num() > 0 ? Align(Out_Sections.Last().Offset + Out_Sections.Last().Bytes, BINARY_SECTION_ALIGNMENT) : 0;
+		FStructHexGridBulkSection& Section = Out_Sections.AddDefaulted_GetRef();
+		Section.Name = FName(Name);
+		Section.Offset = Offset;
+		Section.Bytes = Bytes;
+	};
+	Out_Sections.Reset();
+	AddSection(TEXT("Tiles"), GetTilesFileBytes(TileCount));
+	AddSection(TEXT("TileIndices"), GetTileIndicesFileBytes(Range));
+	for (int32 Radius = 1; Radius <= NeighborRange; Radius++)
+	{
+		AddSection(*FString::Printf(TEXT("N%d"), Radius), GetNeighborsFileBytes(TileCount, Radius));
+	}
+	Out_Payload.SetNumZeroed(Align(Out_Sections.Last().Offset + Out_Sections.Last().Bytes, BINARY_SECTION_ALIGNMENT));
+
+	uint8* Data = Out_Payload.GetData();
+	FillTiles(Data + Out_Sections[0].Offset, Range, TileSize, Tiles);
+	FillTileIndices(Data + Out_Sections[1].Offset, Range, SpiralTiles);
+	for (int32 Radius = 1; Radius <= NeighborRange; Radius++)
+	{
+		FillNeighbors(Data + Out_Sections[Radius + 1].Offset, Range, Radius, Tiles, SpiralTiles);
+	}
+	return true;
+}
+
+int64 GridBinaryUtility::GetPayloadBytes(int64 TileCount, int32 Range, int32 NeighborRange)
+{
+	int64 Bytes = Align(GetTilesFileBytes(TileCount), BINARY_SECTION_ALIGNMENT) + Align(GetTileIndicesFileBytes(Range), BINARY_SECTION_ALIGNMENT);
+	for (int32 Radius = 1; Radius <= NeighborRange; Radius++)
+	{
+		Bytes += Align(GetNeighborsFileBytes(TileCount, Radius), BINARY_SECTION_ALIGNMENT);
+	}
+	return Bytes;
+}
+
+bool GridBinaryUtility::ReadTiles(const uint8* Data, int64 Bytes, FStructHexTilesTable& Out_Table)
+{
+	Out_Table = FStructHexTilesTable();
+	int32 Range, Radius;
+	int64 TileCount;
+	if (!ReadHeader(Data, Bytes, BINARY_TILES_MAGIC, Range, Radius, TileCount) || Bytes != GetTilesFileBytes(TileCount)) {
+		UE_LOG(HexBinary, Warning, TEXT("Binary tiles of %lld bytes are truncated or damaged."), Bytes);
+		return false;
+	}
+
+	Out_Table.AxialCoords.SetNumUninitialized(TileCount);
+	Out_Table.Positions.SetNumUninitialized(TileCount);
+	const uint8* Records = Data + HeaderBytes;
+	int32 ChunkCount = (int32)((TileCount + BINARY_CHUNK_SIZE - 1) / BINARY_CHUNK_SIZE);
+	ParallelFor(ChunkCount, [&Out_Table, Records, TileCount](int32 ChunkIndex) {
+		int64 End = FMath::Min((int64)(ChunkIndex + 1) * BINARY_CHUNK_SIZE, TileCount);
+		for (int64 i = (int64)ChunkIndex * BINARY_CHUNK_SIZE; i < End; i++)
+		{
+			int32 Axial[2];
+			float Position[2];
+			FMemory::Memcpy(Axial, Records + i * 16, sizeof(Axial));
+			FMemory::Memcpy(Position, Records + i * 16 + sizeof(Axial), sizeof(Position));
+			Out_Table.AxialCoords[i] = FIntPoint(Axial[0], Axial[1]);
+			Out_Table.Positions[i] = FVector2D(Position[0], Position[1]);
+		}
+	});
+	return true;
+}
+
+bool GridBinaryUtility::ReadTileIndices(const uint8* Data, int64 Bytes, FStructHexTileIndicesTable& Out_Table)
+{
+	Out_Table = FStructHexTileIndicesTable();
+	int32 Range, Radius;
+	int64 HexCount;
+	if (!ReadHeader(Data, Bytes, BINARY_TILE_INDICES_MAGIC, Range, Radius, HexCount) || HexCount != HexMath::GetTileCount(Range)
+		|| Bytes != GetTileIndicesFileBytes(Range)) {
+		UE_LOG(HexBinary, Warning, TEXT("Binary tile indices of %lld bytes are truncated or damaged."), Bytes);
+		return false;
+	}
+
+	//One entry per tile, in spiral order of the hexes
+	const uint32* Records = reinterpret_cast<const uint32*>(Data + HeaderBytes);
+	Out_Table.AxialCoords.Reserve(HexCount);
+	Out_Table.Indices.Reserve(HexCount);
+	for (int64 i = 0; i < HexCount; i++)
+	{
+		if (Records[i] != BINARY_NONE) {
+			Out_Table.AxialCoords.Add(HexMath::SpiralIndexToAxial(i).ToIntPoint());
+			Out_Table.Indices.Add(Records[i]);
+		}
+	}
+	return true;
+}
+
+bool GridBinaryUtility::ReadNeighbors(const uint8* Data, int64 Bytes, const TArray64<FIntPoint>& AxialCoords, FStructHexNeighborTable& Out_Table)
+{
+	Out_Table = FStructHexNeighborTable();
+	int32 Range, Radius;
+	int64 TileCount;
+	if (!ReadHeader(Data, Bytes, BINARY_NEIGHBORS_MAGIC, Range, Radius, TileCount) || Radius < 1 || TileCount != AxialCoords.Num()
+		|| Bytes != GetNeighborsFileBytes(TileCount, Radius)) {
+		UE_LOG(HexBinary, Warning, TEXT("Binary neighbors of %lld bytes are truncated, damaged or of another grid."), Bytes);
+		return false;
+	}
+
+	//Count the listed entries of every record, then fill the rows in place
+	const uint32* Records = reinterpret_cast<const uint32*>(Data + HeaderBytes);
+	const int64 Width = 6 * (int64)Radius;
+	TArray<FIntPoint> RingOffsets;
+	for (const HexMath::FAxial& Hex : HexMath::Ring(HexMath::FAxial(), Radius))
+	{
+		RingOffsets.Add(Hex.ToIntPoint());
+	}
+	int32 ChunkCount = (int32)((TileCount + BINARY_CHUNK_SIZE - 1) / BINARY_CHUNK_SIZE);
+	Out_Table.Offsets.SetNumUninitialized(TileCount + 1);
+	Out_Table.Offsets[0] = 0;
+	ParallelFor(ChunkCount, [&Out_Table, Records, Width, TileCount](int32 ChunkIndex) {
+		int64 End = FMath::Min((int64)(ChunkIndex + 1) * BINARY_CHUNK_SIZE, TileCount);
+		for (int64 i = (int64)ChunkIndex * BINARY_CHUNK_SIZE; i < End; i++)
+		{
+			int64 Count = 0;
+			for (int64 j = i * Width; j < (i + 1) * Width; j++)
+			{
+				Count += Records[j] != BINARY_NONE ? 1 : 0;
+			}
+			Out_Table.Offsets[i + 1] = Count;
+		}
+	});
+	for (int64 i = 0; i < TileCount; i++)
+	{
+		Out_Table.Offsets[i + 1] += Out_Table.Offsets[i];
+	}
+
+	std::atomic<bool> Valid{ true };
+	Out_Table.Tiles.SetNumUninitialized(Out_Table.Offsets[TileCount]);
+	ParallelFor(ChunkCount, [&Out_Table, &AxialCoords, &RingOffsets, &Valid, Records, Width, TileCount](int32 ChunkIndex) {
+		int64 End = FMath::Min((int64)(ChunkIndex + 1) * BINARY_CHUNK_SIZE, TileCount);
+		for (int64 i = (int64)ChunkIndex * BINARY_CHUNK_SIZE; i < End; i++)
+		{
+			int64 Next = Out_Table.Offsets[i];
+			const uint32* Record = Records + i * Width;
+			for (int32 j = 0; j < Width; j++)
+			{
+				if (Record[j] == BINARY_NONE) {
+					continue;
+				}
+				if (Record[j] == BINARY_OUTSIDE) {
+					Out_Table.Tiles[Next++] = AxialCoords[i] + RingOffsets[j];
+					continue;
+				}
+				if (Record[j] >= TileCount) {
+					Valid = false;
+					return;
+				}
+				Out_Table.Tiles[Next++] = AxialCoords[Record[j]];
+			}
+		}
+	});
+	if (!Valid) {
+		UE_LOG(HexBinary, Warning, TEXT("Binary neighbors of radius %d name tiles outside the grid."), Radius);
+		Out_Table = FStructHexNeighborTable();
+		return false;
+	}
+	return true;
+}
+
+void GridBinaryUtility::WriteHeader(uint8* Out_Data, uint32 Magic, int32 Range, int32 Radius, int64 TileCount)
+{
+	uint32 Header[4] = { Magic, BINARY_VERSION, (uint32)Range, (uint32)Radius };
+	FMemory::Memcpy(Out_Data, Header, sizeof(Header));
+	FMemory::Memcpy(Out_Data + sizeof(Header), &TileCount, sizeof(TileCount));
+}
+
+bool GridBinaryUtility::ReadHeader(const uint8* Data, int64 Bytes, uint32 Magic, int32& Out_Range, int32& Out_Radius, int64& Out_Count)
+{
+	if (Data == nullptr || Bytes < HeaderBytes) {
+		return false;
+	}
+	uint32 Header[4];
+	FMemory::Memcpy(Header, Data, sizeof(Header));
+	FMemory::Memcpy(&Out_Count, Data + sizeof(Header), sizeof(Out_Count));
+	Out_Range = (int32)Header[2];
+	Out_Radius = (int32)Header[3];
+	return Header[0] == Magic && Header[1] == BINARY_VERSION && Out_Range >= 0 && Out_Count >= 0;
+}
+
+bool GridBinaryUtility::CanWriteNeighbors(int64 TileCount, int32 Radius)
+{
+	if (Radius < 1 || TileCount >= BINARY_OUTSIDE) {
+		UE_LOG(HexBinary, Warning, TEXT("Radius %d or %lld tiles do not fit the binary neighbor format."), Radius, TileCount);
+		return false;
+	}
+	return true;
+}
@@ -0,0 +1,81 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "StructDefine.h"
+
+struct FStructHexTilesTable;
+struct FStructHexTileIndicesTable;
+struct FStructHexNeighborTable;
+
+DECLARE_LOG_CATEGORY_EXTERN(HexBinary, Log, All);
+
+//'HXBT'
+#define BINARY_TILES_MAGIC	0x54425848
+//'HXBN'
+#define BINARY_NEIGHBORS_MAGIC	0x4E425848
+//'HXBI'
+#define BINARY_TILE_INDICES_MAGIC	0x49425848
+#define BINARY_VERSION	2
+//Neighbor hex that is no tile of the grid and not listed, the masked out hexes of a masked grid
+#define BINARY_NONE	MAX_uint32
+//Neighbor hex beyond the grid range that the text of an unmasked grid still lists, its coord follows from the ring position
+#define BINARY_OUTSIDE	(MAX_uint32 - 1)
+//Tiles handed to one ParallelFor task
+#define BINARY_CHUNK_SIZE	(1 << 16)
+//Sections of a bulk payload start at multiples of this, so records read in place stay aligned
+#define BINARY_SECTION_ALIGNMENT	16
+
+/**
+ * Fixed width binary twins of Tiles.data and N{r}.data, written next to them as .bin.
+ * Every record has the same size, so the file size and the offset of every tile follow from the tile count,
+ * and ParallelFor writes chunks of tiles straight into their slice of an FHexMappedFile.
+ * Header: magic, version, grid range, radius (0 for tiles) as uint32, tile count as int64.
+ * Tiles record: q, r as int32, x, y as float.
+ * Neighbors record: 6 radius entries as uint32 in ring order, the tile index of the hex or BINARY_OUTSIDE or BINARY_NONE.
+ * Reading the entries back gives the lines of N{r}.data, masked or not.
+ * Tile indices record: tile index as uint32 of every hex within the grid range in spiral order, BINARY_NONE where the hex is no tile.
+ * The bulk payload of UHexGridDataAsset is the same files back to back, so one set of readers serves both.
+ */
+class CREATEGRIDDATA_API GridBinaryUtility
+{
+public:
+	GridBinaryUtility();
+	~GridBinaryUtility();
+
+	//Tiles lists the tiles of a masked grid in index order, null writes the full hexagon in spiral order
+	static bool WriteTiles(const FString& FullPath, int32 Range, float TileSize, const TArray64<FIntPoint>* Tiles);
+	//SpiralTiles maps the spiral index of every hex within Range to its tile index for a masked grid
+	static bool WriteNeighbors(const FString& FullPath, int32 Range, int32 Radius, const TArray64<FIntPoint>* Tiles,
+		const TArray64<uint32>* SpiralTiles);
+
+	static int64 GetTilesFileBytes(int64 TileCount);
+	static int64 GetNeighborsFileBytes(int64 TileCount, int32 Radius);
+	static int64 GetTileIndicesFileBytes(int32 Range);
+
+	//Header and records into Out_Data of the file size, shared by the .bin writers and BuildPayload
+	static void FillTiles(uint8* Out_Data, int32 Range, float TileSize, const TArray64<FIntPoint>* Tiles);
+	static void FillNeighbors(uint8* Out_Data, int32 Range, int32 Radius, const TArray64<FIntPoint>* Tiles,
+		const TArray64<uint32>* SpiralTiles);
+	static void FillTileIndices(uint8* Out_Data, int32 Range, const TArray64<uint32>* SpiralTiles);
+
+	//Tiles, TileIndices and N1 .. N{NeighborRange} back to back, every section aligned to BINARY_SECTION_ALIGNMENT
+	static bool BuildPayload(int32 Range, float TileSize, int32 NeighborRange, const TArray64<FIntPoint>* Tiles,
+		const TArray64<uint32>* SpiralTiles, TArray64<uint8>& Out_Payload, TArray<FStructHexGridBulkSection>& Out_Sections);
+	static int64 GetPayloadBytes(int64 TileCount, int32 Range, int32 NeighborRange);
+
+	//Read a .bin file or a payload section of Bytes into the tables of GridDataLoader
+	static bool ReadTiles(const uint8* Data, int64 Bytes, FStructHexTilesTable& Out_Table);
+	static bool ReadTileIndices(const uint8* Data, int64 Bytes, FStructHexTileIndicesTable& Out_Table);
+	//Same rows as the lines of N{r}.data: BINARY_OUTSIDE entries are listed by their coord, BINARY_NONE entries are left out
+	static bool ReadNeighbors(const uint8* Data, int64 Bytes, const TArray64<FIntPoint>& AxialCoords, FStructHexNeighborTable& Out_Table);
+
+private:
+	static const int64 HeaderBytes = sizeof(uint32) * 4 + sizeof(int64);
+
+	static void WriteHeader(uint8* Out_Data, uint32 Magic, int32 Range, int32 Radius, int64 TileCount);
+	//Checks magic and version, the caller checks Bytes against the size the header asks for
+	static bool ReadHeader(const uint8* Data, int64 Bytes, uint32 Magic, int32& Out_Range, int32& Out_Radius, int64& Out_Count);
+	static bool CanWriteNeighbors(int64 TileCount, int32 Radius);
+};
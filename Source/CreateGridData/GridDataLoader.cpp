@@ -0,0 +1,433 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GridDataLoader.h"
+#include <Async/MappedFileHandle.h>
+#include <Async/ParallelFor.h>
+#include <Async/TaskGraphInterfaces.h>
+#include <HAL/PlatformFileManager.h>
+#include <Misc/FileHelper.h>
+
+DEFINE_LOG_CATEGORY(HexGridLoader);
+
+//Mapped view of a data file, falls back to reading the whole file where mapping is not supported
+struct FLoaderFileView
+{
+	TUniquePtr<IMappedFileHandle> Handle;
+	TUniquePtr<IMappedFileRegion> Region;
+	TArray64<uint8> Buffer;
+	const uint8* Data = nullptr;
+	int64 Size = 0;
+
+	bool Open(const FString& FullPath)
+	{
+		Handle.Reset(FPlatformFileManager::Get().GetPlatformFile().OpenMapped(*FullPath));
+		if (Handle.IsValid() && Handle->GetFileSize() > 0) {
+			Region.Reset(Handle->MapRegion(0, Handle->GetFileSize()));
+			if (Region.IsValid()) {
+				Data = Region->GetMappedPtr();
+				Size = Region->GetMappedSize();
+				return true;
+			}
+		}
+
+		if (!FFileHelper::LoadFileToArray(Buffer, *FullPath)) {
+			return false;
+		}
+		Data = Buffer.GetData();
+		Size = Buffer.Num();
+		return true;
+	}
+};
+
+static const double LoaderPow10[19] = {
+	1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9,
+	1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18
+};
+
+GridDataLoader::GridDataLoader()
+{
+}
+
+GridDataLoader::~GridDataLoader()
+{
+}
+
+bool GridDataLoader::LoadTiles(const FString& FullPath, FStructHexTilesTable& Out_Table)
+{
+	FLoaderFileView View;
+	if (!View.Open(FullPath)) {
+		UE_LOG(HexGridLoader, Warning, TEXT("Can not open %s."), *FullPath);
+		return false;
+	}
+
+	TArray<FChunk> Chunks;
+	SplitChunks(View.Data, View.Size, Chunks);
+	int64 EntryCount;
+	int64 LineCount = CountChunks(Chunks, EntryCount);
+	Out_Table.AxialCoords.SetNumUninitialized(LineCount);
+	Out_Table.Positions.SetNumUninitialized(LineCount);
+
+	//q,r|x,y
+	ParallelFor(Chunks.Num(), [&Chunks, &Out_Table](int32 ChunkIndex) {
+		FChunk& Chunk = Chunks[ChunkIndex];
+		const uint8* Ptr = Chunk.Begin;
+		for (int64 Line = Chunk.LineBase; Line < Chunk.LineBase + Chunk.LineCount; Line++)
+		{
+			FVector2D& Pos = Out_Table.Positions[Line];
+			if (!ParseAxial(Ptr, Chunk.End, Out_Table.AxialCoords[Line]) || !ExpectChar(Ptr, Chunk.End, '|')
+				|| !ParseFloat(Ptr, Chunk.End, Pos.X) || !ExpectChar(Ptr, Chunk.End, ',')
+				|| !ParseFloat(Ptr, Chunk.End, Pos.Y) || !ParseLineEnd(Ptr, Chunk.End)) {
+				Chunk.Valid = false;
+				return;
+			}
+		}
+	});
+
+	if (!AllChunksValid(Chunks, FullPath)) {
+		Out_Table = FStructHexTilesTable();
+		return false;
+	}
+	return true;
+}
+
+bool GridDataLoader::LoadTileIndices(const FString& FullPath, FStructHexTileIndicesTable& Out_Table)
+{
+	FLoaderFileView View;
+	if (!View.Open(FullPath)) {
+		UE_LOG(HexGridLoader, Warning, TEXT("Can not open %s."), *FullPath);
+		return false;
+	}
+
+	TArray<FChunk> Chunks;
+	SplitChunks(View.Data, View.Size, Chunks);
+	int64 EntryCount;
+	int64 LineCount = CountChunks(Chunks, EntryCount);
+	Out_Table.AxialCoords.SetNumUninitialized(LineCount);
+	Out_Table.Indices.SetNumUninitialized(LineCount);
+
+	//q,r|index
+	ParallelFor(Chunks.Num(), [&Chunks, &Out_Table](int32 ChunkIndex) {
+		FChunk& Chunk = Chunks[ChunkIndex];
+		const uint8* Ptr = Chunk.Begin;
+		for (int64 Line = Chunk.LineBase; Line < Chunk.LineBase + Chunk.LineCount; Line++)
+		{
+			if (!ParseAxial(Ptr, Chunk.End, Out_Table.AxialCoords[Line]) || !ExpectChar(Ptr, Chunk.End, '|')
+				|| !ParseInt(Ptr, Chunk.End, Out_Table.Indices[Line]) || !ParseLineEnd(Ptr, Chunk.End)) {
+				Chunk.Valid = false;
+				return;
+			}
+		}
+	});
+
+	if (!AllChunksValid(Chunks, FullPath)) {
+		Out_Table = FStructHexTileIndicesTable();
+		return false;
+	}
+	return true;
+}
+
+bool GridDataLoader::LoadNeighbors(const FString& FullPath, FStructHexNeighborTable& Out_Table)
+{
+	FLoaderFileView View;
+	if (!View.Open(FullPath)) {
+		UE_LOG(HexGridLoader, Warning, TEXT("Can not open %s."), *FullPath);
+		return false;
+	}
+
+	TArray<FChunk> Chunks;
+	SplitChunks(View.Data, View.Size, Chunks);
+	int64 EntryCount;
+	int64 LineCount = CountChunks(Chunks, EntryCount);
+	Out_Table.Offsets.SetNumUninitialized(LineCount + 1);
+	Out_Table.Tiles.SetNumUninitialized(EntryCount);
+	Out_Table.Offsets[LineCount] = EntryCount;
+
+	//q,r q,r ... q,r
+	ParallelFor(Chunks.Num(), [&Chunks, &Out_Table](int32 ChunkIndex) {
+		FChunk& Chunk = Chunks[ChunkIndex];
+		const uint8* Ptr = Chunk.Begin;
+		int64 Entry = Chunk.EntryBase;
+		int64 EntryEnd = Chunk.EntryBase + Chunk.EntryCount;
+		for (int64 Line = Chunk.LineBase; Line < Chunk.LineBase + Chunk.LineCount; Line++)
+		{
+			Out_Table.Offsets[Line] = Entry;
+			//A masked grid may leave a tile without neighbors
+			bool More = Ptr < Chunk.End && *Ptr != '\n' && *Ptr != '\r';
+			while (More) {
+				if (Entry >= EntryEnd || !ParseAxial(Ptr, Chunk.End, Out_Table.Tiles[Entry])) {
+					Chunk.Valid = false;
+					return;
+				}
+				Entry++;
+				More = Ptr < Chunk.End && *Ptr == ' ';
+				if (More) {
+					Ptr++;
+				}
+			}
+			if (!ParseLineEnd(Ptr, Chunk.End)) {
+				Chunk.Valid = false;
+				return;
+			}
+		}
+	});
+
+	if (!AllChunksValid(Chunks, FullPath)) {
+		Out_Table = FStructHexNeighborTable();
+		return false;
+	}
+	return true;
+}
+
+bool GridDataLoader::LoadTilesNaive(const FString& FullPath, FStructHexTilesTable& Out_Table)
+{
+	TArray<FString> Lines;
+	if (!FFileHelper::LoadFileToStringArray(Lines, *FullPath)) {
+		return false;
+	}
+
+	Out_Table.AxialCoords.Empty(Lines.Num());
+	Out_Table.Positions.Empty(Lines.Num());
+	TArray<FString> Fields;
+	TArray<FString> Values;
+	for (const FString& Line : Lines)
+	{
+		Line.ParseIntoArray(Fields, TEXT("|"));
+		if (Fields.Num() != 2) {
+			return false;
+		}
+		Fields[0].ParseIntoArray(Values, TEXT(","));
+		if (Values.Num() != 2) {
+			return false;
+		}
+		Out_Table.AxialCoords.Add(FIntPoint(FCString::Atoi(*Values[0]), FCString::Atoi(*Values[1])));
+		Fields[1].ParseIntoArray(Values, TEXT(","));
+		if (Values.Num() != 2) {
+			return false;
+		}
+		Out_Table.Positions.Add(FVector2D(FCString::Atod(*Values[0]), FCString::Atod(*Values[1])));
+	}
+	return true;
+}
+
+bool GridDataLoader::LoadTileIndicesNaive(const FString& FullPath, FStructHexTileIndicesTable& Out_Table)
+{
+	TArray<FString> Lines;
+	if (!FFileHelper::LoadFileToStringArray(Lines, *FullPath)) {
+		return false;
+	}
+
+	Out_Table.AxialCoords.Empty(Lines.Num());
+	Out_Table.Indices.Empty(Lines.Num());
+	TArray<FString> Fields;
+	TArray<FString> Values;
+	for (const FString& Line : Lines)
+	{
+		Line.ParseIntoArray(Fields, TEXT("|"));
+		if (Fields.Num() != 2) {
+			return false;
+		}
+		Fields[0].ParseIntoArray(Values, TEXT(","));
+		if (Values.Num() != 2) {
+			return false;
+		}
+		Out_Table.AxialCoords.Add(FIntPoint(FCString::Atoi(*Values[0]), FCString::Atoi(*Values[1])));
+		Out_Table.Indices.Add(FCString::Atoi64(*Fields[1]));
+	}
+	return true;
+}
+
+bool GridDataLoader::LoadNeighborsNaive(const FString& FullPath, FStructHexNeighborTable& Out_Table)
+{
+	TArray<FString> Lines;
+	if (!FFileHelper::LoadFileToStringArray(Lines, *FullPath)) {
+		return false;
+	}
+
+	Out_Table.Offsets.Empty(Lines.Num() + 1);
+	Out_Table.Tiles.Empty();
+	TArray<FString> Pairs;
+	TArray<FString> Values;
+	for (const FString& Line : Lines)
+	{
+		Out_Table.Offsets.Add(Out_Table.Tiles.Num());
+		Line.ParseIntoArray(Pairs, TEXT(" "));
+		for (const FString& Pair : Pairs)
+		{
+			Pair.ParseIntoArray(Values, TEXT(","));
+			if (Values.Num() != 2) {
+				return false;
+			}
+			Out_Table.Tiles.Add(FIntPoint(FCString::Atoi(*Values[0]), FCString::Atoi(*Values[1])));
+		}
+	}
+	Out_Table.Offsets.Add(Out_Table.Tiles.Num());
+	return true;
+}
+
+void GridDataLoader::SplitChunks(const uint8* Data, int64 Size, TArray<FChunk>& Out_Chunks)
+{
+	Out_Chunks.Empty();
+	if (Size <= 0) {
+		return;
+	}
+
+	int64 ThreadCount = FMath::Max(1, FTaskGraphInterface::Get().GetNumWorkerThreads());
+	int64 ChunkCount = FMath::Clamp<int64>(Size / LOADER_MIN_CHUNK_BYTES, 1, ThreadCount * LOADER_CHUNKS_PER_THREAD);
+	const uint8* End = Data + Size;
+	const uint8* Begin = Data;
+	for (int64 i = 1; i <= ChunkCount; i++)
+	{
+		//Move every split behind the next line end so no line crosses two chunks
+		const uint8* Split = FMath::Max(Begin, Data + Size * i / ChunkCount);
+		while (Split < End && Split > Data && Split[-1] != '\n') {
+			Split++;
+		}
+		if (Split > Begin) {
+			FChunk Chunk;
+			Chunk.Begin = Begin;
+			Chunk.End = Split;
+			Out_Chunks.Add(Chunk);
+			Begin = Split;
+		}
+	}
+}
+
+int64 GridDataLoader::CountChunks(TArray<FChunk>& InOut_Chunks, int64& Out_EntryCount)
+{
+	//Every q,r entry holds exactly one comma
+	ParallelFor(InOut_Chunks.Num(), [&InOut_Chunks](int32 ChunkIndex) {
+		FChunk& Chunk = InOut_Chunks[ChunkIndex];
+		int64 Lines = 0;
+		int64 Entries = 0;
+		for (const uint8* Ptr = Chunk.Begin; Ptr < Chunk.End; Ptr++)
+		{
+			Lines += *Ptr == '\n';
+			Entries += *Ptr == ',';
+		}
+		//Last line of the file may miss its line end
+		if (Chunk.End[-1] != '\n') {
+			Lines++;
+		}
+		Chunk.LineCount = Lines;
+		Chunk.EntryCount = Entries;
+	});
+
+	int64 LineCount = 0;
+	Out_EntryCount = 0;
+	for (FChunk& Chunk : InOut_Chunks)
+	{
+		Chunk.LineBase = LineCount;
+		Chunk.EntryBase = Out_EntryCount;
+		LineCount += Chunk.LineCount;
+		Out_EntryCount += Chunk.EntryCount;
+	}
+	return LineCount;
+}
+
+bool GridDataLoader::AllChunksValid(const TArray<FChunk>& Chunks, const FString& FullPath)
+{
+	for (const FChunk& Chunk : Chunks)
+	{
+		if (!Chunk.Valid) {
+			UE_LOG(HexGridLoader, Warning, TEXT("Malformed line in %s near line %lld."), *FullPath, Chunk.LineBase);
+			return false;
+		}
+	}
+	return true;
+}
+
+bool GridDataLoader::ParseInt(const uint8*& InOut_Ptr, const uint8* End, int64& Out_Value)
+{
+	const uint8* Ptr = InOut_Ptr;
+	bool Negative = Ptr < End && *Ptr == '-';
+	if (Negative) {
+		Ptr++;
+	}
+
+	const uint8* Digits = Ptr;
+	uint64 Value = 0;
+	while (Ptr < End && *Ptr >= '0' && *Ptr <= '9') {
+		Value = Value * 10 + (*Ptr - '0');
+		Ptr++;
+	}
+	if (Ptr == Digits || Ptr - Digits > 18) {
+		return false;
+	}
+
+	Out_Value = Negative ? -(int64)Value : (int64)Value;
+	InOut_Ptr = Ptr;
+	return true;
+}
+
+bool GridDataLoader::ParseFloat(const uint8*& InOut_Ptr, const uint8* End, double& Out_Value)
+{
+	//Conv_FloatToText output: optional sign, digits, optional fraction, no grouping or exponent
+	const uint8* Ptr = InOut_Ptr;
+	bool Negative = Ptr < End && *Ptr == '-';
+	if (Negative) {
+		Ptr++;
+	}
+
+	const uint8* Digits = Ptr;
+	uint64 Mantissa = 0;
+	while (Ptr < End && *Ptr >= '0' && *Ptr <= '9') {
+		Mantissa = Mantissa * 10 + (*Ptr - '0');
+		Ptr++;
+	}
+	int32 IntegerDigits = (int32)(Ptr - Digits);
+	int32 FractionDigits = 0;
+	if (Ptr < End && *Ptr == '.') {
+		Ptr++;
+		while (Ptr < End && *Ptr >= '0' && *Ptr <= '9') {
+			Mantissa = Mantissa * 10 + (*Ptr - '0');
+			FractionDigits++;
+			Ptr++;
+		}
+	}
+	if (IntegerDigits == 0 || IntegerDigits + FractionDigits > 18) {
+		return false;
+	}
+
+	Out_Value = (double)Mantissa / LoaderPow10[FractionDigits];
+	if (Negative) {
+		Out_Value = -Out_Value;
+	}
+	InOut_Ptr = Ptr;
+	return true;
+}
+
+bool GridDataLoader::ParseAxial(const uint8*& InOut_Ptr, const uint8* End, FIntPoint& Out_Hex)
+{
+	int64 Q;
+	int64 R;
+	if (!ParseInt(InOut_Ptr, End, Q) || !ExpectChar(InOut_Ptr, End, ',') || !ParseInt(InOut_Ptr, End, R)) {
+		return false;
+	}
+	if (Q < MIN_int32 || Q > MAX_int32 || R < MIN_int32 || R > MAX_int32) {
+		return false;
+	}
+	Out_Hex = FIntPoint((int32)Q, (int32)R);
+	return true;
+}
+
+bool GridDataLoader::ExpectChar(const uint8*& InOut_Ptr, const uint8* End, uint8 Char)
+{
+	if (InOut_Ptr >= End || *InOut_Ptr != Char) {
+		return false;
+	}
+	InOut_Ptr++;
+	return true;
+}
+
+bool GridDataLoader::ParseLineEnd(const uint8*& InOut_Ptr, const uint8* End)
+{
+	//Text mode streams write \r\n on Windows
+	if (InOut_Ptr < End && *InOut_Ptr == '\r') {
+		InOut_Ptr++;
+	}
+	if (InOut_Ptr == End) {
+		return true;
+	}
+	return ExpectChar(InOut_Ptr, End, '\n');
+}
@@ -0,0 +1,79 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+DECLARE_LOG_CATEGORY_EXTERN(HexGridLoader, Log, All);
+
+//Smallest chunk handed to one parse task, smaller files are parsed by fewer tasks
+#define LOADER_MIN_CHUNK_BYTES	(1 << 20)
+//Chunks per worker thread, a few extra chunks balance lines of different length
+#define LOADER_CHUNKS_PER_THREAD	4
+
+//Tiles.data, line i is q,r|x,y
+struct FStructHexTilesTable
+{
+	TArray64<FIntPoint> AxialCoords;
+	TArray64<FVector2D> Positions;
+};
+
+//TileIndices.data, line i is q,r|index
+struct FStructHexTileIndicesTable
+{
+	TArray64<FIntPoint> AxialCoords;
+	TArray64<int64> Indices;
+};
+
+//N{r}.data in CSR form, the neighbors of line i are Tiles[Offsets[i]] .. Tiles[Offsets[i + 1] - 1]
+struct FStructHexNeighborTable
+{
+	TArray64<int64> Offsets;
+	TArray64<FIntPoint> Tiles;
+
+	int64 GetLineCount() const { return Offsets.Num() > 0 ? Offsets.Num() - 1 : 0; }
+};
+
+/**
+ * Loads the text files written by the Write* functions of AHexGridCreator.
+ * The file is mapped, split into newline aligned chunks and parsed by ParallelFor in two passes:
+ * the first counts lines and entries per chunk, the second parses every chunk straight into its
+ * slice of the output arrays. No FString is created per line.
+ */
+class CREATEGRIDDATA_API GridDataLoader
+{
+public:
+	GridDataLoader();
+	~GridDataLoader();
+
+	static bool LoadTiles(const FString& FullPath, FStructHexTilesTable& Out_Table);
+	static bool LoadTileIndices(const FString& FullPath, FStructHexTileIndicesTable& Out_Table);
+	static bool LoadNeighbors(const FString& FullPath, FStructHexNeighborTable& Out_Table);
+
+	//Reference loaders with FString::ParseIntoArray, kept for benchmarks and validation
+	static bool LoadTilesNaive(const FString& FullPath, FStructHexTilesTable& Out_Table);
+	static bool LoadTileIndicesNaive(const FString& FullPath, FStructHexTileIndicesTable& Out_Table);
+	static bool LoadNeighborsNaive(const FString& FullPath, FStructHexNeighborTable& Out_Table);
+
+private:
+	struct FChunk
+	{
+		const uint8* Begin = nullptr;
+		const uint8* End = nullptr;
+		int64 LineCount = 0;
+		int64 EntryCount = 0;
+		int64 LineBase = 0;
+		int64 EntryBase = 0;
+		bool Valid = true;
+	};
+
+	static void SplitChunks(const uint8* Data, int64 Size, TArray<FChunk>& Out_Chunks);
+	static int64 CountChunks(TArray<FChunk>& InOut_Chunks, int64& Out_EntryCount);
+	static bool AllChunksValid(const TArray<FChunk>& Chunks, const FString& FullPath);
+
+	static bool ParseInt(const uint8*& InOut_Ptr, const uint8* End, int64& Out_Value);
+	static bool ParseFloat(const uint8*& InOut_Ptr, const uint8* End, double& Out_Value);
+	static bool ParseAxial(const uint8*& InOut_Ptr, const uint8* End, FIntPoint& Out_Hex);
+	static bool ExpectChar(const uint8*& InOut_Ptr, const uint8* End, uint8 Char);
+	static bool ParseLineEnd(const uint8*& InOut_Ptr, const uint8* End);
+};
@@ -0,0 +1,333 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GridDualGraphUtility.h"
+#include "HexMappedFile.h"
+#include <Async/ParallelFor.h>
+
+DEFINE_LOG_CATEGORY(HexDualGraph);
+
+GridDualGraphUtility::GridDualGraphUtility()
+{
+}
+
+GridDualGraphUtility::~GridDualGraphUtility()
+{
+}
+
+bool GridDualGraphUtility::Build(int32 Range, FStructHexDualGraph& Out_Graph)
+{
+	Out_Graph = FStructHexDualGraph();
+	if (Range < 0 || GetEdgeCount(Range) >= DUAL_GRAPH_NONE) {
+		UE_LOG(HexDualGraph, Warning, TEXT("GridRange %d does not fit 32 bit dual graph ids."), Range);
+		return false;
+	}
+	Out_Graph.GridRange = Range;
+	Out_Graph.TileCount = HexMath::GetTileCount(Range);
+
+	FOuterIds OuterIds;
+	NumberOuterKeys(Range, Out_Graph, OuterIds);
+
+	const int64 TileCount = Out_Graph.TileCount;
+	Out_Graph.CornerCoords.SetNumUninitialized(Out_Graph.CornerCount);
+	Out_Graph.EdgeCoords.SetNumUninitialized(Out_Graph.EdgeCount);
+	Out_Graph.TileCorners.Ids.SetNumUninitialized(TileCount * 6);
+	Out_Graph.TileEdges.Ids.SetNumUninitialized(TileCount * 6);
+	TArray64<uint32> EdgeRows;
+	TArray64<uint32> CornerRows;
+	EdgeRows.SetNumUninitialized(Out_Graph.EdgeCount * 2);
+	CornerRows.SetNumUninitialized(Out_Graph.CornerCount * 3);
+
+	//Every tile fills its own 6 corner and edge ids and the rows of the keys it owns, so chunks never share a slot
+	int32 ChunkCount = (int32)((TileCount + DUAL_GRAPH_CHUNK_SIZE - 1) / DUAL_GRAPH_CHUNK_SIZE);
+	ParallelFor(ChunkCount, [&Out_Graph, &OuterIds, &EdgeRows, &CornerRows, Range, TileCount](int32 ChunkIndex) {
+		int64 Begin = (int64)ChunkIndex * DUAL_GRAPH_CHUNK_SIZE;
+		int64 End = FMath::Min(Begin + DUAL_GRAPH_CHUNK_SIZE, TileCount);
+		for (int64 i = Begin; i < End; i++)
+		{
+			HexMath::FAxial Hex = HexMath::SpiralIndexToAxial(i);
+			for (int32 j = 0; j < 6; j++)
+			{
+				Out_Graph.TileCorners.Ids[i * 6 + j] = GetCornerId(HexMath::CornerKey(Hex, j), TileCount, OuterIds);
+				Out_Graph.TileEdges.Ids[i * 6 + j] = GetEdgeId(HexMath::EdgeKey(Hex, j), TileCount, OuterIds);
+			}
+			for (int32 Type = 0; Type < 2; Type++)
+			{
+				int64 Id = i * 2 + Type;
+				Out_Graph.CornerCoords[Id] = FIntVector(Hex.Q, Hex.R, Type);
+				FillCornerRow(HexMath::TFeatureKey<int32>{ Hex, Type }, Range, TileCount, OuterIds, &CornerRows[Id * 3]);
+			}
+			for (int32 Type = 0; Type < 3; Type++)
+			{
+				int64 Id = i * 3 + Type;
+				Out_Graph.EdgeCoords[Id] = FIntVector(Hex.Q, Hex.R, Type);
+				FillEdgeRow(HexMath::TFeatureKey<int32>{ Hex, Type }, Range, &EdgeRows[Id * 2]);
+			}
+		}
+	});
+
+	//Keys owned by the outer ring, 6(R+1) hexes
+	for (const HexMath::FAxial& Hex : HexMath::Ring(HexMath::FAxial(), Range + 1))
+	{
+		int64 Outer = HexMath::AxialToSpiralIndex(Hex) - TileCount;
+		for (int32 Type = 0; Type < 2; Type++)
+		{
+			uint32 Id = OuterIds.Corners[Outer * 2 + Type];
+			if (Id != DUAL_GRAPH_NONE) {
+				Out_Graph.CornerCoords[Id] = FIntVector(Hex.Q, Hex.R, Type);
+				FillCornerRow(HexMath::TFeatureKey<int32>{ Hex, Type }, Range, TileCount, OuterIds, &CornerRows[(int64)Id * 3]);
+			}
+		}
+		for (int32 Type = 0; Type < 3; Type++)
+		{
+			uint32 Id = OuterIds.Edges[Outer * 3 + Type];
+			if (Id != DUAL_GRAPH_NONE) {
+				Out_Graph.EdgeCoords[Id] = FIntVector(Hex.Q, Hex.R, Type);
+				FillEdgeRow(HexMath::TFeatureKey<int32>{ Hex, Type }, Range, &EdgeRows[(int64)Id * 2]);
+			}
+		}
+	}
+
+	FillUniformOffsets(Out_Graph.TileCorners, TileCount, 6);
+	FillUniformOffsets(Out_Graph.TileEdges, TileCount, 6);
+	CompactRows(EdgeRows, 2, Out_Graph.EdgeTiles);
+	CompactRows(CornerRows, 3, Out_Graph.CornerCorners);
+
+	UE_LOG(HexDualGraph, Log, TEXT("Dual graph of GridRange %d: %lld tiles, %lld corners, %lld edges."), Range,
+		Out_Graph.TileCount, Out_Graph.CornerCount, Out_Graph.EdgeCount);
+	return true;
+}
+
+bool GridDualGraphUtility::WriteToFile(const FStructHexDualGraph& Graph, const FString& FullPath)
+{
+	uint32 Header[4] = { DUAL_GRAPH_MAGIC, DUAL_GRAPH_VERSION, (uint32)Graph.GridRange, 0 };
+	int64 Counts[3] = { Graph.TileCount, Graph.CornerCount, Graph.EdgeCount };
+	TArray<TPair<const void*, int64>> Sections;
+	Sections.Emplace(Header, sizeof(Header));
+	Sections.Emplace(Counts, sizeof(Counts));
+	Sections.Emplace(Graph.CornerCoords.GetData(), Graph.CornerCoords.Num() * sizeof(FIntVector));
+	Sections.Emplace(Graph.EdgeCoords.GetData(), Graph.EdgeCoords.Num() * sizeof(FIntVector));
+
+	const FStructHexCsr* Csrs[4] = { &Graph.TileCorners, &Graph.TileEdges, &Graph.EdgeTiles, &Graph.CornerCorners };
+	int64 CsrCounts[4][2];
+	for (int32 i = 0; i < 4; i++)
+	{
+		CsrCounts[i][0] = Csrs[i]->GetRowCount();
+		CsrCounts[i][1] = Csrs[i]->Ids.Num();
+		Sections.Emplace(CsrCounts[i], sizeof(CsrCounts[i]));
+		Sections.Emplace(Csrs[i]->Offsets.GetData(), Csrs[i]->Offsets.Num() * sizeof(int64));
+		Sections.Emplace(Csrs[i]->Ids.GetData(), Csrs[i]->Ids.Num() * sizeof(uint32));
+	}
+
+	//Every section size is known, so the file is mapped at its final size and the arrays are copied in parallel
+	FHexMappedFile File;
+	if (!File.Open(FullPath, FHexMappedFile::GetSectionsBytes(Sections))) {
+		return false;
+	}
+	File.WriteSections(Sections);
+	return File.Commit();
+}
+
+bool GridDualGraphUtility::ReadFromFile(const FString& FullPath, FStructHexDualGraph& Out_Graph)
+{
+	Out_Graph = FStructHexDualGraph();
+	FHexFileReader Reader;
+	if (!Reader.Open(FullPath)) {
+		UE_LOG(HexDualGraph, Warning, TEXT("Can not open %s."), *FullPath);
+		return false;
+	}
+
+	auto ReadCsr = [&Reader](FStructHexCsr& Out_Csr, int64 ExpectedRows) {
+		int64 Counts[2];
+		return Reader.ReadBytes(Counts, sizeof(Counts)) && Counts[0] == ExpectedRows
+			&& Reader.ReadArray(Out_Csr.Offsets, Counts[0] + 1) && Reader.ReadArray(Out_Csr.Ids, Counts[1])
+			&& Out_Csr.Offsets[0] == 0 && Out_Csr.Offsets[Counts[0]] == Counts[1];
+	};
+
+	uint32 Header[4];
+	int64 Counts[3];
+	if (!Reader.ReadBytes(Header, sizeof(Header)) || Header[0] != DUAL_GRAPH_MAGIC || Header[1] != DUAL_GRAPH_VERSION
+		|| !Reader.ReadBytes(Counts, sizeof(Counts))) {
+		UE_LOG(HexDualGraph, Warning, TEXT("%s is not a dual graph of version %d."), *FullPath, DUAL_GRAPH_VERSION);
+		return false;
+	}
+	Out_Graph.GridRange = (int32)Header[2];
+	Out_Graph.TileCount = Counts[0];
+	Out_Graph.CornerCount = Counts[1];
+	Out_Graph.EdgeCount = Counts[2];
+
+	if (!Reader.ReadArray(Out_Graph.CornerCoords, Out_Graph.CornerCount) || !Reader.ReadArray(Out_Graph.EdgeCoords, Out_Graph.EdgeCount)
+		|| !ReadCsr(Out_Graph.TileCorners, Out_Graph.TileCount) || !ReadCsr(Out_Graph.TileEdges, Out_Graph.TileCount)
+		|| !ReadCsr(Out_Graph.EdgeTiles, Out_Graph.EdgeCount) || !ReadCsr(Out_Graph.CornerCorners, Out_Graph.CornerCount)) {
+		UE_LOG(HexDualGraph, Warning, TEXT("Dual graph %s is truncated or damaged."), *FullPath);
+		Out_Graph = FStructHexDualGraph();
+		return false;
+	}
+	return true;
+}
+
+int64 GridDualGraphUtility::GetCornerCount(int32 Range)
+{
+	return 6 * (int64)(Range + 1) * (Range + 1);
+}
+
+int64 GridDualGraphUtility::GetEdgeCount(int32 Range)
+{
+	return 3 * (int64)(Range + 1) * (3 * (int64)Range + 2);
+}
+
+int64 GridDualGraphUtility::EstimateFileBytes(int32 Range)
+{
+	int64 TileCount = HexMath::GetTileCount(Range);
+	int64 CornerCount = GetCornerCount(Range);
+	int64 EdgeCount = GetEdgeCount(Range);
+	//6(2R+1) edges lie on the border and have one tile, every edge shows up in the rows of both corners
+	int64 BorderEdgeCount = 6 * (2 * (int64)Range + 1);
+	return sizeof(uint32) * 4 + sizeof(int64) * 3
+		+ (CornerCount + EdgeCount) * (int64)sizeof(FIntVector)
+		+ GetCsrBytes(TileCount, TileCount * 6) * 2
+		+ GetCsrBytes(EdgeCount, EdgeCount * 2 - BorderEdgeCount)
+		+ GetCsrBytes(CornerCount, EdgeCount * 2);
+}
+
+int64 GridDualGraphUtility::EstimateBuildMemory(int32 Range)
+{
+	return EstimateFileBytes(Range) + (GetEdgeCount(Range) * 2 + GetCornerCount(Range) * 3) * (int64)sizeof(uint32);
+}
+
+void GridDualGraphUtility::NumberOuterKeys(int32 Range, FStructHexDualGraph& InOut_Graph, FOuterIds& Out_Ids)
+{
+	//Outer keys are few, 6(R+1) hexes, and numbered in spiral order so the ids do not depend on scheduling
+	int32 OuterCount = 6 * (Range + 1);
+	Out_Ids.Corners.Init(DUAL_GRAPH_NONE, OuterCount * 2);
+	Out_Ids.Edges.Init(DUAL_GRAPH_NONE, OuterCount * 3);
+	int64 NextCorner = InOut_Graph.TileCount * 2;
+	int64 NextEdge = InOut_Graph.TileCount * 3;
+
+	int32 Outer = 0;
+	for (const HexMath::FAxial& Hex : HexMath::Ring(HexMath::FAxial(), Range + 1))
+	{
+		for (int32 Type = 0; Type < 2; Type++)
+		{
+			HexMath::TFeatureKey<int32> Corner{ Hex, Type };
+			if (IsInGrid(HexMath::CornerHex(Corner, 1), Range) || IsInGrid(HexMath::CornerHex(Corner, 2), Range)) {
+				Out_Ids.Corners[Outer * 2 + Type] = (uint32)NextCorner++;
+			}
+		}
+		for (int32 Type = 0; Type < 3; Type++)
+		{
+			if (IsInGrid(HexMath::EdgeHex(HexMath::TFeatureKey<int32>{ Hex, Type }, 1), Range)) {
+				Out_Ids.Edges[Outer * 3 + Type] = (uint32)NextEdge++;
+			}
+		}
+		Outer++;
+	}
+
+	InOut_Graph.CornerCount = NextCorner;
+	InOut_Graph.EdgeCount = NextEdge;
+}
+
+uint32 GridDualGraphUtility::GetCornerId(const HexMath::TFeatureKey<int32>& Corner, int64 TileCount, const FOuterIds& Ids)
+{
+	int64 Index = HexMath::AxialToSpiralIndex(Corner.Owner);
+	return Index < TileCount ? (uint32)(Index * 2 + Corner.Type) : Ids.Corners[(Index - TileCount) * 2 + Corner.Type];
+}
+
+uint32 GridDualGraphUtility::GetEdgeId(const HexMath::TFeatureKey<int32>& Edge, int64 TileCount, const FOuterIds& Ids)
+{
+	int64 Index = HexMath::AxialToSpiralIndex(Edge.Owner);
+	return Index < TileCount ? (uint32)(Index * 3 + Edge.Type) : Ids.Edges[(Index - TileCount) * 3 + Edge.Type];
+}
+
+uint32 GridDualGraphUtility::GetTileId(const HexMath::FAxial& Hex, int32 Range)
+{
+	return IsInGrid(Hex, Range) ? (uint32)HexMath::AxialToSpiralIndex(Hex) : DUAL_GRAPH_NONE;
+}
+
+bool GridDualGraphUtility::IsInGrid(const HexMath::FAxial& Hex, int32 Range)
+{
+	return HexMath::Length(Hex) <= Range;
+}
+
+void GridDualGraphUtility::FillEdgeRow(const HexMath::TFeatureKey<int32>& Edge, int32 Range, uint32* Out_Row)
+{
+	Out_Row[0] = GetTileId(HexMath::EdgeHex(Edge, 0), Range);
+	Out_Row[1] = GetTileId(HexMath::EdgeHex(Edge, 1), Range);
+}
+
+void GridDualGraphUtility::FillCornerRow(const HexMath::TFeatureKey<int32>& Corner, int32 Range, int64 TileCount, const FOuterIds& Ids,
+	uint32* Out_Row)
+{
+	for (int32 i = 0; i < 3; i++)
+	{
+		//The joining edge belongs to the grid when a tile on either side does
+		if (IsInGrid(HexMath::CornerHex(Corner, HexMath::CornerNeighborHexes[i][0]), Range)
+			|| IsInGrid(HexMath::CornerHex(Corner, HexMath::CornerNeighborHexes[i][1]), Range)) {
+			Out_Row[i] = GetCornerId(HexMath::CornerNeighbor(Corner, i), TileCount, Ids);
+		}
+		else {
+			Out_Row[i] = DUAL_GRAPH_NONE;
+		}
+	}
+}
+
+void GridDualGraphUtility::FillUniformOffsets(FStructHexCsr& InOut_Csr, int64 RowCount, int32 Width)
+{
+	InOut_Csr.Offsets.SetNumUninitialized(RowCount + 1);
+	int32 ChunkCount = (int32)((RowCount + DUAL_GRAPH_CHUNK_SIZE) / DUAL_GRAPH_CHUNK_SIZE);
+	ParallelFor(ChunkCount, [&InOut_Csr, RowCount, Width](int32 ChunkIndex) {
+		int64 Begin = (int64)ChunkIndex * DUAL_GRAPH_CHUNK_SIZE;
+		int64 End = FMath::Min(Begin + DUAL_GRAPH_CHUNK_SIZE, RowCount + 1);
+		for (int64 i = Begin; i < End; i++)
+		{
+			InOut_Csr.Offsets[i] = i * Width;
+		}
+	});
+}
+
+void GridDualGraphUtility::CompactRows(const TArray64<uint32>& Rows, int32 Width, FStructHexCsr& Out_Csr)
+{
+	//Count ids per chunk, prefix sum the chunk bases, then every chunk writes its own slice
+	int64 RowCount = Rows.Num() / Width;
+	int32 ChunkCount = (int32)((RowCount + DUAL_GRAPH_CHUNK_SIZE - 1) / DUAL_GRAPH_CHUNK_SIZE);
+	TArray<int64> ChunkBases;
+	ChunkBases.SetNumZeroed(ChunkCount + 1);
+	ParallelFor(ChunkCount, [&Rows, &ChunkBases, RowCount, Width](int32 ChunkIndex) {
+		int64 Begin = (int64)ChunkIndex * DUAL_GRAPH_CHUNK_SIZE * Width;
+		int64 End = FMath::Min((int64)(ChunkIndex + 1) * DUAL_GRAPH_CHUNK_SIZE, RowCount) * Width;
+		int64 Count = 0;
+		for (int64 i = Begin; i < End; i++)
+		{
+			Count += Rows[i] != DUAL_GRAPH_NONE ? 1 : 0;
+		}
+		ChunkBases[ChunkIndex + 1] = Count;
+	});
+	for (int32 i = 0; i < ChunkCount; i++)
+	{
+		ChunkBases[i + 1] += ChunkBases[i];
+	}
+
+	Out_Csr.Offsets.SetNumUninitialized(RowCount + 1);
+	Out_Csr.Ids.SetNumUninitialized(ChunkBases[ChunkCount]);
+	ParallelFor(ChunkCount, [&Rows, &ChunkBases, &Out_Csr, RowCount, Width](int32 ChunkIndex) {
+		int64 Next = ChunkBases[ChunkIndex];
+		int64 End = FMath::Min((int64)(ChunkIndex + 1) * DUAL_GRAPH_CHUNK_SIZE, RowCount);
+		for (int64 Row = (int64)ChunkIndex * DUAL_GRAPH_CHUNK_SIZE; Row < End; Row++)
+		{
+			Out_Csr.Offsets[Row] = Next;
+			for (int32 i = 0; i < Width; i++)
+			{
+				uint32 Id = Rows[Row * Width + i];
+				if (Id != DUAL_GRAPH_NONE) {
+					Out_Csr.Ids[Next++] = Id;
+				}
+			}
+		}
+	});
+	Out_Csr.Offsets[RowCount] = ChunkBases[ChunkCount];
+}
+
+int64 GridDualGraphUtility::GetCsrBytes(int64 RowCount, int64 IdCount)
+{
+	return sizeof(int64) * 2 + (RowCount + 1) * (int64)sizeof(int64) + IdCount * (int64)sizeof(uint32);
+}
@@ -0,0 +1,99 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HexMath.h"
+
+DECLARE_LOG_CATEGORY_EXTERN(HexDualGraph, Log, All);
+
+//'HXDG'
+#define DUAL_GRAPH_MAGIC	0x47445848
+#define DUAL_GRAPH_VERSION	1
+//Tiles or rows handed to one ParallelFor task
+#define DUAL_GRAPH_CHUNK_SIZE	(1 << 16)
+//Missing corner or tile across the grid border, never stored in the CSR arrays
+#define DUAL_GRAPH_NONE	MAX_uint32
+
+//Row i lists Ids[Offsets[i]] .. Ids[Offsets[i + 1] - 1]
+struct FStructHexCsr
+{
+	TArray64<int64> Offsets;
+	TArray64<uint32> Ids;
+
+	int64 GetRowCount() const { return Offsets.Num() > 0 ? Offsets.Num() - 1 : 0; }
+};
+
+/**
+ * Corners and edges of a hexagon grid as deduplicated entities.
+ * Tile ids are spiral indices. Corner and edge ids come from the integer keys of HexMath::CornerKey and
+ * HexMath::EdgeKey: a key owned by tile i gets 2i + Type or 3i + Type, keys owned by hexes of the ring
+ * just outside the grid are numbered after those in spiral order.
+ */
+struct FStructHexDualGraph
+{
+	int32 GridRange = 0;
+	int64 TileCount = 0;
+	int64 CornerCount = 0;
+	int64 EdgeCount = 0;
+
+	//Owner q, owner r, type
+	TArray64<FIntVector> CornerCoords;
+	TArray64<FIntVector> EdgeCoords;
+
+	//6 per tile, in HexMath corner and edge order
+	FStructHexCsr TileCorners;
+	FStructHexCsr TileEdges;
+	//Owner first, 1 tile on the border
+	FStructHexCsr EdgeTiles;
+	//Corners joined by an edge of the grid, 2 or 3
+	FStructHexCsr CornerCorners;
+};
+
+/**
+ * Builds the dual graph with ParallelFor over chunks of the spiral and stores it in a binary file:
+ * header (magic, version, range, reserved, tile, corner and edge counts), corner coords, edge coords,
+ * then TileCorners, TileEdges, EdgeTiles and CornerCorners, each as row count, id count, offsets and ids.
+ */
+class CREATEGRIDDATA_API GridDualGraphUtility
+{
+public:
+	GridDualGraphUtility();
+	~GridDualGraphUtility();
+
+	static bool Build(int32 Range, FStructHexDualGraph& Out_Graph);
+	static bool WriteToFile(const FStructHexDualGraph& Graph, const FString& FullPath);
+	static bool ReadFromFile(const FString& FullPath, FStructHexDualGraph& Out_Graph);
+
+	//Closed form counts: 6(R+1)^2 corners and 3(R+1)(3R+2) edges
+	static int64 GetCornerCount(int32 Range);
+	static int64 GetEdgeCount(int32 Range);
+	static int64 EstimateFileBytes(int32 Range);
+	//Graph and the fixed width rows it is compacted from
+	static int64 EstimateBuildMemory(int32 Range);
+
+	//Drops DUAL_GRAPH_NONE from rows of Width ids
+	static void CompactRows(const TArray64<uint32>& Rows, int32 Width, FStructHexCsr& Out_Csr);
+
+private:
+	//Ids of the keys owned by the ring outside the grid, DUAL_GRAPH_NONE where no tile of the grid touches the key
+	struct FOuterIds
+	{
+		TArray<uint32> Corners;
+		TArray<uint32> Edges;
+	};
+
+	static void NumberOuterKeys(int32 Range, FStructHexDualGraph& InOut_Graph, FOuterIds& Out_Ids);
+	static uint32 GetCornerId(const HexMath::TFeatureKey<int32>& Corner, int64 TileCount, const FOuterIds& Ids);
+	static uint32 GetEdgeId(const HexMath::TFeatureKey<int32>& Edge, int64 TileCount, const FOuterIds& Ids);
+	static uint32 GetTileId(const HexMath::FAxial& Hex, int32 Range);
+	static bool IsInGrid(const HexMath::FAxial& Hex, int32 Range);
+
+	//Fixed width rows, DUAL_GRAPH_NONE where the tile or the joining edge is outside the grid
+	static void FillEdgeRow(const HexMath::TFeatureKey<int32>& Edge, int32 Range, uint32* Out_Row);
+	static void FillCornerRow(const HexMath::TFeatureKey<int32>& Corner, int32 Range, int64 TileCount, const FOuterIds& Ids,
+		uint32* Out_Row);
+
+	static void FillUniformOffsets(FStructHexCsr& InOut_Csr, int64 RowCount, int32 Width);
+	static int64 GetCsrBytes(int64 RowCount, int64 IdCount);
+};
@@ -0,0 +1,140 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GridEstimateUtility.h"
+#include "StructDefine.h"
+#include "HexMath.h"
+
+GridEstimateUtility::GridEstimateUtility()
+{
+}
+
+GridEstimateUtility::~GridEstimateUtility()
+{
+}
+
+int64 GridEstimateUtility::GetTileCount(int32 Range)
+{
+	return HexMath::GetTileCount(Range);
+}
+
+int64 GridEstimateUtility::GetNeighborCount(int32 Range)
+{
+	return 3 * (int64)Range * (Range + 1);
+}
+
+int32 GridEstimateUtility::GetIntTextLength(int64 Value)
+{
+	int32 Length = Value < 0 ? 2 : 1;
+	uint64 Abs = Value < 0 ? (uint64)(-Value) : (uint64)Value;
+	while (Abs >= 10) {
+		Abs /= 10;
+		Length++;
+	}
+	return Length;
+}
+
+int32 GridEstimateUtility::GetFloatTextLength(double Value)
+{
+	//Two fractional digits at most, rounded half from zero, trailing zeros trimmed
+	int64 Hundredths = (int64)FMath::RoundHalfFromZero(FMath::Abs(Value) * 100.0);
+	int32 Length = GetIntTextLength(Hundredths / 100) + (Value < 0 && Hundredths != 0 ? 1 : 0);
+	int64 Fraction = Hundredths % 100;
+	if (Fraction != 0) {
+		Length += Fraction % 10 == 0 ? 2 : 3;
+	}
+	return Length;
+}
+
+double GridEstimateUtility::EstimateTileLineBytes(int32 Range, float TileSize)
+{
+	int64 TileCount = GetTileCount(Range);
+	int32 SampleCount = FMath::Min<int64>(ESTIMATE_SAMPLE_COUNT, TileCount);
+	double Bytes = 0.0;
+	for (int32 i = 0; i < SampleCount; i++)
+	{
+		HexMath::FAxial Hex = HexMath::SpiralIndexToAxial(GetSampleIndex(i, TileCount));
+		FVector2D Position = HexMath::AxialToPosition(Hex, TileSize);
+		//q,r|x,y
+		Bytes += GetIntTextLength(Hex.Q) + GetIntTextLength(Hex.R) + GetFloatTextLength(Position.X) + GetFloatTextLength(Position.Y) + 3;
+	}
+	return Bytes / SampleCount + GetLineEndBytes();
+}
+
+double GridEstimateUtility::EstimateTileIndicesLineBytes(int32 Range)
+{
+	int64 TileCount = GetTileCount(Range);
+	int32 SampleCount = FMath::Min<int64>(ESTIMATE_SAMPLE_COUNT, TileCount);
+	double Bytes = 0.0;
+	for (int32 i = 0; i < SampleCount; i++)
+	{
+		int64 Index = GetSampleIndex(i, TileCount);
+		HexMath::FAxial Hex = HexMath::SpiralIndexToAxial(Index);
+		//q,r|index
+		Bytes += GetIntTextLength(Hex.Q) + GetIntTextLength(Hex.R) + GetIntTextLength(Index) + 2;
+	}
+	return Bytes / SampleCount + GetLineEndBytes();
+}
+
+double GridEstimateUtility::EstimateNeighborLineBytes(int32 Range, int32 Radius)
+{
+	int64 TileCount = GetTileCount(Range);
+	int32 SampleCount = FMath::Min<int64>(ESTIMATE_SAMPLE_COUNT, TileCount);
+	double Bytes = 0.0;
+	for (int32 i = 0; i < SampleCount; i++)
+	{
+		HexMath::FAxial Center = HexMath::SpiralIndexToAxial(GetSampleIndex(i, TileCount));
+		for (const HexMath::FAxial& Hex : HexMath::Ring(Center, Radius))
+		{
+			Bytes += GetIntTextLength(Hex.Q) + GetIntTextLength(Hex.R);
+		}
+	}
+	//Comma inside every q,r and a space between two of them
+	int64 RingCount = 6 * (int64)Radius;
+	return Bytes / SampleCount + RingCount * 2 - 1 + GetLineEndBytes();
+}
+
+int64 GridEstimateUtility::EstimateTilesMemory(int32 Range, int32 NeighborRange, bool LowMemory)
+{
+	//Low memory mode streams tiles from their spiral index, only the neighbor ring offsets stay resident
+	if (LowMemory) {
+		return GetNeighborCount(NeighborRange) * sizeof(FIntPoint);
+	}
+
+	int64 TileCount = GetTileCount(Range);
+	int64 Bytes = GetAllocatedSlots(TileCount) * sizeof(FStructHexTileData);
+
+	//Every tile owns one neighbor array per radius, filled by Add
+	int64 PerTile = GetAllocatedSlots(NeighborRange) * sizeof(FStructHexTileNeighbors);
+	for (int32 Radius = 1; Radius <= NeighborRange; Radius++)
+	{
+		PerTile += GetAllocatedSlots(6 * (int64)Radius) * sizeof(FIntPoint);
+	}
+	Bytes += TileCount * PerTile;
+	return Bytes;
+}
+
+int32 GridEstimateUtility::GetLineEndBytes()
+{
+#if PLATFORM_WINDOWS
+	return 2;
+#else
+	return 1;
+#endif
+}
+
+int64 GridEstimateUtility::GetAllocatedSlots(int64 Count)
+{
+	//Follows the default TArray growth when elements are added one by one
+	int64 Slots = 0;
+	while (Slots < Count) {
+		Slots = Slots == 0 ? 4 : Slots + 1 + 3 * (Slots + 1) / 8 + 16;
+	}
+	return Slots;
+}
+
+int64 GridEstimateUtility::GetSampleIndex(int32 Sample, int64 TileCount)
+{
+	int32 SampleCount = FMath::Min<int64>(ESTIMATE_SAMPLE_COUNT, TileCount);
+	return SampleCount <= 1 ? 0 : Sample * (TileCount - 1) / (SampleCount - 1);
+}
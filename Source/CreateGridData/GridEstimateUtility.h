@@ -0,0 +1,39 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+//Number of tiles sampled along the spiral to estimate average line lengths
+#define ESTIMATE_SAMPLE_COUNT	4096
+
+/**
+ * Footprint estimation from the closed form counts of a hexagon grid:
+ * 1 + 3R(R+1) tiles and 6r neighbors on ring r.
+ */
+class CREATEGRIDDATA_API GridEstimateUtility
+{
+public:
+	GridEstimateUtility();
+	~GridEstimateUtility();
+
+	static int64 GetTileCount(int32 Range);
+	static int64 GetNeighborCount(int32 Range);
+
+	//Text length of the values as the Write* functions format them
+	static int32 GetIntTextLength(int64 Value);
+	static int32 GetFloatTextLength(double Value);
+
+	//Average bytes per line, including the line end
+	static double EstimateTileLineBytes(int32 Range, float TileSize);
+	static double EstimateTileIndicesLineBytes(int32 Range);
+	static double EstimateNeighborLineBytes(int32 Range, int32 Radius);
+
+	//Bytes of Tiles and per tile neighbor arrays
+	static int64 EstimateTilesMemory(int32 Range, int32 NeighborRange, bool LowMemory);
+
+private:
+	static int32 GetLineEndBytes();
+	static int64 GetAllocatedSlots(int64 Count);
+	static int64 GetSampleIndex(int32 Sample, int64 TileCount);
+};
@@ -0,0 +1,212 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GridFlowFieldUtility.h"
+#include "HexMappedFile.h"
+#include <Async/ParallelFor.h>
+
+#include <atomic>
+
+DEFINE_LOG_CATEGORY(HexFlow);
+
+GridFlowFieldUtility::GridFlowFieldUtility()
+{
+}
+
+GridFlowFieldUtility::~GridFlowFieldUtility()
+{
+}
+
+bool GridFlowFieldUtility::Build(const FStructHexTileGraph& Graph, const TArray<uint32>& Sources, const TArray64<uint8>* Costs,
+	FStructHexFlowField& Out_Field)
+{
+	Out_Field = FStructHexFlowField();
+	const int64 TileCount = Graph.GetTileCount();
+	if (Costs != nullptr && Costs->Num() != TileCount) {
+		UE_LOG(HexFlow, Warning, TEXT("%lld costs do not match %lld tiles."), Costs->Num(), TileCount);
+		return false;
+	}
+	Out_Field.Distances.Init(FLOW_UNREACHED, TileCount);
+
+	TArray<TArray<uint32>> Buckets;
+	Buckets.SetNum(FLOW_BUCKETS);
+	for (uint32 Source : Sources)
+	{
+		if (Source >= TileCount) {
+			UE_LOG(HexFlow, Warning, TEXT("Source %u is no tile of %lld."), Source, TileCount);
+			Out_Field = FStructHexFlowField();
+			return false;
+		}
+		if (Out_Field.Distances[Source] != 0) {
+			Out_Field.Distances[Source] = 0;
+			Out_Field.Sources.Add(Source);
+			Buckets[0].Add(Source);
+		}
+	}
+
+	//A tile is queued again whenever its distance drops, the entries it left behind are skipped by the distance check
+	int64 Pending = Buckets[0].Num();
+	TArray<uint32> Frontier;
+	TArray<TArray<TPair<uint32, uint32>>> Reached;
+	for (uint32 Distance = 0; Pending > 0; Distance++)
+	{
+		TArray<uint32>& Bucket = Buckets[Distance % FLOW_BUCKETS];
+		Pending -= Bucket.Num();
+		Frontier.Reset();
+		for (uint32 Tile : Bucket)
+		{
+			if (Out_Field.Distances[Tile] == Distance) {
+				Frontier.Add(Tile);
+			}
+		}
+		Bucket.Reset();
+		if (Frontier.Num() == 0) {
+			continue;
+		}
+
+		//Settled tiles are below Distance and every offer is above it, so only unsettled tiles ever change
+		int32 ChunkCount = (Frontier.Num() + FLOW_CHUNK_SIZE - 1) / FLOW_CHUNK_SIZE;
+		Reached.SetNum(ChunkCount);
+		ParallelFor(ChunkCount, [&Graph, &Frontier, &Reached, &Out_Field, Costs, Distance](int32 ChunkIndex) {
+			TArray<TPair<uint32, uint32>>& Lowered = Reached[ChunkIndex];
+			Lowered.Reset();
+			int32 End = FMath::Min((ChunkIndex + 1) * FLOW_CHUNK_SIZE, Frontier.Num());
+			for (int32 i = ChunkIndex * FLOW_CHUNK_SIZE; i < End; i++)
+			{
+				uint32 Tile = Frontier[i];
+				for (int64 j = Graph.Neighbors.Offsets[Tile]; j < Graph.Neighbors.Offsets[Tile + 1]; j++)
+				{
+					uint32 Neighbor = Graph.Neighbors.Ids[j];
+					uint32 Cost = Costs != nullptr ? (*Costs)[Neighbor] : 1;
+					if (Cost == 0) {
+						continue;
+					}
+					uint32 Offer = Distance + Cost;
+					std::atomic_ref<uint32> Slot(Out_Field.Distances[Neighbor]);
+					uint32 Current = Slot.load(std::memory_order_relaxed);
+					while (Offer < Current) {
+						if (Slot.compare_exchange_weak(Current, Offer, std::memory_order_relaxed)) {
+							Lowered.Emplace(Neighbor, Offer);
+							break;
+						}
+					}
+				}
+			}
+		}, ChunkCount == 1 ? EParallelForFlags::ForceSingleThread : EParallelForFlags::None);
+
+		for (int32 i = 0; i < ChunkCount; i++)
+		{
+			for (const TPair<uint32, uint32>& Entry : Reached[i])
+			{
+				Buckets[Entry.Value % FLOW_BUCKETS].Add(Entry.Key);
+			}
+			Pending += Reached[i].Num();
+		}
+	}
+
+	BuildDirections(Graph, Out_Field);
+	return true;
+}
+
+bool GridFlowFieldUtility::WriteToFile(const FStructHexFlowField& Field, const FString& FullPath)
+{
+	uint32 Header[4] = { FLOW_FIELD_MAGIC, FLOW_FIELD_VERSION, (uint32)Field.Sources.Num(), 0 };
+	int64 TileCount = Field.GetTileCount();
+	TArray<TPair<const void*, int64>> Sections;
+	Sections.Emplace(Header, sizeof(Header));
+	Sections.Emplace(&TileCount, sizeof(TileCount));
+	Sections.Emplace(Field.Sources.GetData(), Field.Sources.Num() * sizeof(uint32));
+	Sections.Emplace(Field.Distances.GetData(), Field.Distances.Num() * sizeof(uint32));
+	Sections.Emplace(Field.Directions.GetData(), Field.Directions.Num() * sizeof(uint8));
+
+	FHexMappedFile File;
+	if (!File.Open(FullPath, FHexMappedFile::GetSectionsBytes(Sections))) {
+		return false;
+	}
+	File.WriteSections(Sections);
+	return File.Commit();
+}
+
+bool GridFlowFieldUtility::ReadFromFile(const FString& FullPath, FStructHexFlowField& Out_Field)
+{
+	Out_Field = FStructHexFlowField();
+	FHexFileReader Reader;
+	if (!Reader.Open(FullPath)) {
+		UE_LOG(HexFlow, Warning, TEXT("Can not open %s."), *FullPath);
+		return false;
+	}
+
+	uint32 Header[4];
+	int64 TileCount;
+	if (!Reader.ReadBytes(Header, sizeof(Header)) || !Reader.ReadBytes(&TileCount, sizeof(TileCount))
+		|| Header[0] != FLOW_FIELD_MAGIC || Header[1] != FLOW_FIELD_VERSION) {
+		UE_LOG(HexFlow, Warning, TEXT("%s is not a flow field of version %d."), *FullPath, FLOW_FIELD_VERSION);
+		return false;
+	}
+	if (TileCount < 0 || Header[2] > TileCount || Reader.GetSize() != EstimateFileBytes(TileCount, (int32)Header[2])) {
+		UE_LOG(HexFlow, Warning, TEXT("Flow field %s is truncated or damaged."), *FullPath);
+		return false;
+	}
+
+	if (!Reader.ReadArray(Out_Field.Sources, Header[2]) || !Reader.ReadArray(Out_Field.Distances, TileCount)
+		|| !Reader.ReadArray(Out_Field.Directions, TileCount)) {
+		UE_LOG(HexFlow, Warning, TEXT("Flow field %s is truncated or damaged."), *FullPath);
+		Out_Field = FStructHexFlowField();
+		return false;
+	}
+	return true;
+}
+
+int64 GridFlowFieldUtility::EstimateFileBytes(int64 TileCount, int32 SourceCount)
+{
+	return sizeof(uint32) * 4 + sizeof(int64) + SourceCount * (int64)sizeof(uint32) + TileCount * (int64)(sizeof(uint32) + sizeof(uint8));
+}
+
+int64 GridFlowFieldUtility::EstimateBuildMemory(int64 TileCount, int32 GridRange)
+{
+	//Loaded tiles table, tile graph with its rows of 6, costs and the field
+	int64 TableBytes = TileCount * (int64)(sizeof(FIntPoint) + sizeof(FVector2D));
+	int64 GraphBytes = TileCount * (int64)(sizeof(FIntPoint) + sizeof(int64) + sizeof(uint32) * 12)
+		+ HexMath::GetTileCount(GridRange) * (int64)sizeof(uint32);
+	int64 FieldBytes = TileCount * (int64)(sizeof(uint8) + sizeof(uint32) + sizeof(uint8));
+	//Queued tiles, every tile is queued once per drop of its distance but rarely more than twice
+	int64 BucketBytes = TileCount * (int64)(sizeof(uint32) * 2 + sizeof(TPair<uint32, uint32>));
+	return TableBytes + GraphBytes + FieldBytes + BucketBytes;
+}
+
+uint32 GridFlowFieldUtility::GetNextTile(const FStructHexTileGraph& Graph, const FStructHexFlowField& Field, uint32 Tile)
+{
+	uint8 Direction = Field.Directions[Tile];
+	if (Direction == FLOW_NO_DIRECTION) {
+		return HPA_NONE;
+	}
+	return Graph.FindTile(HexMath::Neighbor(HexMath::FAxial(Graph.AxialCoords[Tile]), Direction).ToIntPoint());
+}
+
+void GridFlowFieldUtility::BuildDirections(const FStructHexTileGraph& Graph, FStructHexFlowField& InOut_Field)
+{
+	//Leaving a tile costs the same towards every side, so the neighbor of the lowest distance is a step of a cheapest path
+	const int64 TileCount = Graph.GetTileCount();
+	InOut_Field.Directions.SetNumUninitialized(TileCount);
+	int32 ChunkCount = (int32)((TileCount + FLOW_TILE_CHUNK_SIZE - 1) / FLOW_TILE_CHUNK_SIZE);
+	ParallelFor(ChunkCount, [&Graph, &InOut_Field, TileCount](int32 ChunkIndex) {
+		int64 End = FMath::Min((int64)(ChunkIndex + 1) * FLOW_TILE_CHUNK_SIZE, TileCount);
+		for (int64 i = (int64)ChunkIndex * FLOW_TILE_CHUNK_SIZE; i < End; i++)
+		{
+			uint8 Direction = FLOW_NO_DIRECTION;
+			uint32 Best = InOut_Field.Distances[i];
+			if (Best != 0 && Best != FLOW_UNREACHED) {
+				for (int64 j = Graph.Neighbors.Offsets[i]; j < Graph.Neighbors.Offsets[i + 1]; j++)
+				{
+					uint32 Neighbor = Graph.Neighbors.Ids[j];
+					if (InOut_Field.Distances[Neighbor] < Best) {
+						Best = InOut_Field.Distances[Neighbor];
+						HexMath::FAxial Step = HexMath::FAxial(Graph.AxialCoords[Neighbor]) - HexMath::FAxial(Graph.AxialCoords[i]);
+						Direction = (uint8)HexMath::DirectionIndex(Step);
+					}
+				}
+			}
+			InOut_Field.Directions[i] = Direction;
+		}
+	});
+}
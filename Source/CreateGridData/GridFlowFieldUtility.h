@@ -0,0 +1,64 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GridHpaUtility.h"
+
+DECLARE_LOG_CATEGORY_EXTERN(HexFlow, Log, All);
+
+//'HXFF'
+#define FLOW_FIELD_MAGIC	0x46465848
+#define FLOW_FIELD_VERSION	1
+//Distance of tiles no source reaches
+#define FLOW_UNREACHED	MAX_uint32
+//Direction of sources and of tiles no source reaches
+#define FLOW_NO_DIRECTION	0xFF
+//Frontier tiles handed to one ParallelFor task, a smaller frontier is expanded on the calling thread
+#define FLOW_CHUNK_SIZE	2048
+//Tile costs are 1 .. 255, so pending distances never span more buckets than this
+#define FLOW_BUCKETS	256
+//Tiles handed to one ParallelFor task of the direction pass
+#define FLOW_TILE_CHUNK_SIZE	(1 << 16)
+
+//Field towards the nearest of its sources, indexed by tile index
+struct FStructHexFlowField
+{
+	TArray<uint32> Sources;
+	//Sum of the tile costs of the cheapest path to a source, the tile included and the source not
+	TArray64<uint32> Distances;
+	//Hex direction of the next step, see HexMath::Direction
+	TArray64<uint8> Directions;
+
+	int64 GetTileCount() const { return Distances.Num(); }
+};
+
+/**
+ * Distance and flow direction fields from a set of source tiles, so agents sharing a destination read
+ * their next step instead of searching a path each. Costs are per tile and paid on leaving it.
+ * Dial's algorithm: tiles wait in FLOW_BUCKETS buckets by distance, every bucket is final when it is
+ * reached and is expanded as one frontier with ParallelFor, distances are lowered with an atomic min.
+ * With unit costs that is a level synchronous breadth first search.
+ * File: header (magic, version, source count, reserved), tile count as int64, sources as uint32,
+ * distances as uint32, directions as uint8.
+ */
+class CREATEGRIDDATA_API GridFlowFieldUtility
+{
+public:
+	GridFlowFieldUtility();
+	~GridFlowFieldUtility();
+
+	//Costs holds the cost of every tile with 0 for impassable, null costs 1 everywhere
+	static bool Build(const FStructHexTileGraph& Graph, const TArray<uint32>& Sources, const TArray64<uint8>* Costs,
+		FStructHexFlowField& Out_Field);
+	static bool WriteToFile(const FStructHexFlowField& Field, const FString& FullPath);
+	static bool ReadFromFile(const FString& FullPath, FStructHexFlowField& Out_Field);
+	static int64 EstimateFileBytes(int64 TileCount, int32 SourceCount);
+	static int64 EstimateBuildMemory(int64 TileCount, int32 GridRange);
+
+	//Tile the direction of Tile points to, HPA_NONE at a source and where no source is reachable
+	static uint32 GetNextTile(const FStructHexTileGraph& Graph, const FStructHexFlowField& Field, uint32 Tile);
+
+private:
+	static void BuildDirections(const FStructHexTileGraph& Graph, FStructHexFlowField& InOut_Field);
+};
@@ -0,0 +1,683 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GridHpaUtility.h"
+#include "GridDataLoader.h"
+#include "HexMappedFile.h"
+#include <Algo/BinarySearch.h>
+#include <Algo/Reverse.h>
+#include <Algo/Unique.h>
+#include <Async/ParallelFor.h>
+
+DEFINE_LOG_CATEGORY(HexHpa);
+
+//Tiles handed to one ParallelFor task
+#define HPA_CHUNK_SIZE	(1 << 16)
+
+//Open list entry of both searches, lowest estimate first and the deeper one on ties
+struct FHexOpenEntry
+{
+	uint32 F;
+	uint32 G;
+	uint32 Node;
+};
+
+static bool OpenEntryLess(const FHexOpenEntry& A, const FHexOpenEntry& B)
+{
+	return A.F < B.F || (A.F == B.F && A.G > B.G);
+}
+
+uint32 FStructHexTileGraph::FindTile(const FIntPoint& Hex) const
+{
+	HexMath::FAxial Axial(Hex);
+	if (HexMath::Length(Axial) > GridRange) {
+		return HPA_NONE;
+	}
+	return SpiralTiles[HexMath::AxialToSpiralIndex(Axial)];
+}
+
+GridHpaUtility::GridHpaUtility()
+{
+}
+
+GridHpaUtility::~GridHpaUtility()
+{
+}
+
+bool GridHpaUtility::BuildTileGraph(const TArray64<FIntPoint>& AxialCoords, const FStructHexNeighborTable* N1,
+	const TBitArray<>* Blocked, FStructHexTileGraph& Out_Graph)
+{
+	Out_Graph = FStructHexTileGraph();
+	const int64 TileCount = AxialCoords.Num();
+	if (TileCount >= HPA_NONE || (N1 != nullptr && N1->GetLineCount() != TileCount) || (Blocked != nullptr && Blocked->Num() != TileCount)) {
+		UE_LOG(HexHpa, Warning, TEXT("Tile graph input does not match %lld tiles."), TileCount);
+		return false;
+	}
+
+	Out_Graph.AxialCoords = AxialCoords;
+	for (const FIntPoint& Hex : AxialCoords)
+	{
+		Out_Graph.GridRange = FMath::Max(Out_Graph.GridRange, HexMath::Length(HexMath::FAxial(Hex)));
+	}
+	Out_Graph.SpiralTiles.Init(HPA_NONE, HexMath::GetTileCount(Out_Graph.GridRange));
+	int32 ChunkCount = (int32)((TileCount + HPA_CHUNK_SIZE - 1) / HPA_CHUNK_SIZE);
+	ParallelFor(ChunkCount, [&Out_Graph, TileCount](int32 ChunkIndex) {
+		int64 End = FMath::Min((int64)(ChunkIndex + 1) * HPA_CHUNK_SIZE, TileCount);
+		for (int64 i = (int64)ChunkIndex * HPA_CHUNK_SIZE; i < End; i++)
+		{
+			Out_Graph.SpiralTiles[HexMath::AxialToSpiralIndex(HexMath::FAxial(Out_Graph.AxialCoords[i]))] = (uint32)i;
+		}
+	});
+
+	//Rows of 6, compacted like the dual graph. A ring 1 line never lists more than 6 neighbors
+	TArray64<uint32> Rows;
+	Rows.SetNumUninitialized(TileCount * 6);
+	ParallelFor(ChunkCount, [&Out_Graph, &Rows, N1, Blocked, TileCount](int32 ChunkIndex) {
+		auto IsOpen = [Blocked](uint32 Tile) {
+			return Tile != HPA_NONE && (Blocked == nullptr || !(*Blocked)[Tile]);
+		};
+		int64 End = FMath::Min((int64)(ChunkIndex + 1) * HPA_CHUNK_SIZE, TileCount);
+		for (int64 i = (int64)ChunkIndex * HPA_CHUNK_SIZE; i < End; i++)
+		{
+			uint32* Row = &Rows[i * 6];
+			for (int32 j = 0; j < 6; j++)
+			{
+				Row[j] = HPA_NONE;
+			}
+			if (!IsOpen((uint32)i)) {
+				continue;
+			}
+			if (N1 != nullptr) {
+				int64 Begin = N1->Offsets[i];
+				int32 Count = (int32)FMath::Min<int64>(N1->Offsets[i + 1] - Begin, 6);
+				for (int32 j = 0; j < Count; j++)
+				{
+					uint32 Tile = Out_Graph.FindTile(N1->Tiles[Begin + j]);
+					Row[j] = IsOpen(Tile) ? Tile : HPA_NONE;
+				}
+				continue;
+			}
+			HexMath::FAxial Hex(Out_Graph.AxialCoords[i]);
+			for (int32 j = 0; j < 6; j++)
+			{
+				uint32 Tile = Out_Graph.FindTile(HexMath::Neighbor(Hex, j).ToIntPoint());
+				Row[j] = IsOpen(Tile) ? Tile : HPA_NONE;
+			}
+		}
+	});
+	GridDualGraphUtility::CompactRows(Rows, 6, Out_Graph.Neighbors);
+	return true;
+}
+
+bool GridHpaUtility::Build(const FStructHexTileGraph& TileGraph, int32 ClusterRadius, FStructHexHpaGraph& Out_Graph)
+{
+	Out_Graph = FStructHexHpaGraph();
+	if (ClusterRadius < 1) {
+		UE_LOG(HexHpa, Warning, TEXT("Cluster radius %d is below 1."), ClusterRadius);
+		return false;
+	}
+	Out_Graph.ClusterRadius = ClusterRadius;
+
+	FClusterTiles Clusters;
+	AssignClusters(TileGraph, ClusterRadius, Out_Graph, Clusters);
+	const int32 ClusterCount = (int32)Out_Graph.ClusterCount;
+
+	TArray<TArray<TPair<uint32, uint32>>> ClusterPairs;
+	ClusterPairs.SetNum(ClusterCount);
+	ParallelFor(ClusterCount, [&TileGraph, &Out_Graph, &Clusters, &ClusterPairs](int32 Cluster) {
+		FindEntrances(TileGraph, Out_Graph, Clusters, (uint32)Cluster, ClusterPairs[Cluster]);
+	}, EParallelForFlags::Unbalanced);
+
+	//Nodes sorted by cluster, then tile
+	TArray64<uint64> NodeKeys;
+	for (const TArray<TPair<uint32, uint32>>& Pairs : ClusterPairs)
+	{
+		for (const TPair<uint32, uint32>& Pair : Pairs)
+		{
+			NodeKeys.Add(((uint64)Out_Graph.TileClusters[Pair.Key] << 32) | Pair.Key);
+			NodeKeys.Add(((uint64)Out_Graph.TileClusters[Pair.Value] << 32) | Pair.Value);
+		}
+	}
+	NodeKeys.Sort();
+	NodeKeys.SetNum(Algo::Unique(NodeKeys));
+	Out_Graph.NodeTiles.SetNumUninitialized(NodeKeys.Num());
+	Out_Graph.ClusterNodeOffsets.SetNumZeroed(ClusterCount + 1);
+	for (int64 i = 0; i < NodeKeys.Num(); i++)
+	{
+		Out_Graph.NodeTiles[i] = (uint32)NodeKeys[i];
+		Out_Graph.ClusterNodeOffsets[(NodeKeys[i] >> 32) + 1]++;
+	}
+	for (int32 i = 0; i < ClusterCount; i++)
+	{
+		Out_Graph.ClusterNodeOffsets[i + 1] += Out_Graph.ClusterNodeOffsets[i];
+	}
+
+	//Edges across the border first, then every cluster joins its own nodes
+	const int64 NodeCount = Out_Graph.GetNodeCount();
+	TArray<TArray<TPair<uint32, uint32>>> NodeRows;
+	NodeRows.SetNum(NodeCount);
+	for (const TArray<TPair<uint32, uint32>>& Pairs : ClusterPairs)
+	{
+		for (const TPair<uint32, uint32>& Pair : Pairs)
+		{
+			uint32 NodeA = FindNode(Out_Graph, Pair.Key);
+			uint32 NodeB = FindNode(Out_Graph, Pair.Value);
+			NodeRows[NodeA].Emplace(NodeB, 1);
+			NodeRows[NodeB].Emplace(NodeA, 1);
+		}
+	}
+	ParallelFor(ClusterCount, [&TileGraph, &Out_Graph, &Clusters, &NodeRows](int32 Cluster) {
+		int64 Begin = Out_Graph.ClusterNodeOffsets[Cluster];
+		int64 End = Out_Graph.ClusterNodeOffsets[Cluster + 1];
+		TArray<uint32> Queue;
+		TArray<uint32> Steps;
+		for (int64 i = Begin; i < End; i++)
+		{
+			SearchCluster(TileGraph, Out_Graph, Clusters, Out_Graph.NodeTiles[i], Queue, Steps);
+			for (int64 j = Begin; j < End; j++)
+			{
+				uint32 Cost = Steps[Clusters.LocalIndices[Out_Graph.NodeTiles[j]]];
+				if (j != i && Cost != HPA_NONE) {
+					NodeRows[i].Emplace((uint32)j, Cost);
+				}
+			}
+		}
+	}, EParallelForFlags::Unbalanced);
+
+	Out_Graph.Edges.Offsets.SetNumUninitialized(NodeCount + 1);
+	Out_Graph.Edges.Offsets[0] = 0;
+	for (int64 i = 0; i < NodeCount; i++)
+	{
+		Out_Graph.Edges.Offsets[i + 1] = Out_Graph.Edges.Offsets[i] + NodeRows[i].Num();
+	}
+	Out_Graph.Edges.Ids.SetNumUninitialized(Out_Graph.Edges.Offsets[NodeCount]);
+	Out_Graph.EdgeCosts.SetNumUninitialized(Out_Graph.Edges.Offsets[NodeCount]);
+	for (int64 i = 0; i < NodeCount; i++)
+	{
+		int64 Next = Out_Graph.Edges.Offsets[i];
+		for (const TPair<uint32, uint32>& Edge : NodeRows[i])
+		{
+			Out_Graph.Edges.Ids[Next] = Edge.Key;
+			Out_Graph.EdgeCosts[Next++] = Edge.Value;
+		}
+	}
+
+	UE_LOG(HexHpa, Log, TEXT("HPA graph of %lld tiles: %lld clusters, %lld nodes, %lld edges."), TileGraph.GetTileCount(),
+		Out_Graph.ClusterCount, NodeCount, Out_Graph.Edges.Ids.Num());
+	return true;
+}
+
+bool GridHpaUtility::WriteToFile(const FStructHexHpaGraph& Graph, const FString& FullPath)
+{
+	uint32 Header[4] = { HPA_GRAPH_MAGIC, HPA_GRAPH_VERSION, (uint32)Graph.ClusterRadius, 0 };
+	int64 Counts[4] = { Graph.TileClusters.Num(), Graph.ClusterCount, Graph.GetNodeCount(), Graph.Edges.Ids.Num() };
+	TArray<TPair<const void*, int64>> Sections;
+	Sections.Emplace(Header, sizeof(Header));
+	Sections.Emplace(Counts, sizeof(Counts));
+	Sections.Emplace(Graph.TileClusters.GetData(), Graph.TileClusters.Num() * sizeof(uint32));
+	Sections.Emplace(Graph.NodeTiles.GetData(), Graph.NodeTiles.Num() * sizeof(uint32));
+	Sections.Emplace(Graph.ClusterNodeOffsets.GetData(), Graph.ClusterNodeOffsets.Num() * sizeof(int64));
+	Sections.Emplace(Graph.Edges.Offsets.GetData(), Graph.Edges.Offsets.Num() * sizeof(int64));
+	Sections.Emplace(Graph.Edges.Ids.GetData(), Graph.Edges.Ids.Num() * sizeof(uint32));
+	Sections.Emplace(Graph.EdgeCosts.GetData(), Graph.EdgeCosts.Num() * sizeof(uint32));
+
+	FHexMappedFile File;
+	if (!File.Open(FullPath, FHexMappedFile::GetSectionsBytes(Sections))) {
+		return false;
+	}
+	File.WriteSections(Sections);
+	return File.Commit();
+}
+
+bool GridHpaUtility::ReadFromFile(const FString& FullPath, FStructHexHpaGraph& Out_Graph)
+{
+	Out_Graph = FStructHexHpaGraph();
+	FHexFileReader Reader;
+	if (!Reader.Open(FullPath)) {
+		UE_LOG(HexHpa, Warning, TEXT("Can not open %s."), *FullPath);
+		return false;
+	}
+
+	uint32 Header[4];
+	int64 Counts[4];
+	if (!Reader.ReadBytes(Header, sizeof(Header)) || Header[0] != HPA_GRAPH_MAGIC || Header[1] != HPA_GRAPH_VERSION
+		|| !Reader.ReadBytes(Counts, sizeof(Counts))) {
+		UE_LOG(HexHpa, Warning, TEXT("%s is not an HPA graph of version %d."), *FullPath, HPA_GRAPH_VERSION);
+		return false;
+	}
+	Out_Graph.ClusterRadius = (int32)Header[2];
+	Out_Graph.ClusterCount = Counts[1];
+
+	if (!Reader.ReadArray(Out_Graph.TileClusters, Counts[0]) || !Reader.ReadArray(Out_Graph.NodeTiles, Counts[2])
+		|| !Reader.ReadArray(Out_Graph.ClusterNodeOffsets, Counts[1] + 1) || !Reader.ReadArray(Out_Graph.Edges.Offsets, Counts[2] + 1)
+		|| !Reader.ReadArray(Out_Graph.Edges.Ids, Counts[3]) || !Reader.ReadArray(Out_Graph.EdgeCosts, Counts[3])
+		|| Out_Graph.ClusterNodeOffsets.Last() != Counts[2] || Out_Graph.Edges.Offsets.Last() != Counts[3]) {
+		UE_LOG(HexHpa, Warning, TEXT("HPA graph %s is truncated or damaged."), *FullPath);
+		Out_Graph = FStructHexHpaGraph();
+		return false;
+	}
+	return true;
+}
+
+int64 GridHpaUtility::EstimateFileBytes(int64 TileCount, int32 ClusterRadius)
+{
+	//Two nodes per cluster side, each joined across the border and to the other 11 of its cluster
+	int64 ClusterCount = TileCount / HexMath::GetTileCount(FMath::Max(ClusterRadius, 1)) + 1;
+	int64 NodeCount = ClusterCount * 12;
+	int64 EdgeCount = NodeCount * 12;
+	return sizeof(uint32) * 4 + sizeof(int64) * 4 + TileCount * (int64)sizeof(uint32) + NodeCount * (int64)sizeof(uint32)
+		+ (ClusterCount + NodeCount + 2) * (int64)sizeof(int64) + EdgeCount * (int64)sizeof(uint32) * 2;
+}
+
+int64 GridHpaUtility::EstimateBuildMemory(int64 TileCount, int32 GridRange)
+{
+	//Loaded tiles table, tile graph with its rows of 6, cluster coords, ids and lists
+	int64 TableBytes = TileCount * (int64)(sizeof(FIntPoint) + sizeof(FVector2D));
+	int64 GraphBytes = TileCount * (int64)(sizeof(FIntPoint) + sizeof(int64) + sizeof(uint32) * 12)
+		+ HexMath::GetTileCount(GridRange) * (int64)sizeof(uint32);
+	int64 ClusterBytes = TileCount * (int64)(sizeof(FIntPoint) + sizeof(uint32) * 3);
+	return TableBytes + GraphBytes + ClusterBytes;
+}
+
+void GridHpaUtility::FindPathFlat(const FStructHexTileGraph& TileGraph, uint32 Start, uint32 Goal, FStructHexPathScratch& InOut_Scratch,
+	FStructHexPathResult& Out_Result)
+{
+	Out_Result = FStructHexPathResult();
+	if (Start >= TileGraph.GetTileCount() || Goal >= TileGraph.GetTileCount()) {
+		return;
+	}
+	BeginSearch(InOut_Scratch, TileGraph.GetTileCount());
+	const HexMath::FAxial GoalHex(TileGraph.AxialCoords[Goal]);
+	auto Heuristic = [&TileGraph, &GoalHex](uint32 Tile) {
+		return (uint32)HexMath::Distance(HexMath::FAxial(TileGraph.AxialCoords[Tile]), GoalHex);
+	};
+
+	TArray<FHexOpenEntry> Open;
+	InOut_Scratch.Costs[Start] = 0;
+	InOut_Scratch.Stamps[Start] = InOut_Scratch.Generation;
+	Open.HeapPush(FHexOpenEntry{ Heuristic(Start), 0, Start }, OpenEntryLess);
+	while (Open.Num() > 0)
+	{
+		FHexOpenEntry Entry;
+		Open.HeapPop(Entry, OpenEntryLess, EAllowShrinking::No);
+		if (Entry.G != InOut_Scratch.Costs[Entry.Node]) {
+			continue;
+		}
+		Out_Result.Expanded++;
+		if (Entry.Node == Goal) {
+			Out_Result.Found = true;
+			Out_Result.Cost = Entry.G;
+			return;
+		}
+		for (int64 i = TileGraph.Neighbors.Offsets[Entry.Node]; i < TileGraph.Neighbors.Offsets[Entry.Node + 1]; i++)
+		{
+			uint32 Next = TileGraph.Neighbors.Ids[i];
+			uint32 G = Entry.G + 1;
+			if (InOut_Scratch.Stamps[Next] != InOut_Scratch.Generation || G < InOut_Scratch.Costs[Next]) {
+				InOut_Scratch.Stamps[Next] = InOut_Scratch.Generation;
+				InOut_Scratch.Costs[Next] = G;
+				Open.HeapPush(FHexOpenEntry{ G + Heuristic(Next), G, Next }, OpenEntryLess);
+			}
+		}
+	}
+}
+
+void GridHpaUtility::FindPathAbstract(const FStructHexTileGraph& TileGraph, const FStructHexHpaGraph& Graph, uint32 Start, uint32 Goal,
+	FStructHexPathScratch& InOut_Scratch, FStructHexPathResult& Out_Result)
+{
+	Out_Result = FStructHexPathResult();
+	if (Start >= TileGraph.GetTileCount() || Goal >= TileGraph.GetTileCount()) {
+		return;
+	}
+	if (Start == Goal) {
+		Out_Result.Found = true;
+		Out_Result.Waypoints.Add(Start);
+		return;
+	}
+
+	TArray<uint32> StartSteps;
+	TArray<uint32> GoalSteps;
+	uint32 DirectSteps;
+	uint32 Unused;
+	ReachEntrances(TileGraph, Graph, Start, Goal, InOut_Scratch, StartSteps, DirectSteps);
+	ReachEntrances(TileGraph, Graph, Goal, HPA_NONE, InOut_Scratch, GoalSteps, Unused);
+
+	//Abstract nodes and a virtual goal after them, HPA_NONE as parent stands for the start
+	const uint32 GoalNode = (uint32)Graph.GetNodeCount();
+	const int64 StartBase = Graph.ClusterNodeOffsets[Graph.TileClusters[Start]];
+	const int64 GoalBase = Graph.ClusterNodeOffsets[Graph.TileClusters[Goal]];
+	const HexMath::FAxial GoalHex(TileGraph.AxialCoords[Goal]);
+	auto Heuristic = [&TileGraph, &Graph, &GoalHex, GoalNode](uint32 Node) {
+		return Node == GoalNode ? 0 : (uint32)HexMath::Distance(HexMath::FAxial(TileGraph.AxialCoords[Graph.NodeTiles[Node]]), GoalHex);
+	};
+	BeginSearch(InOut_Scratch, GoalNode + 1);
+	TArray<FHexOpenEntry> Open;
+	auto Relax = [&InOut_Scratch, &Open, &Heuristic](uint32 Node, uint32 G, uint32 Parent) {
+		if (InOut_Scratch.Stamps[Node] != InOut_Scratch.Generation || G < InOut_Scratch.Costs[Node]) {
+			InOut_Scratch.Stamps[Node] = InOut_Scratch.Generation;
+			InOut_Scratch.Costs[Node] = G;
+			InOut_Scratch.Parents[Node] = Parent;
+			Open.HeapPush(FHexOpenEntry{ G + Heuristic(Node), G, Node }, OpenEntryLess);
+		}
+	};
+
+	if (DirectSteps != HPA_NONE) {
+		Relax(GoalNode, DirectSteps, HPA_NONE);
+	}
+	for (int32 i = 0; i < StartSteps.Num(); i++)
+	{
+		if (StartSteps[i] != HPA_NONE) {
+			Relax((uint32)(StartBase + i), StartSteps[i], HPA_NONE);
+		}
+	}
+
+	while (Open.Num() > 0)
+	{
+		FHexOpenEntry Entry;
+		Open.HeapPop(Entry, OpenEntryLess, EAllowShrinking::No);
+		if (Entry.G != InOut_Scratch.Costs[Entry.Node]) {
+			continue;
+		}
+		Out_Result.Expanded++;
+		if (Entry.Node == GoalNode) {
+			Out_Result.Found = true;
+			Out_Result.Cost = Entry.G;
+			Out_Result.Waypoints.Add(Goal);
+			for (uint32 Node = InOut_Scratch.Parents[GoalNode]; Node != HPA_NONE; Node = InOut_Scratch.Parents[Node])
+			{
+				Out_Result.Waypoints.Add(Graph.NodeTiles[Node]);
+			}
+			Out_Result.Waypoints.Add(Start);
+			Algo::Reverse(Out_Result.Waypoints);
+			return;
+		}
+
+		int64 GoalLocal = Entry.Node - GoalBase;
+		if (GoalLocal >= 0 && GoalLocal < GoalSteps.Num() && GoalSteps[GoalLocal] != HPA_NONE) {
+			Relax(GoalNode, Entry.G + GoalSteps[GoalLocal], Entry.Node);
+		}
+		for (int64 i = Graph.Edges.Offsets[Entry.Node]; i < Graph.Edges.Offsets[Entry.Node + 1]; i++)
+		{
+			Relax(Graph.Edges.Ids[i], Entry.G + Graph.EdgeCosts[i], Entry.Node);
+		}
+	}
+}
+
+FIntPoint GridHpaUtility::GetClusterCoord(const FIntPoint& Hex, int32 Radius)
+{
+	//Solve Hex = i A + j B, the super hex holding Hex is centered on a lattice point next to the rounded solution
+	const int64 N = Radius;
+	const double Det = (double)(3 * N * N + 3 * N + 1);
+	int32 I = FMath::RoundToInt32((Hex.X * (N + 1) - Hex.Y * N) / Det);
+	int32 J = FMath::RoundToInt32((Hex.X * N + Hex.Y * (2 * N + 1)) / Det);
+	for (int32 DI = -1; DI <= 1; DI++)
+	{
+		for (int32 DJ = -1; DJ <= 1; DJ++)
+		{
+			int64 CenterQ = (int64)(I + DI) * (2 * N + 1) + (int64)(J + DJ) * N;
+			int64 CenterR = -(int64)(I + DI) * N + (int64)(J + DJ) * (N + 1);
+			if (HexMath::Length(HexMath::TAxial<int64>(Hex.X - CenterQ, Hex.Y - CenterR)) <= N) {
+				return FIntPoint(I + DI, J + DJ);
+			}
+		}
+	}
+	checkNoEntry();
+	return FIntPoint(I, J);
+}
+
+void GridHpaUtility::AssignClusters(const FStructHexTileGraph& TileGraph, int32 ClusterRadius, FStructHexHpaGraph& Out_Graph,
+	FClusterTiles& Out_Clusters)
+{
+	const int64 TileCount = TileGraph.GetTileCount();
+	int32 ChunkCount = (int32)((TileCount + HPA_CHUNK_SIZE - 1) / HPA_CHUNK_SIZE);
+	TArray64<FIntPoint> Coords;
+	Coords.SetNumUninitialized(TileCount);
+	ParallelFor(ChunkCount, [&TileGraph, &Coords, ClusterRadius, TileCount](int32 ChunkIndex) {
+		int64 End = FMath::Min((int64)(ChunkIndex + 1) * HPA_CHUNK_SIZE, TileCount);
+		for (int64 i = (int64)ChunkIndex * HPA_CHUNK_SIZE; i < End; i++)
+		{
+			Coords[i] = GetClusterCoord(TileGraph.AxialCoords[i], ClusterRadius);
+		}
+	});
+
+	//Lattice coords map to a box, clusters are numbered over the boxes that hold a tile
+	FIntPoint Min(MAX_int32, MAX_int32);
+	FIntPoint Max(MIN_int32, MIN_int32);
+	for (const FIntPoint& Coord : Coords)
+	{
+		Min = Min.ComponentMin(Coord);
+		Max = Max.ComponentMax(Coord);
+	}
+	int64 BoxHeight = (int64)Max.Y - Min.Y + 1;
+	auto GetBox = [&Min, BoxHeight](const FIntPoint& Coord) {
+		return ((int64)Coord.X - Min.X) * BoxHeight + Coord.Y - Min.Y;
+	};
+	TArray64<uint32> BoxClusters;
+	BoxClusters.Init(HPA_NONE, TileCount > 0 ? ((int64)Max.X - Min.X + 1) * BoxHeight : 0);
+	for (const FIntPoint& Coord : Coords)
+	{
+		BoxClusters[GetBox(Coord)] = 0;
+	}
+	uint32 ClusterCount = 0;
+	for (uint32& Cluster : BoxClusters)
+	{
+		if (Cluster != HPA_NONE) {
+			Cluster = ClusterCount++;
+		}
+	}
+	Out_Graph.ClusterCount = ClusterCount;
+
+	//Counting sort keeps the tiles of a cluster in tile order
+	Out_Graph.TileClusters.SetNumUninitialized(TileCount);
+	Out_Clusters.Offsets.SetNumZeroed(ClusterCount + 1);
+	for (int64 i = 0; i < TileCount; i++)
+	{
+		uint32 Cluster = BoxClusters[GetBox(Coords[i])];
+		Out_Graph.TileClusters[i] = Cluster;
+		Out_Clusters.Offsets[Cluster + 1]++;
+	}
+	for (uint32 i = 0; i < ClusterCount; i++)
+	{
+		Out_Clusters.Offsets[i + 1] += Out_Clusters.Offsets[i];
+	}
+	TArray64<int64> Next(Out_Clusters.Offsets.GetData(), ClusterCount);
+	Out_Clusters.Tiles.SetNumUninitialized(TileCount);
+	Out_Clusters.LocalIndices.SetNumUninitialized(TileCount);
+	for (int64 i = 0; i < TileCount; i++)
+	{
+		uint32 Cluster = Out_Graph.TileClusters[i];
+		Out_Clusters.LocalIndices[i] = (uint32)(Next[Cluster] - Out_Clusters.Offsets[Cluster]);
+		Out_Clusters.Tiles[Next[Cluster]++] = (uint32)i;
+	}
+}
+
+void GridHpaUtility::FindEntrances(const FStructHexTileGraph& TileGraph, const FStructHexHpaGraph& Graph, const FClusterTiles& Clusters,
+	uint32 Cluster, TArray<TPair<uint32, uint32>>& Out_Pairs)
+{
+	//Crossing edges by the cluster across, only towards higher ids so every border is handled once.
+	//Key holds the cluster across above the tile on this side, Value the tile across
+	TArray<TPair<uint64, uint32>> Border;
+	for (int64 i = Clusters.Offsets[Cluster]; i < Clusters.Offsets[Cluster + 1]; i++)
+	{
+		uint32 Tile = Clusters.Tiles[i];
+		for (int64 j = TileGraph.Neighbors.Offsets[Tile]; j < TileGraph.Neighbors.Offsets[Tile + 1]; j++)
+		{
+			uint32 Across = TileGraph.Neighbors.Ids[j];
+			uint32 Other = Graph.TileClusters[Across];
+			if (Other > Cluster) {
+				Border.Emplace(((uint64)Other << 32) | Tile, Across);
+			}
+		}
+	}
+	Border.Sort();
+	Border.SetNum(Algo::Unique(Border));
+
+	auto IsAdjacent = [&TileGraph](uint32 A, uint32 B) {
+		if (A == B) {
+			return true;
+		}
+		for (int64 j = TileGraph.Neighbors.Offsets[A]; j < TileGraph.Neighbors.Offsets[A + 1]; j++)
+		{
+			if (TileGraph.Neighbors.Ids[j] == B) {
+				return true;
+			}
+		}
+		return false;
+	};
+
+	TArray<int32> Parents;
+	for (int32 Begin = 0, End = 0; Begin < Border.Num(); Begin = End)
+	{
+		uint64 OtherKey = Border[Begin].Key & ~(uint64)MAX_uint32;
+		while (End < Border.Num() && (Border[End].Key & ~(uint64)MAX_uint32) == OtherKey) {
+			End++;
+		}
+
+		//Runs of crossing edges by union find. Two edges join only when their tiles are equal or adjacent on both sides,
+		//so the tiles of a run connect inside either cluster, and one entrance per run reaches every edge of it.
+		//Joining by this side alone would hand one entrance to pieces across that do not connect inside the other cluster
+		int32 Count = End - Begin;
+		TArrayView<const TPair<uint64, uint32>> Edges(Border.GetData() + Begin, Count);
+		Parents.SetNumUninitialized(Count);
+		for (int32 i = 0; i < Count; i++)
+		{
+			Parents[i] = i;
+		}
+		auto FindRoot = [&Parents](int32 i) {
+			while (Parents[i] != i) {
+				Parents[i] = Parents[Parents[i]];
+				i = Parents[i];
+			}
+			return i;
+		};
+		auto JoinNear = [&](int32 i, uint32 Near) {
+			int32 First = Algo::LowerBound(Edges, TPair<uint64, uint32>(OtherKey | Near, 0));
+			for (int32 k = First; k < Count && Edges[k].Key == (OtherKey | Near); k++)
+			{
+				if (IsAdjacent(Edges[i].Value, Edges[k].Value)) {
+					Parents[FindRoot(i)] = FindRoot(k);
+				}
+			}
+		};
+		for (int32 i = 0; i < Count; i++)
+		{
+			uint32 Tile = (uint32)Edges[i].Key;
+			JoinNear(i, Tile);
+			for (int64 j = TileGraph.Neighbors.Offsets[Tile]; j < TileGraph.Neighbors.Offsets[Tile + 1]; j++)
+			{
+				JoinNear(i, TileGraph.Neighbors.Ids[j]);
+			}
+		}
+
+		//The edge whose tile is nearest to the middle of a run is its entrance
+		for (int32 Root = 0; Root < Count; Root++)
+		{
+			if (FindRoot(Root) != Root) {
+				continue;
+			}
+			FVector2D Sum(0.0, 0.0);
+			int32 Size = 0;
+			for (int32 i = 0; i < Count; i++)
+			{
+				if (FindRoot(i) == Root) {
+					Sum += FVector2D(TileGraph.AxialCoords[(uint32)Edges[i].Key]);
+					Size++;
+				}
+			}
+			FVector2D Middle = Sum / Size;
+			int32 Entrance = INDEX_NONE;
+			double Best = MAX_dbl;
+			for (int32 i = 0; i < Count; i++)
+			{
+				double Dist = FVector2D::DistSquared(FVector2D(TileGraph.AxialCoords[(uint32)Edges[i].Key]), Middle);
+				if (FindRoot(i) == Root && Dist < Best) {
+					Best = Dist;
+					Entrance = i;
+				}
+			}
+			Out_Pairs.Emplace((uint32)Edges[Entrance].Key, Edges[Entrance].Value);
+		}
+	}
+}
+
+void GridHpaUtility::SearchCluster(const FStructHexTileGraph& TileGraph, const FStructHexHpaGraph& Graph, const FClusterTiles& Clusters,
+	uint32 Tile, TArray<uint32>& InOut_Queue, TArray<uint32>& Out_Steps)
+{
+	uint32 Cluster = Graph.TileClusters[Tile];
+	Out_Steps.Init(HPA_NONE, (int32)(Clusters.Offsets[Cluster + 1] - Clusters.Offsets[Cluster]));
+	InOut_Queue.Reset();
+	InOut_Queue.Add(Tile);
+	Out_Steps[Clusters.LocalIndices[Tile]] = 0;
+	for (int32 Head = 0; Head < InOut_Queue.Num(); Head++)
+	{
+		uint32 Current = InOut_Queue[Head];
+		uint32 Steps = Out_Steps[Clusters.LocalIndices[Current]] + 1;
+		for (int64 i = TileGraph.Neighbors.Offsets[Current]; i < TileGraph.Neighbors.Offsets[Current + 1]; i++)
+		{
+			uint32 Next = TileGraph.Neighbors.Ids[i];
+			if (Graph.TileClusters[Next] == Cluster && Out_Steps[Clusters.LocalIndices[Next]] == HPA_NONE) {
+				Out_Steps[Clusters.LocalIndices[Next]] = Steps;
+				InOut_Queue.Add(Next);
+			}
+		}
+	}
+}
+
+void GridHpaUtility::ReachEntrances(const FStructHexTileGraph& TileGraph, const FStructHexHpaGraph& Graph, uint32 Tile, uint32 Goal,
+	FStructHexPathScratch& InOut_Scratch, TArray<uint32>& Out_NodeSteps, uint32& Out_GoalSteps)
+{
+	BeginSearch(InOut_Scratch, TileGraph.GetTileCount());
+	uint32 Cluster = Graph.TileClusters[Tile];
+	TArray<uint32> Queue;
+	Queue.Add(Tile);
+	InOut_Scratch.Stamps[Tile] = InOut_Scratch.Generation;
+	InOut_Scratch.Costs[Tile] = 0;
+	for (int32 Head = 0; Head < Queue.Num(); Head++)
+	{
+		uint32 Current = Queue[Head];
+		for (int64 i = TileGraph.Neighbors.Offsets[Current]; i < TileGraph.Neighbors.Offsets[Current + 1]; i++)
+		{
+			uint32 Next = TileGraph.Neighbors.Ids[i];
+			if (Graph.TileClusters[Next] == Cluster && InOut_Scratch.Stamps[Next] != InOut_Scratch.Generation) {
+				InOut_Scratch.Stamps[Next] = InOut_Scratch.Generation;
+				InOut_Scratch.Costs[Next] = InOut_Scratch.Costs[Current] + 1;
+				Queue.Add(Next);
+			}
+		}
+	}
+
+	auto GetSteps = [&InOut_Scratch](uint32 Reached) {
+		return InOut_Scratch.Stamps[Reached] == InOut_Scratch.Generation ? InOut_Scratch.Costs[Reached] : HPA_NONE;
+	};
+	int64 Begin = Graph.ClusterNodeOffsets[Cluster];
+	Out_NodeSteps.SetNumUninitialized((int32)(Graph.ClusterNodeOffsets[Cluster + 1] - Begin));
+	for (int32 i = 0; i < Out_NodeSteps.Num(); i++)
+	{
+		Out_NodeSteps[i] = GetSteps(Graph.NodeTiles[Begin + i]);
+	}
+	Out_GoalSteps = Goal != HPA_NONE && Graph.TileClusters[Goal] == Cluster ? GetSteps(Goal) : HPA_NONE;
+}
+
+uint32 GridHpaUtility::FindNode(const FStructHexHpaGraph& Graph, uint32 Tile)
+{
+	uint32 Cluster = Graph.TileClusters[Tile];
+	int64 Begin = Graph.ClusterNodeOffsets[Cluster];
+	int64 Count = Graph.ClusterNodeOffsets[Cluster + 1] - Begin;
+	int64 Found = Algo::BinarySearch(TArrayView<const uint32, int64>(Graph.NodeTiles.GetData() + Begin, Count), Tile);
+	return Found == INDEX_NONE ? HPA_NONE : (uint32)(Begin + Found);
+}
+
+void GridHpaUtility::BeginSearch(FStructHexPathScratch& InOut_Scratch, int64 Count)
+{
+	if (InOut_Scratch.Stamps.Num() < Count) {
+		InOut_Scratch.Costs.SetNumUninitialized(Count);
+		InOut_Scratch.Parents.SetNumUninitialized(Count);
+		InOut_Scratch.Stamps.SetNumZeroed(Count);
+	}
+	//A new generation leaves every entry unvisited without clearing, a wrap around clears once
+	InOut_Scratch.Generation++;
+	if (InOut_Scratch.Generation == 0) {
+		FMemory::Memzero(InOut_Scratch.Stamps.GetData(), InOut_Scratch.Stamps.Num() * sizeof(uint32));
+		InOut_Scratch.Generation = 1;
+	}
+}
@@ -0,0 +1,127 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GridDualGraphUtility.h"
+#include "HexMath.h"
+
+DECLARE_LOG_CATEGORY_EXTERN(HexHpa, Log, All);
+
+struct FStructHexNeighborTable;
+
+//'HXHP'
+#define HPA_GRAPH_MAGIC	0x50485848
+#define HPA_GRAPH_VERSION	1
+//Missing tile, cluster or node
+#define HPA_NONE	MAX_uint32
+
+//Tiles with their 1 ring adjacency as tile indices, the flat graph A* runs on
+struct FStructHexTileGraph
+{
+	int32 GridRange = 0;
+	TArray64<FIntPoint> AxialCoords;
+	//Tile index of every hex within GridRange by spiral index, HPA_NONE for hexes that are no tile
+	TArray64<uint32> SpiralTiles;
+	FStructHexCsr Neighbors;
+
+	int64 GetTileCount() const { return AxialCoords.Num(); }
+	uint32 FindTile(const FIntPoint& Hex) const;
+};
+
+/**
+ * Abstract graph of HPA*. Tiles are partitioned into super hexes of ClusterRadius. Edges crossing between two
+ * clusters form runs where their tiles touch on both sides, every run gets one entrance pair, and entrances of
+ * one cluster are joined by their shortest path cost inside it. Nodes are entrance tiles, the nodes of one
+ * cluster are consecutive.
+ */
+struct FStructHexHpaGraph
+{
+	int32 ClusterRadius = 0;
+	int64 ClusterCount = 0;
+	TArray64<uint32> TileClusters;
+	TArray64<uint32> NodeTiles;
+	//ClusterCount + 1 entries, nodes of cluster c are ClusterNodeOffsets[c] .. ClusterNodeOffsets[c + 1] - 1
+	TArray64<int64> ClusterNodeOffsets;
+	//Row per node, steps to the other node in EdgeCosts at the same position as the id
+	FStructHexCsr Edges;
+	TArray64<uint32> EdgeCosts;
+
+	int64 GetNodeCount() const { return NodeTiles.Num(); }
+};
+
+//Reused across queries, so a search only touches the entries it visits
+struct FStructHexPathScratch
+{
+	TArray64<uint32> Costs;
+	TArray64<uint32> Parents;
+	TArray64<uint32> Stamps;
+	uint32 Generation = 0;
+};
+
+struct FStructHexPathResult
+{
+	bool Found = false;
+	//Steps from start to goal
+	uint32 Cost = 0;
+	//Nodes taken from the open list
+	int64 Expanded = 0;
+	//Abstract search only: start, entrance tiles passed, goal
+	TArray<uint32> Waypoints;
+};
+
+/**
+ * Builds the HPA* abstract graph with ParallelFor over clusters and answers path queries on it and,
+ * for reference, on the flat tile graph. Every step costs 1.
+ * File: header (magic, version, cluster radius, reserved), tile, cluster, node and edge counts as int64,
+ * TileClusters, NodeTiles, ClusterNodeOffsets, edge offsets, edge ids, edge costs.
+ */
+class CREATEGRIDDATA_API GridHpaUtility
+{
+public:
+	GridHpaUtility();
+	~GridHpaUtility();
+
+	//Adjacency from N1 when given, else from the 6 directions. Blocked tiles keep their index but no edges
+	static bool BuildTileGraph(const TArray64<FIntPoint>& AxialCoords, const FStructHexNeighborTable* N1,
+		const TBitArray<>* Blocked, FStructHexTileGraph& Out_Graph);
+	static bool Build(const FStructHexTileGraph& TileGraph, int32 ClusterRadius, FStructHexHpaGraph& Out_Graph);
+	static bool WriteToFile(const FStructHexHpaGraph& Graph, const FString& FullPath);
+	static bool ReadFromFile(const FString& FullPath, FStructHexHpaGraph& Out_Graph);
+
+	//Rough sizes from the tile count, entrances are assumed one per cluster side
+	static int64 EstimateFileBytes(int64 TileCount, int32 ClusterRadius);
+	static int64 EstimateBuildMemory(int64 TileCount, int32 GridRange);
+
+	static void FindPathFlat(const FStructHexTileGraph& TileGraph, uint32 Start, uint32 Goal, FStructHexPathScratch& InOut_Scratch,
+		FStructHexPathResult& Out_Result);
+	//Start and goal are joined to the entrances of their cluster, the search then runs on the abstract nodes only
+	static void FindPathAbstract(const FStructHexTileGraph& TileGraph, const FStructHexHpaGraph& Graph, uint32 Start, uint32 Goal,
+		FStructHexPathScratch& InOut_Scratch, FStructHexPathResult& Out_Result);
+
+	//Lattice coord of the super hex of Radius covering Hex, centers are i (2R + 1, -R) + j (R, R + 1)
+	static FIntPoint GetClusterCoord(const FIntPoint& Hex, int32 Radius);
+
+private:
+	//Tiles of every cluster, and the position of every tile within its cluster
+	struct FClusterTiles
+	{
+		TArray64<int64> Offsets;
+		TArray64<uint32> Tiles;
+		TArray64<uint32> LocalIndices;
+	};
+
+	static void AssignClusters(const FStructHexTileGraph& TileGraph, int32 ClusterRadius, FStructHexHpaGraph& Out_Graph,
+		FClusterTiles& Out_Clusters);
+	//Entrance pairs across the border of Cluster towards clusters of a higher id
+	static void FindEntrances(const FStructHexTileGraph& TileGraph, const FStructHexHpaGraph& Graph, const FClusterTiles& Clusters,
+		uint32 Cluster, TArray<TPair<uint32, uint32>>& Out_Pairs);
+	//Breadth first search from Tile inside its cluster, Out_Steps by local index, HPA_NONE where not reached
+	static void SearchCluster(const FStructHexTileGraph& TileGraph, const FStructHexHpaGraph& Graph, const FClusterTiles& Clusters,
+		uint32 Tile, TArray<uint32>& InOut_Queue, TArray<uint32>& Out_Steps);
+	//Query time search from Tile inside its cluster: steps to every node of the cluster and to Goal when it lies inside
+	static void ReachEntrances(const FStructHexTileGraph& TileGraph, const FStructHexHpaGraph& Graph, uint32 Tile, uint32 Goal,
+		FStructHexPathScratch& InOut_Scratch, TArray<uint32>& Out_NodeSteps, uint32& Out_GoalSteps);
+	static uint32 FindNode(const FStructHexHpaGraph& Graph, uint32 Tile);
+	static void BeginSearch(FStructHexPathScratch& InOut_Scratch, int64 Count);
+};
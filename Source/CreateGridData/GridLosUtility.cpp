@@ -0,0 +1,151 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GridLosUtility.h"
+#include "HexMappedFile.h"
+#include <Async/ParallelFor.h>
+
+DEFINE_LOG_CATEGORY(HexLos);
+
+GridLosUtility::GridLosUtility()
+{
+}
+
+GridLosUtility::~GridLosUtility()
+{
+}
+
+bool GridLosUtility::Build(int32 Range, FStructHexLosStencil& Out_Stencil)
+{
+	Out_Stencil = FStructHexLosStencil();
+	if (Range < 0 || Range > LOS_STENCIL_MAX_RANGE) {
+		UE_LOG(HexLos, Warning, TEXT("Line of sight range %d is outside 0 .. %d."), Range, LOS_STENCIL_MAX_RANGE);
+		return false;
+	}
+	Out_Stencil.Range = Range;
+	InitOffsets(Out_Stencil);
+
+	//Every offset of ring k has k - 1 hexes between, so the offsets follow from the ring alone
+	const int32 Count = Out_Stencil.GetOffsetCount();
+	Out_Stencil.LineOffsets.SetNumUninitialized(Count + 1);
+	Out_Stencil.LineOffsets[0] = 0;
+	for (int32 i = 0; i < Count; i++)
+	{
+		int32 Ring = HexMath::Length(HexMath::FAxial(Out_Stencil.Offsets[i]));
+		Out_Stencil.LineOffsets[i + 1] = Out_Stencil.LineOffsets[i] + FMath::Max(Ring - 1, 0);
+	}
+	Out_Stencil.LineHexes.SetNumUninitialized(Out_Stencil.LineOffsets[Count]);
+
+	ParallelFor(Range + 1, [&Out_Stencil](int32 Ring) {
+		TArray<HexMath::FAxial> Line;
+		int32 Begin = (int32)HexMath::GetTileCount(Ring - 1);
+		int32 End = (int32)HexMath::GetTileCount(Ring);
+		for (int32 i = Begin; i < End; i++)
+		{
+			HexMath::Line(HexMath::FAxial(), HexMath::FAxial(Out_Stencil.Offsets[i]), Line);
+			uint32 Next = Out_Stencil.LineOffsets[i];
+			for (int32 j = 1; j < Line.Num() - 1; j++)
+			{
+				Out_Stencil.LineHexes[Next++] = (uint16)HexMath::AxialToSpiralIndex(Line[j]);
+			}
+		}
+	}, EParallelForFlags::Unbalanced);
+	return true;
+}
+
+bool GridLosUtility::WriteToFile(const FStructHexLosStencil& Stencil, const FString& FullPath)
+{
+	uint32 Header[4] = { LOS_STENCIL_MAGIC, LOS_STENCIL_VERSION, (uint32)Stencil.Range, 0 };
+	int64 Counts[2] = { Stencil.GetOffsetCount(), Stencil.LineHexes.Num() };
+	TArray<TPair<const void*, int64>> Sections;
+	Sections.Emplace(Header, sizeof(Header));
+	Sections.Emplace(Counts, sizeof(Counts));
+	Sections.Emplace(Stencil.LineOffsets.GetData(), Stencil.LineOffsets.Num() * sizeof(uint32));
+	Sections.Emplace(Stencil.LineHexes.GetData(), Stencil.LineHexes.Num() * sizeof(uint16));
+
+	FHexMappedFile File;
+	if (!File.Open(FullPath, FHexMappedFile::GetSectionsBytes(Sections))) {
+		return false;
+	}
+	File.WriteSections(Sections);
+	return File.Commit();
+}
+
+bool GridLosUtility::ReadFromFile(const FString& FullPath, FStructHexLosStencil& Out_Stencil)
+{
+	Out_Stencil = FStructHexLosStencil();
+	FHexFileReader Reader;
+	if (!Reader.Open(FullPath)) {
+		UE_LOG(HexLos, Warning, TEXT("Can not open %s."), *FullPath);
+		return false;
+	}
+
+	uint32 Header[4];
+	int64 Counts[2];
+	if (!Reader.ReadBytes(Header, sizeof(Header)) || !Reader.ReadBytes(Counts, sizeof(Counts)) || Header[0] != LOS_STENCIL_MAGIC || Header[1] != LOS_STENCIL_VERSION || Header[2] > LOS_STENCIL_MAX_RANGE) {
+		UE_LOG(HexLos, Warning, TEXT("%s is not a line of sight stencil of version %d."), *FullPath, LOS_STENCIL_VERSION);
+		return false;
+	}
+
+	//Counts follow from the range, so the size check needs no trust in the file
+	int32 Range = (int32)Header[2];
+	if (Counts[0] != HexMath::GetTileCount(Range) || Counts[1] != GetLineHexCount(Range) || Reader.GetSize() != EstimateFileBytes(Range)) {
+		UE_LOG(HexLos, Warning, TEXT("Line of sight stencil %s is truncated or damaged."), *FullPath);
+		return false;
+	}
+	Out_Stencil.Range = Range;
+	if (!Reader.ReadArray(Out_Stencil.LineOffsets, Counts[0] + 1) || !Reader.ReadArray(Out_Stencil.LineHexes, Counts[1])
+		|| Out_Stencil.LineOffsets[0] != 0 || Out_Stencil.LineOffsets.Last() != Counts[1]) {
+		UE_LOG(HexLos, Warning, TEXT("Line of sight stencil %s is truncated or damaged."), *FullPath);
+		Out_Stencil = FStructHexLosStencil();
+		return false;
+	}
+	InitOffsets(Out_Stencil);
+	return true;
+}
+
+int64 GridLosUtility::GetLineHexCount(int32 Range)
+{
+	return 2 * (int64)(Range - 1) * Range * (Range + 1);
+}
+
+int64 GridLosUtility::EstimateFileBytes(int32 Range)
+{
+	return sizeof(uint32) * 4 + sizeof(int64) * 2 + (HexMath::GetTileCount(Range) + 1) * sizeof(uint32)
+		+ GetLineHexCount(Range) * sizeof(uint16);
+}
+
+void GridLosUtility::ComputeFov(const FStructHexLosStencil& Stencil, const FIntPoint& Origin, int32 Radius, int32 GridRange,
+	const TBitArray<>& Blockers, TBitArray<>& Out_Visible)
+{
+	const int32 Count = (int32)HexMath::GetTileCount(FMath::Clamp(Radius, 0, Stencil.Range));
+	check(Blockers.Num() >= HexMath::GetTileCount(GridRange));
+	Out_Visible.Init(false, Count);
+
+	//Hexes between lie on inner rings, so one pass in spiral order gathers every blocker before a line tests it
+	TBitArray<> Blocked(true, Count);
+	for (int32 i = 0; i < Count; i++)
+	{
+		HexMath::FAxial Hex(Origin + Stencil.Offsets[i]);
+		if (HexMath::Length(Hex) > GridRange) {
+			continue;
+		}
+		Blocked[i] = Blockers[HexMath::AxialToSpiralIndex(Hex)];
+
+		bool Seen = true;
+		for (uint32 j = Stencil.LineOffsets[i]; Seen && j < Stencil.LineOffsets[i + 1]; j++)
+		{
+			Seen = !Blocked[Stencil.LineHexes[j]];
+		}
+		Out_Visible[i] = Seen;
+	}
+}
+
+void GridLosUtility::InitOffsets(FStructHexLosStencil& InOut_Stencil)
+{
+	InOut_Stencil.Offsets.Reset(HexMath::GetTileCount(InOut_Stencil.Range));
+	for (const HexMath::FAxial& Hex : HexMath::Spiral(HexMath::FAxial(), InOut_Stencil.Range))
+	{
+		InOut_Stencil.Offsets.Add(Hex.ToIntPoint());
+	}
+}
@@ -0,0 +1,62 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HexMath.h"
+
+DECLARE_LOG_CATEGORY_EXTERN(HexLos, Log, All);
+
+//'HXLS'
+#define LOS_STENCIL_MAGIC	0x534C5848
+#define LOS_STENCIL_VERSION	1
+//Line hexes are stored as 16 bit spiral indices, T(147) is the last tile count below 65536
+#define LOS_STENCIL_MAX_RANGE	147
+
+/**
+ * Lines of sight from the origin to every offset within Range, translation invariant like the neighbor rings.
+ * Offset i is the hex of spiral index i around the origin. Its line lists the hexes strictly between the
+ * origin and the offset, ordered outward, as spiral indices of HexMath::Line.
+ */
+struct FStructHexLosStencil
+{
+	int32 Range = 0;
+	//T(Range) + 1 entries, the line of offset i is LineHexes[LineOffsets[i]] .. LineHexes[LineOffsets[i + 1] - 1]
+	TArray<uint32> LineOffsets;
+	TArray<uint16> LineHexes;
+	//Axial coord of every offset, rebuilt on load and not written
+	TArray<FIntPoint> Offsets;
+
+	int32 GetOffsetCount() const { return Offsets.Num(); }
+};
+
+/**
+ * Builds, stores and applies the line of sight stencil.
+ * File: header (magic, version, range, reserved), offset and line hex counts as int64, LineOffsets, LineHexes.
+ */
+class CREATEGRIDDATA_API GridLosUtility
+{
+public:
+	GridLosUtility();
+	~GridLosUtility();
+
+	static bool Build(int32 Range, FStructHexLosStencil& Out_Stencil);
+	static bool WriteToFile(const FStructHexLosStencil& Stencil, const FString& FullPath);
+	static bool ReadFromFile(const FString& FullPath, FStructHexLosStencil& Out_Stencil);
+
+	//Sum of Distance - 1 over all offsets, 2(R - 1)R(R + 1)
+	static int64 GetLineHexCount(int32 Range);
+	static int64 EstimateFileBytes(int32 Range);
+
+	/**
+	 * Field of view of Origin within Radius <= Stencil.Range on a grid of GridRange.
+	 * Blockers has one bit per tile, indexed by the spiral index of the full hexagon.
+	 * Out_Visible[i] tells whether offset i is seen: it is inside the grid and no hex between is a blocker.
+	 * A blocker itself can be seen, hexes outside the grid block and are never seen.
+	 */
+	static void ComputeFov(const FStructHexLosStencil& Stencil, const FIntPoint& Origin, int32 Radius, int32 GridRange,
+		const TBitArray<>& Blockers, TBitArray<>& Out_Visible);
+
+private:
+	static void InitOffsets(FStructHexLosStencil& InOut_Stencil);
+};
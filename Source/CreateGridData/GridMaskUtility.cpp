@@ -0,0 +1,242 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GridMaskUtility.h"
+#include "HexMath.h"
+#include <Async/ParallelFor.h>
+#include <ImageCore.h>
+#include <ImageUtils.h>
+#include <Misc/FileHelper.h>
+#include <Misc/Paths.h>
+
+DEFINE_LOG_CATEGORY(HexGridMask);
+
+GridMaskUtility::GridMaskUtility()
+{
+}
+
+GridMaskUtility::~GridMaskUtility()
+{
+}
+
+bool GridMaskUtility::LoadMask(const FString& FullPath, uint8 Threshold, FStructHexGridMask& Out_Mask)
+{
+	Out_Mask = FStructHexGridMask();
+	FString Extension = FPaths::GetExtension(FullPath).ToLower();
+	bool Loaded;
+	if (Extension == TEXT("pbm") || Extension == TEXT("pgm")) {
+		TArray64<uint8> Data;
+		Loaded = FFileHelper::LoadFileToArray(Data, *FullPath) && LoadNetpbm(Data, Threshold, Out_Mask);
+	}
+	else {
+		Loaded = LoadImageFile(FullPath, Threshold, Out_Mask);
+	}
+
+	if (!Loaded) {
+		UE_LOG(HexGridMask, Warning, TEXT("Load mask %s failed!"), *FullPath);
+		Out_Mask = FStructHexGridMask();
+		return false;
+	}
+	UE_LOG(HexGridMask, Log, TEXT("Load mask %s, %d x %d pixels, %d masked in."), *FullPath, Out_Mask.Width, Out_Mask.Height,
+		Out_Mask.Bits.CountSetBits());
+	return true;
+}
+
+void GridMaskUtility::CountRings(const FStructHexGridMask& Mask, int32 Range, TArray<int64>& Out_RingEnds)
+{
+	Out_RingEnds.SetNumZeroed(Range + 1);
+	ParallelFor(Range + 1, [&Mask, &Out_RingEnds](int32 Ring) {
+		int64 Count = 0;
+		for (const HexMath::FAxial& Hex : HexMath::Ring(HexMath::FAxial(), Ring))
+		{
+			Count += Mask.Contains(Hex.ToIntPoint()) ? 1 : 0;
+		}
+		Out_RingEnds[Ring] = Count;
+	}, EParallelForFlags::Unbalanced);
+
+	for (int32 Ring = 1; Ring <= Range; Ring++)
+	{
+		Out_RingEnds[Ring] += Out_RingEnds[Ring - 1];
+	}
+}
+
+void GridMaskUtility::CollectTiles(const FStructHexGridMask& Mask, const TArray<int64>& RingEnds, TArray64<FIntPoint>& Out_Tiles)
+{
+	Out_Tiles.SetNumUninitialized(RingEnds.Num() > 0 ? RingEnds.Last() : 0);
+	ParallelFor(RingEnds.Num(), [&Mask, &RingEnds, &Out_Tiles](int32 Ring) {
+		int64 Next = Ring == 0 ? 0 : RingEnds[Ring - 1];
+		for (const HexMath::FAxial& Hex : HexMath::Ring(HexMath::FAxial(), Ring))
+		{
+			if (Mask.Contains(Hex.ToIntPoint())) {
+				Out_Tiles[Next++] = Hex.ToIntPoint();
+			}
+		}
+	}, EParallelForFlags::Unbalanced);
+}
+
+void GridMaskUtility::CollectSpiralTiles(const TArray64<FIntPoint>& Tiles, int32 Range, TArray64<uint32>& Out_SpiralTiles)
+{
+	Out_SpiralTiles.Init(MAX_uint32, HexMath::GetTileCount(Range));
+	for (int64 i = 0; i < Tiles.Num(); i++)
+	{
+		Out_SpiralTiles[HexMath::AxialToSpiralIndex(HexMath::FAxial(Tiles[i]))] = (uint32)i;
+	}
+}
+
+uint32 GridMaskUtility::GetMaskCrc(const FStructHexGridMask& Mask)
+{
+	//Size and origin, then the thresholded pixels. TBitArray keeps the bits past Num cleared
+	int32 Header[4] = { Mask.Width, Mask.Height, Mask.Origin.X, Mask.Origin.Y };
+	uint32 Crc = FCrc::MemCrc32(Header, sizeof(Header));
+	return FCrc::MemCrc32(Mask.Bits.GetData(), FMath::DivideAndRoundUp(Mask.Bits.Num(), NumBitsPerDWORD) * sizeof(uint32), Crc);
+}
+
+bool GridMaskUtility::LoadNetpbm(const TArray64<uint8>& Data, uint8 Threshold, FStructHexGridMask& Out_Mask)
+{
+	if (Data.Num() < 2 || Data[0] != 'P') {
+		return false;
+	}
+	uint8 Format = Data[1];
+	bool Bitmap = Format == '1' || Format == '4';
+	if (!Bitmap && Format != '2' && Format != '5') {
+		return false;
+	}
+
+	int64 Pos = 2;
+	int32 Width;
+	int32 Height;
+	int32 MaxValue = 1;
+	if (!ReadHeaderInt(Data, Pos, Width) || !ReadHeaderInt(Data, Pos, Height) || (!Bitmap && !ReadHeaderInt(Data, Pos, MaxValue))) {
+		return false;
+	}
+	if (Width <= 0 || Height <= 0 || (int64)Width * Height > MAX_int32 || MaxValue <= 0 || MaxValue > MAX_uint16) {
+		return false;
+	}
+	InitMask(Width, Height, Out_Mask);
+	int32 PixelCount = Width * Height;
+
+	//Gray value v of maxval m is kept when v / m * 255 >= Threshold
+	auto KeepGray = [Threshold, MaxValue](int32 Value) {
+		return (int64)Value * 255 >= (int64)Threshold * MaxValue;
+	};
+
+	if (Format == '1') {
+		//Digits may follow each other without whitespace
+		for (int32 i = 0; i < PixelCount; i++)
+		{
+			SkipWhitespace(Data, Pos);
+			if (Pos >= Data.Num() || (Data[Pos] != '0' && Data[Pos] != '1')) {
+				return false;
+			}
+			Out_Mask.Bits[i] = Data[Pos++] == '1';
+		}
+		return true;
+	}
+	if (Format == '2') {
+		for (int32 i = 0; i < PixelCount; i++)
+		{
+			int32 Value;
+			if (!ReadHeaderInt(Data, Pos, Value)) {
+				return false;
+			}
+			Out_Mask.Bits[i] = KeepGray(Value);
+		}
+		return true;
+	}
+
+	//Binary formats start after a single whitespace byte
+	Pos++;
+	if (Format == '4') {
+		//Rows are padded to whole bytes, most significant bit first
+		int64 RowBytes = (Width + 7) / 8;
+		if (Pos + RowBytes * Height > Data.Num()) {
+			return false;
+		}
+		for (int32 y = 0; y < Height; y++)
+		{
+			const uint8* Row = Data.GetData() + Pos + RowBytes * y;
+			for (int32 x = 0; x < Width; x++)
+			{
+				Out_Mask.Bits[y * Width + x] = ((Row[x >> 3] >> (7 - (x & 7))) & 1) != 0;
+			}
+		}
+		return true;
+	}
+
+	//Samples above 255 take two bytes, most significant first
+	int32 SampleBytes = MaxValue > 255 ? 2 : 1;
+	if (Pos + (int64)PixelCount * SampleBytes > Data.Num()) {
+		return false;
+	}
+	const uint8* Samples = Data.GetData() + Pos;
+	for (int32 i = 0; i < PixelCount; i++)
+	{
+		int32 Value = SampleBytes == 1 ? Samples[i] : (Samples[i * 2] << 8) | Samples[i * 2 + 1];
+		Out_Mask.Bits[i] = KeepGray(Value);
+	}
+	return true;
+}
+
+bool GridMaskUtility::LoadImageFile(const FString& FullPath, uint8 Threshold, FStructHexGridMask& Out_Mask)
+{
+	FImage Image;
+	if (!FImageUtils::LoadImage(*FullPath, Image)) {
+		return false;
+	}
+	if ((int64)Image.SizeX * Image.SizeY > MAX_int32) {
+		return false;
+	}
+
+	//Keep the gray values as painted, without linearizing sRGB
+	FImage Gray;
+	Image.CopyTo(Gray, ERawImageFormat::G8, EGammaSpace::sRGB);
+	InitMask(Gray.SizeX, Gray.SizeY, Out_Mask);
+	const uint8* Pixels = Gray.RawData.GetData();
+	for (int32 i = 0; i < Gray.SizeX * Gray.SizeY; i++)
+	{
+		Out_Mask.Bits[i] = Pixels[i] >= Threshold;
+	}
+	return Out_Mask.IsValid();
+}
+
+bool GridMaskUtility::ReadHeaderInt(const TArray64<uint8>& Data, int64& InOut_Pos, int32& Out_Value)
+{
+	int64 Pos = InOut_Pos;
+	SkipWhitespace(Data, Pos);
+
+	int64 Value = 0;
+	int64 Digits = Pos;
+	while (Pos < Data.Num() && Data[Pos] >= '0' && Data[Pos] <= '9' && Value <= MAX_int32) {
+		Value = Value * 10 + (Data[Pos] - '0');
+		Pos++;
+	}
+	if (Pos == Digits || Value > MAX_int32) {
+		return false;
+	}
+	Out_Value = (int32)Value;
+	InOut_Pos = Pos;
+	return true;
+}
+
+void GridMaskUtility::SkipWhitespace(const TArray64<uint8>& Data, int64& InOut_Pos)
+{
+	//# comments run to the line end
+	while (InOut_Pos < Data.Num() && (FChar::IsWhitespace(Data[InOut_Pos]) || Data[InOut_Pos] == '#')) {
+		if (Data[InOut_Pos] == '#') {
+			while (InOut_Pos < Data.Num() && Data[InOut_Pos] != '\n') {
+				InOut_Pos++;
+			}
+		}
+		else {
+			InOut_Pos++;
+		}
+	}
+}
+
+void GridMaskUtility::InitMask(int32 Width, int32 Height, FStructHexGridMask& Out_Mask)
+{
+	Out_Mask.Width = Width;
+	Out_Mask.Height = Height;
+	Out_Mask.Origin = FIntPoint(-(Width / 2), -(Height / 2));
+	Out_Mask.Bits.Init(false, Width * Height);
+}
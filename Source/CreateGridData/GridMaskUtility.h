@@ -0,0 +1,56 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+DECLARE_LOG_CATEGORY_EXTERN(HexGridMask, Log, All);
+
+//Mask in axial space, pixel (x, y) covers axial (Origin.X + x, Origin.Y + y)
+struct FStructHexGridMask
+{
+	int32 Width = 0;
+	int32 Height = 0;
+	FIntPoint Origin = FIntPoint(0, 0);
+	TBitArray<> Bits;
+
+	bool IsValid() const { return Width > 0 && Height > 0; }
+
+	bool Contains(const FIntPoint& Hex) const
+	{
+		int32 X = Hex.X - Origin.X;
+		int32 Y = Hex.Y - Origin.Y;
+		return X >= 0 && Y >= 0 && X < Width && Y < Height && Bits[Y * Width + X];
+	}
+};
+
+/**
+ * Loads the mask that limits which tiles of the hexagon are generated.
+ * The image is centered on the origin, its center pixel covers axial (0, 0).
+ * .pbm (P1, P4) keeps black pixels, .pgm (P2, P5) and every format FImageUtils reads keep
+ * pixels whose 8 bit gray value is at least the threshold.
+ */
+class CREATEGRIDDATA_API GridMaskUtility
+{
+public:
+	GridMaskUtility();
+	~GridMaskUtility();
+
+	static bool LoadMask(const FString& FullPath, uint8 Threshold, FStructHexGridMask& Out_Mask);
+
+	//Out_RingEnds[r] is the number of masked in tiles within ring r, so every grid range is a prefix of the spiral
+	static void CountRings(const FStructHexGridMask& Mask, int32 Range, TArray<int64>& Out_RingEnds);
+	//Masked in tiles in spiral order
+	static void CollectTiles(const FStructHexGridMask& Mask, const TArray<int64>& RingEnds, TArray64<FIntPoint>& Out_Tiles);
+	//Tile index of every hex within Range by spiral index, MAX_uint32 for hexes that are no tile
+	static void CollectSpiralTiles(const TArray64<FIntPoint>& Tiles, int32 Range, TArray64<uint32>& Out_SpiralTiles);
+	//CRC of the mask after thresholding, so an edited image under the same path changes it
+	static uint32 GetMaskCrc(const FStructHexGridMask& Mask);
+
+private:
+	static bool LoadNetpbm(const TArray64<uint8>& Data, uint8 Threshold, FStructHexGridMask& Out_Mask);
+	static bool LoadImageFile(const FString& FullPath, uint8 Threshold, FStructHexGridMask& Out_Mask);
+	static bool ReadHeaderInt(const TArray64<uint8>& Data, int64& InOut_Pos, int32& Out_Value);
+	static void SkipWhitespace(const TArray64<uint8>& Data, int64& InOut_Pos);
+	static void InitMask(int32 Width, int32 Height, FStructHexGridMask& Out_Mask);
+};
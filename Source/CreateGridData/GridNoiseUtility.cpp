@@ -0,0 +1,200 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GridNoiseUtility.h"
+#include "HexMappedFile.h"
+#include "HexMath.h"
+#include <Async/ParallelFor.h>
+
+DEFINE_LOG_CATEGORY(HexNoise);
+
+//Skew to the simplex grid and back, (sqrt(3) - 1) / 2 and (3 - sqrt(3)) / 6
+static constexpr float SimplexF2 = 0.36602540378f;
+static constexpr float SimplexG2 = 0.21132486540f;
+//Brings the sum of the three corners to -1 .. 1 for the gradients of SimplexCorner
+static constexpr float SimplexScale = 45.0f;
+
+GridNoiseUtility::GridNoiseUtility()
+{
+}
+
+GridNoiseUtility::~GridNoiseUtility()
+{
+}
+
+float GridNoiseUtility::Simplex2D(float X, float Y, uint32 Seed)
+{
+	return SimplexPoint(X, Y, Seed * 0xcb1ab31fu);
+}
+
+void GridNoiseUtility::Simplex2DBatch(const float* X, const float* Y, int32 Count, uint32 Seed, float* Out_Values)
+{
+	const uint32 SeedHash = Seed * 0xcb1ab31fu;
+	const int32 BlockEnd = Count / NOISE_LANES * NOISE_LANES;
+	for (int32 Begin = 0; Begin < BlockEnd; Begin += NOISE_LANES)
+	{
+		SimplexLanes(X + Begin, Y + Begin, 1.0f, SeedHash, Out_Values + Begin);
+	}
+
+	//The tail is padded to one more block, so every point takes the same path
+	const int32 Tail = Count - BlockEnd;
+	if (Tail > 0) {
+		float TailX[NOISE_LANES] = {};
+		float TailY[NOISE_LANES] = {};
+		float TailValues[NOISE_LANES];
+		FMemory::Memcpy(TailX, X + BlockEnd, Tail * sizeof(float));
+		FMemory::Memcpy(TailY, Y + BlockEnd, Tail * sizeof(float));
+		SimplexLanes(TailX, TailY, 1.0f, SeedHash, TailValues);
+		FMemory::Memcpy(Out_Values + BlockEnd, TailValues, Tail * sizeof(float));
+	}
+}
+
+void GridNoiseUtility::EvaluateFbm(const FStructHexNoiseChannel& Channel, const float* X, const float* Y, int32 Count, float* Out_Values)
+{
+	const int32 Octaves = FMath::Clamp(Channel.Octaves, 1, 16);
+	float AmplitudeSum = 0.0f;
+	float Amplitude = 1.0f;
+	for (int32 Octave = 0; Octave < Octaves; Octave++)
+	{
+		AmplitudeSum += Amplitude;
+		Amplitude *= Channel.Gain;
+	}
+	const float Normalize = 1.0f / FMath::Max(AmplitudeSum, UE_SMALL_NUMBER);
+
+	//All octaves of one block of lanes at a time, so the sums stay in registers and nothing is allocated
+	for (int32 Begin = 0; Begin < Count; Begin += NOISE_LANES)
+	{
+		const int32 Lanes = FMath::Min(Count - Begin, NOISE_LANES);
+		float BlockX[NOISE_LANES] = {};
+		float BlockY[NOISE_LANES] = {};
+		FMemory::Memcpy(BlockX, X + Begin, Lanes * sizeof(float));
+		FMemory::Memcpy(BlockY, Y + Begin, Lanes * sizeof(float));
+
+		//Every octave gets its own seed, so the octaves do not line up at the origin
+		float Sum[NOISE_LANES] = {};
+		float Frequency = Channel.Frequency;
+		Amplitude = 1.0f;
+		for (int32 Octave = 0; Octave < Octaves; Octave++)
+		{
+			float Values[NOISE_LANES];
+			uint32 Seed = (uint32)Channel.Seed + (uint32)Octave * 0x9e3779b9u;
+			SimplexLanes(BlockX, BlockY, Frequency, Seed * 0xcb1ab31fu, Values);
+			for (int32 Lane = 0; Lane < NOISE_LANES; Lane++)
+			{
+				Sum[Lane] += Amplitude * Values[Lane];
+			}
+			Frequency *= Channel.Lacunarity;
+			Amplitude *= Channel.Gain;
+		}
+		for (int32 Lane = 0; Lane < Lanes; Lane++)
+		{
+			Out_Values[Begin + Lane] = Sum[Lane] * Normalize;
+		}
+	}
+}
+
+bool GridNoiseUtility::WriteAttributes(const FString& FullPath, int32 Range, float TileSize, const TArray<FStructHexNoiseChannel>& Channels,
+	const TArray64<FIntPoint>* Tiles)
+{
+	const int64 TileCount = Tiles != nullptr ? Tiles->Num() : HexMath::GetTileCount(Range);
+	FHexMappedFile File;
+	if (!File.Open(FullPath, GetAttributesFileBytes(TileCount, Channels.Num()))) {
+		return false;
+	}
+
+	uint8* Data = File.GetData();
+	uint32 Header[4] = { ATTRIBUTES_MAGIC, ATTRIBUTES_VERSION, (uint32)Range, (uint32)Channels.Num() };
+	FMemory::Memcpy(Data, Header, sizeof(Header));
+	FMemory::Memcpy(Data + sizeof(Header), &TileCount, sizeof(TileCount));
+	for (int32 i = 0; i < Channels.Num(); i++)
+	{
+		uint8* Name = Data + HeaderBytes + i * ATTRIBUTES_NAME_BYTES;
+		FTCHARToUTF8 Utf8(*Channels[i].Name.ToString());
+		FMemory::Memzero(Name, ATTRIBUTES_NAME_BYTES);
+		FMemory::Memcpy(Name, Utf8.Get(), FMath::Min(Utf8.Length(), ATTRIBUTES_NAME_BYTES - 1));
+	}
+
+	//Every batch computes its positions once and fills its slice of every column
+	float* Columns = reinterpret_cast<float*>(Data + HeaderBytes + Channels.Num() * ATTRIBUTES_NAME_BYTES);
+	int32 BatchCount = (int32)((TileCount + NOISE_BATCH_TILES - 1) / NOISE_BATCH_TILES);
+	ParallelFor(BatchCount, [Columns, Tiles, TileSize, TileCount, &Channels](int32 BatchIndex) {
+		int64 Begin = (int64)BatchIndex * NOISE_BATCH_TILES;
+		int32 Count = (int32)(FMath::Min(Begin + NOISE_BATCH_TILES, TileCount) - Begin);
+		float X[NOISE_BATCH_TILES];
+		float Y[NOISE_BATCH_TILES];
+		for (int32 i = 0; i < Count; i++)
+		{
+			FIntPoint Hex = Tiles != nullptr ? (*Tiles)[Begin + i] : HexMath::SpiralIndexToAxial(Begin + i).ToIntPoint();
+			FVector2D Position = HexMath::AxialToPosition(Hex, TileSize);
+			X[i] = (float)Position.X;
+			Y[i] = (float)Position.Y;
+		}
+		for (int32 i = 0; i < Channels.Num(); i++)
+		{
+			EvaluateFbm(Channels[i], X, Y, Count, Columns + i * TileCount + Begin);
+		}
+	});
+	return File.Commit();
+}
+
+int64 GridNoiseUtility::GetAttributesFileBytes(int64 TileCount, int32 ChannelCount)
+{
+	return HeaderBytes + ChannelCount * ((int64)ATTRIBUTES_NAME_BYTES + TileCount * (int64)sizeof(float));
+}
+
+void GridNoiseUtility::SimplexLanes(const float* X, const float* Y, float Frequency, uint32 SeedHash, float* Out_Values)
+{
+	//Fixed trip count over a body with no calls, tables or branches, so the lanes map onto SIMD registers
+	for (int32 Lane = 0; Lane < NOISE_LANES; Lane++)
+	{
+		Out_Values[Lane] = SimplexPoint(X[Lane] * Frequency, Y[Lane] * Frequency, SeedHash);
+	}
+}
+
+int32 GridNoiseUtility::FloorToIntSelect(float Value)
+{
+	//Truncation rounds negative values up, subtracting the compare result fixes that with integer math.
+	//A float select here would be turned back into a branch, as the float subtraction may trap
+	int32 Truncated = (int32)Value;
+	return Truncated - ((float)Truncated > Value ? 1 : 0);
+}
+
+float GridNoiseUtility::SimplexPoint(float X, float Y, uint32 SeedHash)
+{
+	//Cell of the skewed grid and the point relative to its first corner
+	float Skew = (X + Y) * SimplexF2;
+	int32 I = FloorToIntSelect(X + Skew);
+	int32 J = FloorToIntSelect(Y + Skew);
+	float CellI = (float)I;
+	float CellJ = (float)J;
+	float Unskew = (CellI + CellJ) * SimplexG2;
+	float X0 = X - (CellI - Unskew);
+	float Y0 = Y - (CellJ - Unskew);
+
+	//The middle corner is one step along the larger offset, picked by a select instead of a branch
+	int32 StepI = X0 > Y0 ? 1 : 0;
+	int32 StepJ = 1 - StepI;
+	float Sum = SimplexCorner(I, J, X0, Y0, SeedHash)
+		+ SimplexCorner(I + StepI, J + StepJ, X0 - (float)StepI + SimplexG2, Y0 - (float)StepJ + SimplexG2, SeedHash)
+		+ SimplexCorner(I + 1, J + 1, X0 - 1.0f + 2.0f * SimplexG2, Y0 - 1.0f + 2.0f * SimplexG2, SeedHash);
+	float Value = Sum * SimplexScale;
+	Value = Value > 1.0f ? 1.0f : Value;
+	return Value < -1.0f ? -1.0f : Value;
+}
+
+float GridNoiseUtility::SimplexCorner(int32 I, int32 J, float X, float Y, uint32 SeedHash)
+{
+	//Hash the corner, then take one of the 8 gradients (+-1, +-2) and (+-2, +-1) from its low bits
+	uint32 Hash = ((uint32)I * 0x8da6b343u) ^ ((uint32)J * 0xd8163841u) ^ SeedHash;
+	Hash ^= Hash >> 15;
+	Hash *= 0x2c1b3c6du;
+	Hash ^= Hash >> 12;
+	float SignX = (float)(Hash & 1) * 2.0f - 1.0f;
+	float SignY = (float)((Hash >> 1) & 1) * 2.0f - 1.0f;
+	float Swap = (float)((Hash >> 2) & 1);
+	float Falloff = 0.5f - X * X - Y * Y;
+	//Zero below the falloff edge via Abs, a compare here lets the compiler branch around the products below
+	Falloff = (Falloff + FMath::Abs(Falloff)) * 0.5f;
+	Falloff *= Falloff;
+	return Falloff * Falloff * (SignX * (1.0f + Swap) * X + SignY * (2.0f - Swap) * Y);
+}
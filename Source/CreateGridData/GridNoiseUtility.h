@@ -0,0 +1,52 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "StructDefine.h"
+
+DECLARE_LOG_CATEGORY_EXTERN(HexNoise, Log, All);
+
+//'HXAT'
+#define ATTRIBUTES_MAGIC	0x54415848
+#define ATTRIBUTES_VERSION	1
+//Channel names are stored as zero padded UTF-8
+#define ATTRIBUTES_NAME_BYTES	32
+//Tiles handed to one ParallelFor task
+#define NOISE_BATCH_TILES	4096
+//Points evaluated side by side in one pass of the batch loop
+#define NOISE_LANES	8
+
+/**
+ * Per tile attributes from noise, evaluated over tile positions in batches instead of sampled one tile at a time.
+ * Simplex noise hashes its lattice corners with integer arithmetic, floors and picks corners by compare and select,
+ * and calls nothing, so the lanes of a block run the same instructions and the fixed lane loop vectorizes.
+ * Attributes file: magic, version, grid range, channel count as uint32, tile count as int64,
+ * one name per channel, then every channel as a column of floats in tile index order.
+ */
+class CREATEGRIDDATA_API GridNoiseUtility
+{
+public:
+	GridNoiseUtility();
+	~GridNoiseUtility();
+
+	//2D simplex noise in -1 .. 1
+	static float Simplex2D(float X, float Y, uint32 Seed);
+	static void Simplex2DBatch(const float* X, const float* Y, int32 Count, uint32 Seed, float* Out_Values);
+	//fBm of the channel at Count positions in world units, normalized to -1 .. 1
+	static void EvaluateFbm(const FStructHexNoiseChannel& Channel, const float* X, const float* Y, int32 Count, float* Out_Values);
+
+	//Tiles lists the tiles of a masked grid in index order, null evaluates the full hexagon in spiral order
+	static bool WriteAttributes(const FString& FullPath, int32 Range, float TileSize, const TArray<FStructHexNoiseChannel>& Channels,
+		const TArray64<FIntPoint>* Tiles);
+	static int64 GetAttributesFileBytes(int64 TileCount, int32 ChannelCount);
+
+private:
+	static const int64 HeaderBytes = sizeof(uint32) * 4 + sizeof(int64);
+
+	//NOISE_LANES points at X, Y scaled by Frequency
+	static FORCEINLINE void SimplexLanes(const float* X, const float* Y, float Frequency, uint32 SeedHash, float* Out_Values);
+	static FORCEINLINE int32 FloorToIntSelect(float Value);
+	static FORCEINLINE float SimplexPoint(float X, float Y, uint32 SeedHash);
+	static FORCEINLINE float SimplexCorner(int32 I, int32 J, float X, float Y, uint32 SeedHash);
+};
@@ -0,0 +1,309 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GridShardUtility.h"
+#include <Async/ParallelFor.h>
+#include <Misc/Crc.h>
+#include <Misc/FileHelper.h>
+
+#include <atomic>
+#include <fstream>
+#include <filesystem>
+
+DEFINE_LOG_CATEGORY(HexShard);
+
+GridShardUtility::GridShardUtility()
+{
+}
+
+GridShardUtility::~GridShardUtility()
+{
+}
+
+bool GridShardUtility::ParseShard(const FString& Str, FStructHexGridShard& Out_Shard)
+{
+	//Digits only, so signs, fractions and exponents fail, and at most 9 of them so the value fits int32
+	auto ParseNumber = [](const FString& Part, int32& Out_Value) {
+		if (Part.IsEmpty() || Part.Len() > 9) {
+			return false;
+		}
+		for (TCHAR Char : Part)
+		{
+			if (!FChar::IsDigit(Char)) {
+				return false;
+			}
+		}
+		Out_Value = FCString::Atoi(*Part);
+		return true;
+	};
+
+	Out_Shard = FStructHexGridShard();
+	FString Index, Count;
+	int32 ParsedIndex, ParsedCount;
+	if (!Str.Split(TEXT("/"), &Index, &Count) || !ParseNumber(Index, ParsedIndex) || !ParseNumber(Count, ParsedCount)) {
+		UE_LOG(HexShard, Warning, TEXT("Shard %s is not of the form i/N."), *Str);
+		return false;
+	}
+	if (ParsedCount < 1 || ParsedIndex >= ParsedCount) {
+		UE_LOG(HexShard, Warning, TEXT("Shard %s is out of range."), *Str);
+		return false;
+	}
+	Out_Shard.Index = ParsedIndex;
+	Out_Shard.Count = ParsedCount;
+	return true;
+}
+
+void GridShardUtility::GetTileRange(int64 TileCount, const FStructHexGridShard& Shard, int64& Out_Begin, int64& Out_End)
+{
+	int64 Base = TileCount / Shard.Count;
+	int64 Rest = TileCount % Shard.Count;
+	Out_Begin = Shard.Index * Base + FMath::Min<int64>(Shard.Index, Rest);
+	Out_End = Out_Begin + Base + (Shard.Index < Rest ? 1 : 0);
+}
+
+FString GridShardUtility::GetShardPath(const FString& Path, const FStructHexGridShard& Shard)
+{
+	return FString::Printf(TEXT("%s.shard-%d-of-%d"), *Path, Shard.Index, Shard.Count);
+}
+
+bool GridShardUtility::HashFile(const FString& FullPath, int64& Out_Bytes, uint32& Out_Crc)
+{
+	return AppendFile(FullPath, nullptr, Out_Bytes, Out_Crc);
+}
+
+bool GridShardUtility::WriteManifest(const FString& FullPath, const FStructHexShardManifest& Manifest)
+{
+	//Written last and renamed into place, so a manifest only exists for a shard that finished
+	FString TmpPath = FullPath + TEXT(".tmp");
+	std::ofstream ofs;
+	ofs.open(std::filesystem::path(*TmpPath), std::ios::out | std::ios::trunc);
+	if (!ofs || !ofs.is_open()) {
+		UE_LOG(HexShard, Warning, TEXT("Open file %s failed!"), *TmpPath);
+		return false;
+	}
+
+	ofs << "HexGridShardManifest|" << SHARD_MANIFEST_VERSION << "\n";
+	ofs << TCHAR_TO_UTF8(*Manifest.Signature) << "\n";
+	ofs << Manifest.Shard.Index << "|" << Manifest.Shard.Count << "\n";
+	for (const FStructHexShardFile& File : Manifest.Files)
+	{
+		FString Str = FString::Printf(TEXT("%s|%lld|%lld|%lld|%lld|%08x"), *File.RelPath, File.TileCount, File.TileBegin,
+			File.TileEnd, File.Bytes, File.Crc);
+		ofs << TCHAR_TO_UTF8(*Str) << "\n";
+	}
+	ofs.close();
+	if (!ofs) {
+		UE_LOG(HexShard, Warning, TEXT("Write file %s failed!"), *TmpPath);
+		return false;
+	}
+
+	std::error_code ErrorCode;
+	std::filesystem::rename(std::filesystem::path(*TmpPath), std::filesystem::path(*FullPath), ErrorCode);
+	if (ErrorCode) {
+		UE_LOG(HexShard, Warning, TEXT("Rename %s to %s failed!"), *TmpPath, *FullPath);
+		return false;
+	}
+	return true;
+}
+
+bool GridShardUtility::ReadManifest(const FString& FullPath, FStructHexShardManifest& Out_Manifest)
+{
+	Out_Manifest = FStructHexShardManifest();
+	TArray<FString> Lines;
+	FString Header = FString::Printf(TEXT("HexGridShardManifest|%d"), SHARD_MANIFEST_VERSION);
+	if (!FFileHelper::LoadFileToStringArray(Lines, *FullPath) || Lines.Num() < 3 || Lines[0] != Header) {
+		UE_LOG(HexShard, Warning, TEXT("Shard manifest %s is missing or not of version %d."), *FullPath, SHARD_MANIFEST_VERSION);
+		return false;
+	}
+
+	TArray<FString> Parts;
+	Out_Manifest.Signature = Lines[1];
+	Lines[2].ParseIntoArray(Parts, TEXT("|"), false);
+	if (Parts.Num() != 2 || !ParseShard(Parts[0] + TEXT("/") + Parts[1], Out_Manifest.Shard)) {
+		UE_LOG(HexShard, Warning, TEXT("Shard manifest %s has no valid shard."), *FullPath);
+		return false;
+	}
+	for (int32 i = 3; i < Lines.Num(); i++)
+	{
+		Lines[i].ParseIntoArray(Parts, TEXT("|"), false);
+		if (Parts.Num() != 6) {
+			UE_LOG(HexShard, Warning, TEXT("Shard manifest %s line %d is invalid."), *FullPath, i + 1);
+			return false;
+		}
+		FStructHexShardFile& File = Out_Manifest.Files.AddDefaulted_GetRef();
+		File.RelPath = Parts[0];
+		File.TileCount = FCString::Atoi64(*Parts[1]);
+		File.TileBegin = FCString::Atoi64(*Parts[2]);
+		File.TileEnd = FCString::Atoi64(*Parts[3]);
+		File.Bytes = FCString::Atoi64(*Parts[4]);
+		File.Crc = (uint32)FCString::Strtoui64(*Parts[5], nullptr, 16);
+	}
+	return true;
+}
+
+bool GridShardUtility::ValidateManifests(const TArray<FStructHexShardManifest>& Manifests, const FString& Signature,
+	const TArray<FStructHexShardFile>& ExpectedFiles)
+{
+	for (int32 i = 0; i < Manifests.Num(); i++)
+	{
+		const FStructHexShardManifest& Manifest = Manifests[i];
+		if (Manifest.Signature != Signature) {
+			UE_LOG(HexShard, Warning, TEXT("Shard %d was written with other params."), i);
+			return false;
+		}
+		if (Manifest.Shard.Index != i || Manifest.Shard.Count != Manifests.Num()) {
+			UE_LOG(HexShard, Warning, TEXT("Manifest of shard %d of %d is shard %d of %d."), i, Manifests.Num(),
+				Manifest.Shard.Index, Manifest.Shard.Count);
+			return false;
+		}
+		if (Manifest.Files.Num() != ExpectedFiles.Num()) {
+			UE_LOG(HexShard, Warning, TEXT("Shard %d lists %d files, expected %d."), i, Manifest.Files.Num(), ExpectedFiles.Num());
+			return false;
+		}
+
+		for (int32 j = 0; j < ExpectedFiles.Num(); j++)
+		{
+			//Each shard starts where the one before ended, the last ends with the file
+			const FStructHexShardFile& File = Manifest.Files[j];
+			int64 Begin = i == 0 ? 0 : Manifests[i - 1].Files[j].TileEnd;
+			int64 End = i == Manifests.Num() - 1 ? ExpectedFiles[j].TileCount : File.TileEnd;
+			if (File.RelPath != ExpectedFiles[j].RelPath || File.TileCount != ExpectedFiles[j].TileCount
+				|| File.TileBegin != Begin || File.TileEnd != End || File.TileEnd < File.TileBegin || File.Bytes < 0) {
+				UE_LOG(HexShard, Warning, TEXT("Shard %d part of %s does not continue the shards before."), i, *ExpectedFiles[j].RelPath);
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+bool GridShardUtility::MergeFiles(const TArray<FStructHexShardManifest>& Manifests, const TArray<FString>& FullPaths)
+{
+	//Files are independent, every task concatenates the parts of one file into its temp file
+	std::atomic<bool> Failed{ false };
+	ParallelFor(FullPaths.Num(), [&Manifests, &FullPaths, &Failed](int32 FileIndex) {
+		FString TmpPath = FullPaths[FileIndex] + TEXT(".tmp");
+		std::ofstream ofs;
+		ofs.open(std::filesystem::path(*TmpPath), std::ios::out | std::ios::binary | std::ios::trunc);
+		if (!ofs || !ofs.is_open()) {
+			UE_LOG(HexShard, Warning, TEXT("Open file %s failed!"), *TmpPath);
+			Failed = true;
+			return;
+		}
+		for (const FStructHexShardManifest& Manifest : Manifests)
+		{
+			const FStructHexShardFile& File = Manifest.Files[FileIndex];
+			FString PartPath = GetShardPath(FullPaths[FileIndex], Manifest.Shard);
+			int64 Bytes;
+			uint32 Crc;
+			if (Failed || !AppendFile(PartPath, &ofs, Bytes, Crc)) {
+				Failed = true;
+				return;
+			}
+			if (Bytes != File.Bytes || Crc != File.Crc) {
+				UE_LOG(HexShard, Warning, TEXT("%s has %lld bytes and crc %08x, its manifest %lld and %08x."), *PartPath, Bytes, Crc,
+					File.Bytes, File.Crc);
+				Failed = true;
+				return;
+			}
+		}
+		ofs.close();
+		if (!ofs) {
+			UE_LOG(HexShard, Warning, TEXT("Write file %s failed!"), *TmpPath);
+			Failed = true;
+		}
+	});
+
+	bool Merged = !Failed && SwapFiles(FullPaths);
+	for (const FString& FullPath : FullPaths)
+	{
+		std::error_code ErrorCode;
+		std::filesystem::remove(std::filesystem::path(*(FullPath + TEXT(".tmp"))), ErrorCode);
+	}
+	return Merged;
+}
+
+bool GridShardUtility::SwapFiles(const TArray<FString>& FullPaths)
+{
+	//Every old file is kept as .bak until all new files are in place, so a failed rename can put the old set back
+	TArray<bool> HadOld;
+	int32 Swapped = 0;
+	bool Failed = false;
+	for (; Swapped < FullPaths.Num(); Swapped++)
+	{
+		std::error_code ErrorCode;
+		std::filesystem::path Path(*FullPaths[Swapped]);
+		std::filesystem::path BakPath(*(FullPaths[Swapped] + TEXT(".bak")));
+		HadOld.Add(std::filesystem::exists(Path, ErrorCode));
+		if (HadOld.Last()) {
+			std::filesystem::rename(Path, BakPath, ErrorCode);
+			if (ErrorCode) {
+				UE_LOG(HexShard, Warning, TEXT("Rename %s to its backup failed!"), *FullPaths[Swapped]);
+				HadOld.Last() = false;
+				Failed = true;
+				break;
+			}
+		}
+		std::filesystem::rename(std::filesystem::path(*(FullPaths[Swapped] + TEXT(".tmp"))), Path, ErrorCode);
+		if (ErrorCode) {
+			UE_LOG(HexShard, Warning, TEXT("Rename to %s failed!"), *FullPaths[Swapped]);
+			Failed = true;
+			//Its backup is restored with the files before it
+			Swapped++;
+			break;
+		}
+	}
+
+	for (int32 i = Swapped - 1; i >= 0; i--)
+	{
+		std::error_code ErrorCode;
+		std::filesystem::path Path(*FullPaths[i]);
+		std::filesystem::path BakPath(*(FullPaths[i] + TEXT(".bak")));
+		if (!Failed) {
+			std::filesystem::remove(BakPath, ErrorCode);
+			continue;
+		}
+		if (!HadOld[i]) {
+			std::filesystem::remove(Path, ErrorCode);
+			continue;
+		}
+		std::filesystem::rename(BakPath, Path, ErrorCode);
+		if (ErrorCode) {
+			UE_LOG(HexShard, Error, TEXT("Restore %s failed, its old content is left in %s.bak."), *FullPaths[i], *FullPaths[i]);
+		}
+	}
+	return !Failed;
+}
+
+bool GridShardUtility::AppendFile(const FString& FullPath, std::ofstream* ofs, int64& Out_Bytes, uint32& Out_Crc)
+{
+	Out_Bytes = 0;
+	Out_Crc = 0;
+	std::ifstream ifs;
+	ifs.open(std::filesystem::path(*FullPath), std::ios::in | std::ios::binary);
+	if (!ifs.is_open()) {
+		UE_LOG(HexShard, Warning, TEXT("Can not open %s."), *FullPath);
+		return false;
+	}
+
+	TArray<uint8> Buffer;
+	Buffer.SetNumUninitialized(SHARD_COPY_CHUNK_BYTES);
+	while (ifs) {
+		ifs.read(reinterpret_cast<char*>(Buffer.GetData()), Buffer.Num());
+		int32 Read = (int32)ifs.gcount();
+		if (Read == 0) {
+			break;
+		}
+		Out_Crc = FCrc::MemCrc32(Buffer.GetData(), Read, Out_Crc);
+		Out_Bytes += Read;
+		if (ofs != nullptr && !ofs->write(reinterpret_cast<const char*>(Buffer.GetData()), Read)) {
+			UE_LOG(HexShard, Warning, TEXT("Append %s failed!"), *FullPath);
+			return false;
+		}
+	}
+	if (ifs.bad()) {
+		UE_LOG(HexShard, Warning, TEXT("Read file %s failed!"), *FullPath);
+		return false;
+	}
+	return true;
+}
@@ -0,0 +1,77 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+#include <iosfwd>
+
+DECLARE_LOG_CATEGORY_EXTERN(HexShard, Log, All);
+
+#define SHARD_MANIFEST_VERSION	1
+//Bytes read at once while hashing and merging shard files
+#define SHARD_COPY_CHUNK_BYTES	(4 << 20)
+
+//Shard Index of Count, a count of 1 is a single process run
+struct FStructHexGridShard
+{
+	int32 Index = 0;
+	int32 Count = 1;
+
+	bool IsValid() const { return Count > 1; }
+};
+
+//The part of one output file written by a shard, tiles TileBegin .. TileEnd - 1 of the file's TileCount
+struct FStructHexShardFile
+{
+	FString RelPath;
+	int64 TileCount = 0;
+	int64 TileBegin = 0;
+	int64 TileEnd = 0;
+	int64 Bytes = 0;
+	uint32 Crc = 0;
+};
+
+struct FStructHexShardManifest
+{
+	//Params signature of the run, shards of different grids never merge
+	FString Signature;
+	FStructHexGridShard Shard;
+	TArray<FStructHexShardFile> Files;
+};
+
+/**
+ * Multi process generation: shard i of N writes the tiles of its contiguous spiral index range of every
+ * output file to FullPath.shard-i-of-N and lists them in a manifest with byte count and CRC32.
+ * Lines depend on the tile alone, so concatenating the parts in shard order gives the single process file.
+ * Manifest: "HexGridShardManifest|version", the signature, "index|count", then one line per file
+ * "RelPath|TileCount|TileBegin|TileEnd|Bytes|Crc".
+ */
+class CREATEGRIDDATA_API GridShardUtility
+{
+public:
+	GridShardUtility();
+	~GridShardUtility();
+
+	//"i/N" with 0 <= i < N
+	static bool ParseShard(const FString& Str, FStructHexGridShard& Out_Shard);
+	//Contiguous range of the shard, the first TileCount % Count shards take one tile more
+	static void GetTileRange(int64 TileCount, const FStructHexGridShard& Shard, int64& Out_Begin, int64& Out_End);
+	static FString GetShardPath(const FString& Path, const FStructHexGridShard& Shard);
+
+	static bool HashFile(const FString& FullPath, int64& Out_Bytes, uint32& Out_Crc);
+	static bool WriteManifest(const FString& FullPath, const FStructHexShardManifest& Manifest);
+	static bool ReadManifest(const FString& FullPath, FStructHexShardManifest& Out_Manifest);
+
+	//Manifests in shard order must match the signature and the expected files, and their ranges must cover every file without gaps
+	static bool ValidateManifests(const TArray<FStructHexShardManifest>& Manifests, const FString& Signature,
+		const TArray<FStructHexShardFile>& ExpectedFiles);
+	//Concatenates the parts of every file into FullPaths, checking each part against its manifest entry on the way.
+	//Nothing is replaced unless every part of every file matched, and a failed swap puts the old files back
+	static bool MergeFiles(const TArray<FStructHexShardManifest>& Manifests, const TArray<FString>& FullPaths);
+
+private:
+	//Renames every FullPath.tmp over its FullPath, all of them or none
+	static bool SwapFiles(const TArray<FString>& FullPaths);
+	static bool AppendFile(const FString& FullPath, std::ofstream* ofs, int64& Out_Bytes, uint32& Out_Crc);
+};
@@ -0,0 +1,62 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GridTextUtility.h"
+
+GridTextUtility::GridTextUtility()
+{
+}
+
+GridTextUtility::~GridTextUtility()
+{
+}
+
+void GridTextUtility::AppendInt(FString& InOut_Str, int64 Value)
+{
+	TCHAR Digits[24];
+	int32 Count = 0;
+	uint64 Abs = Value < 0 ? 0 - (uint64)Value : (uint64)Value;
+	do {
+		Digits[Count++] = (TCHAR)(TEXT('0') + Abs % 10);
+		Abs /= 10;
+	} while (Abs != 0);
+
+	if (Value < 0) {
+		InOut_Str.AppendChar(TEXT('-'));
+	}
+	while (Count > 0) {
+		InOut_Str.AppendChar(Digits[--Count]);
+	}
+}
+
+void GridTextUtility::AppendFloat(FString& InOut_Str, double Value)
+{
+	//Round the fractional part on its own and carry into the integral part, as FastDecimalFormat does
+	double Integral;
+	double Fraction = FMath::Modf(FMath::Abs(Value), &Integral);
+	int64 Hundredths = (int64)FMath::RoundHalfFromZero(Fraction * 100.0);
+	int64 Whole = (int64)Integral;
+	if (Hundredths >= 100) {
+		Whole++;
+		Hundredths -= 100;
+	}
+
+	if (Value < 0 && (Whole != 0 || Hundredths != 0)) {
+		InOut_Str.AppendChar(TEXT('-'));
+	}
+	AppendInt(InOut_Str, Whole);
+	if (Hundredths != 0) {
+		InOut_Str.AppendChar(TEXT('.'));
+		InOut_Str.AppendChar((TCHAR)(TEXT('0') + Hundredths / 10));
+		if (Hundredths % 10 != 0) {
+			InOut_Str.AppendChar((TCHAR)(TEXT('0') + Hundredths % 10));
+		}
+	}
+}
+
+void GridTextUtility::AppendAxial(FString& InOut_Str, const FIntPoint& Hex)
+{
+	AppendInt(InOut_Str, Hex.X);
+	InOut_Str.AppendChar(TEXT(','));
+	AppendInt(InOut_Str, Hex.Y);
+}
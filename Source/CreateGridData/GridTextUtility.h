@@ -0,0 +1,22 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Thread safe text formatting of grid values into string buffers,
+ * producing the same text as the FString and FText based Write* functions.
+ */
+class CREATEGRIDDATA_API GridTextUtility
+{
+public:
+	GridTextUtility();
+	~GridTextUtility();
+
+	static void AppendInt(FString& InOut_Str, int64 Value);
+	//Conv_FloatToText with HalfFromZero, no grouping and at most 2 fractional digits, trailing zeros trimmed
+	static void AppendFloat(FString& InOut_Str, double Value);
+	//q,r
+	static void AppendAxial(FString& InOut_Str, const FIntPoint& Hex);
+};
@@ -0,0 +1,813 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "HexGridBenchmarkCommandlet.h"
+#include "GridDataLoader.h"
+#include "GridFlowFieldUtility.h"
+#include "GridHpaUtility.h"
+#include "GridLosUtility.h"
+#include "GridNoiseUtility.h"
+#include "HexGridDataAsset.h"
+#include "HexMath.h"
+#include "HexTileSet.h"
+
+#include <Async/ParallelFor.h>
+#include <HAL/FileManager.h>
+#include <HAL/PlatformTime.h>
+#include <Misc/PackageName.h>
+#include <Misc/Paths.h>
+
+DEFINE_LOG_CATEGORY(HexGridBenchmark);
+
+//Axial helpers as AHexGridCreator had them before HexMath: out of line calls over a runtime built direction array
+struct FLegacyAxialPath
+{
+	TArray<FIntPoint> AxialDirectionVectors;
+
+	FLegacyAxialPath()
+	{
+		AxialDirectionVectors.Add(FIntPoint(1.0, 0.0));
+		AxialDirectionVectors.Add(FIntPoint(1.0, -1.0));
+		AxialDirectionVectors.Add(FIntPoint(0.0, -1.0));
+		AxialDirectionVectors.Add(FIntPoint(-1.0, 0.0));
+		AxialDirectionVectors.Add(FIntPoint(-1.0, 1.0));
+		AxialDirectionVectors.Add(FIntPoint(0.0, 1.0));
+	}
+
+	FORCENOINLINE FIntPoint AxialAdd(const FIntPoint& Hex, const FIntPoint& Vec) { return Hex + Vec; }
+	FORCENOINLINE FIntPoint AxialDirection(const int32 Direction) { return AxialDirectionVectors[Direction]; }
+	FORCENOINLINE FIntPoint AxialNeighbor(const FIntPoint& Hex, const int32 Direction) { return AxialAdd(Hex, AxialDirection(Direction)); }
+	FORCENOINLINE FIntPoint AxialScale(const FIntPoint& Hex, const int32 Factor) { return Hex * Factor; }
+};
+
+UHexGridBenchmarkCommandlet::UHexGridBenchmarkCommandlet()
+{
+	IsClient = false;
+	IsServer = false;
+	IsEditor = false;
+	LogToConsole = true;
+}
+
+int32 UHexGridBenchmarkCommandlet::Main(const FString& Params)
+{
+	TArray<FString> Tokens;
+	TArray<FString> Switches;
+	TMap<FString, FString> ParamsMap;
+	ParseCommandLine(*Params, Tokens, Switches, ParamsMap);
+
+	if (const FString* Value = ParamsMap.Find(TEXT("Iterations"))) {
+		Iterations = FMath::Max(1, FCString::Atoi(**Value));
+	}
+
+	FString Bench = ParamsMap.FindRef(TEXT("Bench"));
+	if (Bench == TEXT("Loader")) {
+		return RunLoaderBenchmark(ParamsMap);
+	}
+	if (Bench == TEXT("HexMath")) {
+		return RunHexMathBenchmark(ParamsMap);
+	}
+	if (Bench == TEXT("Fov")) {
+		return RunFovBenchmark(ParamsMap);
+	}
+	if (Bench == TEXT("Hpa")) {
+		return RunHpaBenchmark(ParamsMap);
+	}
+	if (Bench == TEXT("Noise")) {
+		return RunNoiseBenchmark(ParamsMap);
+	}
+	if (Bench == TEXT("TileSet")) {
+		return RunTileSetBenchmark(ParamsMap);
+	}
+	if (Bench == TEXT("BulkLoad")) {
+		return RunBulkLoadBenchmark(ParamsMap);
+	}
+	if (Bench == TEXT("FlowField")) {
+		return RunFlowFieldBenchmark(ParamsMap);
+	}
+
+	UE_LOG(HexGridBenchmark, Error, TEXT("Unknown benchmark '%s'."), *Bench);
+	return 1;
+}
+
+double UHexGridBenchmarkCommandlet::MeasureSeconds(TFunctionRef<bool()> Func)
+{
+	double Best = MAX_dbl;
+	for (int32 i = 0; i < Iterations; i++)
+	{
+		double Start = FPlatformTime::Seconds();
+		if (!Func()) {
+			return -1.0;
+		}
+		Best = FMath::Min(Best, FPlatformTime::Seconds() - Start);
+	}
+	return Best;
+}
+
+void UHexGridBenchmarkCommandlet::LogResult(const FString& Name, double Seconds, double Items, const TCHAR* ItemName)
+{
+	if (Seconds < 0.0) {
+		UE_LOG(HexGridBenchmark, Error, TEXT("%s failed."), *Name);
+		return;
+	}
+	UE_LOG(HexGridBenchmark, Display, TEXT("%s: %.3f ms, %.2f M %s/s"), *Name, Seconds * 1000.0,
+		Items / FMath::Max(Seconds, 1e-9) / 1e6, ItemName);
+}
+
+int32 UHexGridBenchmarkCommandlet::RunLoaderBenchmark(const TMap<FString, FString>& ParamsMap)
+{
+	FString Dir = ParamsMap.Contains(TEXT("Dir")) ? ParamsMap[TEXT("Dir")] : FPaths::ProjectDir() / TEXT("Data");
+	bool Matched = true;
+
+	auto Report = [this](const FString& Path, double Fast, double Naive) {
+		double Bytes = (double)IFileManager::Get().FileSize(*Path);
+		LogResult(Path + TEXT(" parallel"), Fast, Bytes, TEXT("bytes"));
+		LogResult(Path + TEXT(" ParseIntoArray"), Naive, Bytes, TEXT("bytes"));
+		if (Fast > 0.0 && Naive > 0.0) {
+			UE_LOG(HexGridBenchmark, Display, TEXT("%s speedup x%.1f"), *Path, Naive / Fast);
+		}
+	};
+
+	//Tiles.data
+	{
+		FString Path = Dir / TEXT("Tiles.data");
+		FStructHexTilesTable Table;
+		FStructHexTilesTable NaiveTable;
+		double Fast = MeasureSeconds([&Path, &Table]() { return GridDataLoader::LoadTiles(Path, Table); });
+		double Naive = MeasureSeconds([&Path, &NaiveTable]() { return GridDataLoader::LoadTilesNaive(Path, NaiveTable); });
+		Report(Path, Fast, Naive);
+
+		bool Same = Table.AxialCoords == NaiveTable.AxialCoords && Table.Positions.Num() == NaiveTable.Positions.Num();
+		for (int64 i = 0; Same && i < Table.Positions.Num(); i++)
+		{
+			Same = Table.Positions[i].Equals(NaiveTable.Positions[i], 1e-6);
+		}
+		Matched &= Same;
+	}
+
+	//TileIndices.data
+	{
+		FString Path = Dir / TEXT("TileIndices.data");
+		FStructHexTileIndicesTable Table;
+		FStructHexTileIndicesTable NaiveTable;
+		double Fast = MeasureSeconds([&Path, &Table]() { return GridDataLoader::LoadTileIndices(Path, Table); });
+		double Naive = MeasureSeconds([&Path, &NaiveTable]() { return GridDataLoader::LoadTileIndicesNaive(Path, NaiveTable); });
+		Report(Path, Fast, Naive);
+		Matched &= Table.AxialCoords == NaiveTable.AxialCoords && Table.Indices == NaiveTable.Indices;
+	}
+
+	//N1.data .. N{r}.data, as many as were written
+	for (int32 Radius = 1; ; Radius++)
+	{
+		FString Path = Dir / FString::Printf(TEXT("N%d.data"), Radius);
+		if (!IFileManager::Get().FileExists(*Path)) {
+			break;
+		}
+		FStructHexNeighborTable Table;
+		FStructHexNeighborTable NaiveTable;
+		double Fast = MeasureSeconds([&Path, &Table]() { return GridDataLoader::LoadNeighbors(Path, Table); });
+		double Naive = MeasureSeconds([&Path, &NaiveTable]() { return GridDataLoader::LoadNeighborsNaive(Path, NaiveTable); });
+		Report(Path, Fast, Naive);
+		Matched &= Table.Offsets == NaiveTable.Offsets && Table.Tiles == NaiveTable.Tiles;
+	}
+
+	if (!Matched) {
+		UE_LOG(HexGridBenchmark, Error, TEXT("Parallel and ParseIntoArray results differ."));
+		return 1;
+	}
+	return 0;
+}
+
+int32 UHexGridBenchmarkCommandlet::RunHexMathBenchmark(const TMap<FString, FString>& ParamsMap)
+{
+	int32 GridRange = ParamsMap.Contains(TEXT("GridRange")) ? FCString::Atoi(*ParamsMap[TEXT("GridRange")]) : 200;
+	int32 NeighborRange = ParamsMap.Contains(TEXT("NeighborRange")) ? FCString::Atoi(*ParamsMap[TEXT("NeighborRange")]) : 5;
+	double Entries = (double)HexMath::GetTileCount(GridRange) * 3.0 * NeighborRange * (NeighborRange + 1);
+
+	//Every neighbor ring of every tile, as SpiralCreateNeighbors walks them, summed so the walk is not optimized away
+	int64 LegacySum = 0;
+	FLegacyAxialPath Legacy;
+	double LegacySeconds = MeasureSeconds([&]() {
+		LegacySum = 0;
+		for (const HexMath::FAxial& Center : HexMath::Spiral(HexMath::FAxial(), GridRange))
+		{
+			for (int32 Radius = 1; Radius <= NeighborRange; Radius++)
+			{
+				FIntPoint Hex = Legacy.AxialAdd(Legacy.AxialScale(Legacy.AxialDirection(HexMath::RingStartDirection), Radius), Center.ToIntPoint());
+				for (int32 Side = 0; Side <= 5; Side++)
+				{
+					for (int32 Step = 0; Step <= Radius - 1; Step++)
+					{
+						LegacySum += Hex.X * 3 + Hex.Y;
+						Hex = Legacy.AxialNeighbor(Hex, Side);
+					}
+				}
+			}
+		}
+		return true;
+	});
+
+	int64 HexMathSum = 0;
+	double HexMathSeconds = MeasureSeconds([&]() {
+		HexMathSum = 0;
+		for (const HexMath::FAxial& Center : HexMath::Spiral(HexMath::FAxial(), GridRange))
+		{
+			for (int32 Radius = 1; Radius <= NeighborRange; Radius++)
+			{
+				for (const HexMath::FAxial& Hex : HexMath::Ring(Center, Radius))
+				{
+					HexMathSum += Hex.Q * 3 + Hex.R;
+				}
+			}
+		}
+		return true;
+	});
+
+	LogResult(TEXT("Ring member functions"), LegacySeconds, Entries, TEXT("hexes"));
+	LogResult(TEXT("Ring HexMath"), HexMathSeconds, Entries, TEXT("hexes"));
+	UE_LOG(HexGridBenchmark, Display, TEXT("HexMath speedup x%.1f"), LegacySeconds / FMath::Max(HexMathSeconds, 1e-9));
+
+	if (LegacySum != HexMathSum) {
+		UE_LOG(HexGridBenchmark, Error, TEXT("Ring walks differ."));
+		return 1;
+	}
+	return 0;
+}
+
+int32 UHexGridBenchmarkCommandlet::RunFovBenchmark(const TMap<FString, FString>& ParamsMap)
+{
+	int32 GridRange = ParamsMap.Contains(TEXT("GridRange")) ? FCString::Atoi(*ParamsMap[TEXT("GridRange")]) : 200;
+	int32 Radius = ParamsMap.Contains(TEXT("Radius")) ? FCString::Atoi(*ParamsMap[TEXT("Radius")]) : 10;
+	int32 BlockerPercent = ParamsMap.Contains(TEXT("BlockerPercent")) ? FCString::Atoi(*ParamsMap[TEXT("BlockerPercent")]) : 20;
+
+	FStructHexLosStencil Stencil;
+	if (!GridLosUtility::Build(Radius, Stencil)) {
+		return 1;
+	}
+	//Fixed seed, so runs compare the same grid
+	FRandomStream Random(GridRange);
+	TBitArray<> Blockers(false, HexMath::GetTileCount(GridRange));
+	for (int64 i = 0; i < Blockers.Num(); i++)
+	{
+		Blockers[i] = Random.RandRange(0, 99) < BlockerPercent;
+	}
+	double Tests = (double)HexMath::GetTileCount(GridRange) * Stencil.GetOffsetCount();
+
+	//FOV of every tile of the grid, the count of visible offsets keeps the work from being optimized away
+	int64 TraceSeen = 0;
+	double TraceSeconds = MeasureSeconds([&]() {
+		TraceSeen = 0;
+		TArray<HexMath::FAxial> Line;
+		for (const HexMath::FAxial& Origin : HexMath::Spiral(HexMath::FAxial(), GridRange))
+		{
+			for (const FIntPoint& Offset : Stencil.Offsets)
+			{
+				HexMath::FAxial Target = Origin + HexMath::FAxial(Offset);
+				if (HexMath::Length(Target) > GridRange) {
+					continue;
+				}
+				HexMath::Line(Origin, Target, Line);
+				bool Seen = true;
+				for (int32 j = 1; Seen && j < Line.Num() - 1; j++)
+				{
+					Seen = HexMath::Length(Line[j]) <= GridRange && !Blockers[HexMath::AxialToSpiralIndex(Line[j])];
+				}
+				TraceSeen += Seen ? 1 : 0;
+			}
+		}
+		return true;
+	});
+
+	int64 StencilSeen = 0;
+	double StencilSeconds = MeasureSeconds([&]() {
+		StencilSeen = 0;
+		TBitArray<> Visible;
+		for (const HexMath::FAxial& Origin : HexMath::Spiral(HexMath::FAxial(), GridRange))
+		{
+			GridLosUtility::ComputeFov(Stencil, Origin.ToIntPoint(), Radius, GridRange, Blockers, Visible);
+			StencilSeen += Visible.CountSetBits();
+		}
+		return true;
+	});
+
+	LogResult(TEXT("FOV traced lines"), TraceSeconds, Tests, TEXT("offsets"));
+	LogResult(TEXT("FOV stencil"), StencilSeconds, Tests, TEXT("offsets"));
+	UE_LOG(HexGridBenchmark, Display, TEXT("Stencil speedup x%.1f"), TraceSeconds / FMath::Max(StencilSeconds, 1e-9));
+
+	if (TraceSeen != StencilSeen) {
+		UE_LOG(HexGridBenchmark, Error, TEXT("Traced and stencil FOV differ, %lld against %lld visible."), TraceSeen, StencilSeen);
+		return 1;
+	}
+	return 0;
+}
+
+int32 UHexGridBenchmarkCommandlet::RunHpaBenchmark(const TMap<FString, FString>& ParamsMap)
+{
+	FString Dir = ParamsMap.Contains(TEXT("Dir")) ? ParamsMap[TEXT("Dir")] : FPaths::ProjectDir() / TEXT("Data");
+	int32 ClusterRadius = ParamsMap.Contains(TEXT("ClusterRadius")) ? FCString::Atoi(*ParamsMap[TEXT("ClusterRadius")]) : 8;
+	int32 QueryCount = ParamsMap.Contains(TEXT("Queries")) ? FMath::Max(1, FCString::Atoi(*ParamsMap[TEXT("Queries")])) : 1000;
+	int32 BlockerPercent = ParamsMap.Contains(TEXT("BlockerPercent")) ? FCString::Atoi(*ParamsMap[TEXT("BlockerPercent")]) : 20;
+
+	FStructHexTilesTable Tiles;
+	FStructHexNeighborTable N1;
+	if (!GridDataLoader::LoadTiles(Dir / TEXT("Tiles.data"), Tiles) || !GridDataLoader::LoadNeighbors(Dir / TEXT("N1.data"), N1)) {
+		return 1;
+	}
+	const int64 TileCount = Tiles.AxialCoords.Num();
+	if (TileCount == 0) {
+		return 1;
+	}
+
+	//Fixed seed, so runs compare the same blockers and queries
+	FRandomStream Random(ClusterRadius);
+	TBitArray<> Blocked(false, TileCount);
+	for (int64 i = 0; i < TileCount; i++)
+	{
+		Blocked[i] = Random.RandRange(0, 99) < BlockerPercent;
+	}
+	FStructHexTileGraph TileGraph;
+	FStructHexHpaGraph Graph;
+	if (!GridHpaUtility::BuildTileGraph(Tiles.AxialCoords, &N1, &Blocked, TileGraph)) {
+		return 1;
+	}
+	double BuildSeconds = MeasureSeconds([&TileGraph, &Graph, ClusterRadius]() { return GridHpaUtility::Build(TileGraph, ClusterRadius, Graph); });
+	LogResult(TEXT("HPA build"), BuildSeconds, (double)TileCount, TEXT("tiles"));
+
+	TArray<TPair<uint32, uint32>> Queries;
+	for (int32 i = 0; i < QueryCount; i++)
+	{
+		Queries.Emplace((uint32)Random.RandRange(0, (int32)(TileCount - 1)), (uint32)Random.RandRange(0, (int32)(TileCount - 1)));
+	}
+
+	//Both searches keep their results, so the check below sees the last run
+	FStructHexPathScratch Scratch;
+	TArray<FStructHexPathResult> FlatResults;
+	TArray<FStructHexPathResult> HpaResults;
+	FlatResults.SetNum(QueryCount);
+	HpaResults.SetNum(QueryCount);
+	double FlatSeconds = MeasureSeconds([&]() {
+		for (int32 i = 0; i < QueryCount; i++)
+		{
+			GridHpaUtility::FindPathFlat(TileGraph, Queries[i].Key, Queries[i].Value, Scratch, FlatResults[i]);
+		}
+		return true;
+	});
+	double HpaSeconds = MeasureSeconds([&]() {
+		for (int32 i = 0; i < QueryCount; i++)
+		{
+			GridHpaUtility::FindPathAbstract(TileGraph, Graph, Queries[i].Key, Queries[i].Value, Scratch, HpaResults[i]);
+		}
+		return true;
+	});
+
+	int64 FlatExpanded = 0;
+	int64 HpaExpanded = 0;
+	double CostRatio = 0.0;
+	int32 PathCount = 0;
+	bool Matched = true;
+	for (int32 i = 0; i < QueryCount; i++)
+	{
+		const FStructHexPathResult& Flat = FlatResults[i];
+		const FStructHexPathResult& Hpa = HpaResults[i];
+		FlatExpanded += Flat.Expanded;
+		HpaExpanded += Hpa.Expanded;
+		//Every crossing edge reaches the entrance of its run on both sides, so reachability matches and the cost can only be over
+		Matched &= Flat.Found == Hpa.Found && (!Flat.Found || Hpa.Cost >= Flat.Cost);
+		if (Flat.Found && Flat.Cost > 0) {
+			CostRatio += (double)Hpa.Cost / Flat.Cost;
+			PathCount++;
+		}
+	}
+
+	//Neighbors across a cluster border are where the entrances can lose a connection, so every open pair of them is searched
+	int64 BorderPairs = 0;
+	int64 BorderMissed = 0;
+	FStructHexPathResult BorderResult;
+	for (uint32 Tile = 0; Tile < (uint32)TileCount; Tile++)
+	{
+		for (int64 j = TileGraph.Neighbors.Offsets[Tile]; j < TileGraph.Neighbors.Offsets[Tile + 1]; j++)
+		{
+			uint32 Next = TileGraph.Neighbors.Ids[j];
+			if (Next > Tile && Graph.TileClusters[Next] != Graph.TileClusters[Tile]) {
+				GridHpaUtility::FindPathAbstract(TileGraph, Graph, Tile, Next, Scratch, BorderResult);
+				BorderPairs++;
+				BorderMissed += BorderResult.Found ? 0 : 1;
+			}
+		}
+	}
+
+	LogResult(TEXT("Flat A*"), FlatSeconds, QueryCount, TEXT("queries"));
+	LogResult(TEXT("HPA*"), HpaSeconds, QueryCount, TEXT("queries"));
+	UE_LOG(HexGridBenchmark, Display, TEXT("%lld clusters, %lld nodes. Expanded per query: flat %.0f, HPA %.0f. HPA cost x%.3f of optimal."),
+		Graph.ClusterCount, Graph.GetNodeCount(), (double)FlatExpanded / QueryCount, (double)HpaExpanded / QueryCount,
+		PathCount > 0 ? CostRatio / PathCount : 1.0);
+	UE_LOG(HexGridBenchmark, Display, TEXT("HPA speedup x%.1f"), FlatSeconds / FMath::Max(HpaSeconds, 1e-9));
+
+	if (!Matched) {
+		UE_LOG(HexGridBenchmark, Error, TEXT("Flat and HPA searches disagree on reachability or cost."));
+		return 1;
+	}
+	if (BorderMissed > 0) {
+		UE_LOG(HexGridBenchmark, Error, TEXT("HPA search misses %lld of %lld neighbor pairs across cluster borders."), BorderMissed, BorderPairs);
+		return 1;
+	}
+	return 0;
+}
+
+int32 UHexGridBenchmarkCommandlet::RunNoiseBenchmark(const TMap<FString, FString>& ParamsMap)
+{
+	int32 GridRange = ParamsMap.Contains(TEXT("GridRange")) ? FCString::Atoi(*ParamsMap[TEXT("GridRange")]) : 200;
+	FStructHexNoiseChannel Channel;
+	if (ParamsMap.Contains(TEXT("Octaves"))) {
+		Channel.Octaves = FMath::Clamp(FCString::Atoi(*ParamsMap[TEXT("Octaves")]), 1, 16);
+	}
+	const float TileSize = 100.0f;
+	const int64 TileCount = HexMath::GetTileCount(GridRange);
+	TArray64<float> X, Y;
+	X.SetNumUninitialized(TileCount);
+	Y.SetNumUninitialized(TileCount);
+	int64 Index = 0;
+	for (const HexMath::FAxial& Hex : HexMath::Spiral(HexMath::FAxial(), GridRange))
+	{
+		FVector2D Position = HexMath::AxialToPosition(Hex, TileSize);
+		X[Index] = (float)Position.X;
+		Y[Index] = (float)Position.Y;
+		Index++;
+	}
+
+	//One sample call per tile and octave, as a pass over the spawned tiles does it
+	TArray64<float> PerTile, Batched, Parallel;
+	PerTile.SetNumUninitialized(TileCount);
+	Batched.SetNumUninitialized(TileCount);
+	Parallel.SetNumUninitialized(TileCount);
+	double PerTileSeconds = MeasureSeconds([&]() {
+		for (int64 i = 0; i < TileCount; i++)
+		{
+			float Frequency = Channel.Frequency;
+			float Amplitude = 1.0f;
+			float Sum = 0.0f;
+			for (int32 Octave = 0; Octave < Channel.Octaves; Octave++)
+			{
+				Sum += Amplitude * FMath::PerlinNoise2D(FVector2D(X[i] * Frequency + Octave * 17.0f, Y[i] * Frequency));
+				Frequency *= Channel.Lacunarity;
+				Amplitude *= Channel.Gain;
+			}
+			PerTile[i] = Sum;
+		}
+		return true;
+	});
+
+	double BatchedSeconds = MeasureSeconds([&]() {
+		for (int64 Begin = 0; Begin < TileCount; Begin += NOISE_BATCH_TILES)
+		{
+			int32 Count = (int32)(FMath::Min<int64>(Begin + NOISE_BATCH_TILES, TileCount) - Begin);
+			GridNoiseUtility::EvaluateFbm(Channel, X.GetData() + Begin, Y.GetData() + Begin, Count, Batched.GetData() + Begin);
+		}
+		return true;
+	});
+
+	int32 BatchCount = (int32)((TileCount + NOISE_BATCH_TILES - 1) / NOISE_BATCH_TILES);
+	double ParallelSeconds = MeasureSeconds([&]() {
+		ParallelFor(BatchCount, [&](int32 BatchIndex) {
+			int64 Begin = (int64)BatchIndex * NOISE_BATCH_TILES;
+			int32 Count = (int32)(FMath::Min<int64>(Begin + NOISE_BATCH_TILES, TileCount) - Begin);
+			GridNoiseUtility::EvaluateFbm(Channel, X.GetData() + Begin, Y.GetData() + Begin, Count, Parallel.GetData() + Begin);
+		});
+		return true;
+	});
+
+	LogResult(TEXT("Noise per tile PerlinNoise2D"), PerTileSeconds, (double)TileCount, TEXT("tiles"));
+	LogResult(TEXT("Noise batched"), BatchedSeconds, (double)TileCount, TEXT("tiles"));
+	LogResult(TEXT("Noise batched ParallelFor"), ParallelSeconds, (double)TileCount, TEXT("tiles"));
+	UE_LOG(HexGridBenchmark, Display, TEXT("Batched speedup x%.1f, ParallelFor speedup x%.1f"), PerTileSeconds / FMath::Max(BatchedSeconds, 1e-9),
+		PerTileSeconds / FMath::Max(ParallelSeconds, 1e-9));
+
+	//Batches do not depend on each other, so the split over threads must not change a value
+	bool Matched = true;
+	for (int64 i = 0; i < TileCount; i++)
+	{
+		Matched &= Batched[i] == Parallel[i] && FMath::Abs(Batched[i]) <= 1.0f;
+	}
+	if (!Matched) {
+		UE_LOG(HexGridBenchmark, Error, TEXT("Batched and ParallelFor noise differ or leave -1 .. 1."));
+		return 1;
+	}
+	return 0;
+}
+
+int32 UHexGridBenchmarkCommandlet::RunTileSetBenchmark(const TMap<FString, FString>& ParamsMap)
+{
+	int32 GridRange = ParamsMap.Contains(TEXT("GridRange")) ? FCString::Atoi(*ParamsMap[TEXT("GridRange")]) : 200;
+	int32 Radius = ParamsMap.Contains(TEXT("Radius")) ? FCString::Atoi(*ParamsMap[TEXT("Radius")]) : 5;
+	int32 QueryCount = ParamsMap.Contains(TEXT("Queries")) ? FMath::Max(1, FCString::Atoi(*ParamsMap[TEXT("Queries")])) : 1000;
+
+	//Spiral order, so tile index and spiral index agree
+	TArray64<FIntPoint> AxialCoords;
+	for (const HexMath::FAxial& Hex : HexMath::Spiral(HexMath::FAxial(), GridRange))
+	{
+		AxialCoords.Add(Hex.ToIntPoint());
+	}
+	FStructHexTileGraph Graph;
+	if (!GridHpaUtility::BuildTileGraph(AxialCoords, nullptr, nullptr, Graph)) {
+		return 1;
+	}
+	const int64 TileCount = Graph.GetTileCount();
+
+	//Fixed seed, pairs of ranges close enough to overlap like a unit's reach and an enemy zone
+	FRandomStream Random(GridRange);
+	TArray<TPair<uint32, uint32>> Pairs;
+	for (int32 i = 0; i < QueryCount; i++)
+	{
+		HexMath::FAxial A(AxialCoords[Random.RandRange(0, (int32)TileCount - 1)]);
+		HexMath::FAxial B = A + HexMath::Direction<int32>(Random.RandRange(0, 5)) * Random.RandRange(0, 2 * Radius);
+		Pairs.Emplace((uint32)HexMath::AxialToSpiralIndex(A), HexMath::Length(B) <= GridRange ? (uint32)HexMath::AxialToSpiralIndex(B) : 0);
+	}
+
+	//Ranges from the neighbor rings of the center, as gameplay code collects them
+	auto BuildTSet = [&AxialCoords, GridRange, Radius](uint32 Center, TSet<FIntPoint>& Out_Set) {
+		HexMath::FAxial CenterHex(AxialCoords[Center]);
+		Out_Set.Reset();
+		Out_Set.Add(CenterHex.ToIntPoint());
+		for (int32 r = 1; r <= Radius; r++)
+		{
+			for (const HexMath::FAxial& Hex : HexMath::Ring(CenterHex, r))
+			{
+				if (HexMath::Length(Hex) <= GridRange) {
+					Out_Set.Add(Hex.ToIntPoint());
+				}
+			}
+		}
+	};
+
+	TArray<TSet<FIntPoint>> TSets;
+	TArray<FHexTileSet> TileSets;
+	TSets.SetNum(QueryCount * 2);
+	TileSets.Init(FHexTileSet(TileCount), QueryCount * 2);
+	double TSetBuildSeconds = MeasureSeconds([&]() {
+		for (int32 i = 0; i < QueryCount; i++)
+		{
+			BuildTSet(Pairs[i].Key, TSets[i * 2]);
+			BuildTSet(Pairs[i].Value, TSets[i * 2 + 1]);
+		}
+		return true;
+	});
+	double TileSetBuildSeconds = MeasureSeconds([&]() {
+		for (int32 i = 0; i < QueryCount; i++)
+		{
+			TileSets[i * 2].SetRange(Graph, Pairs[i].Key, Radius);
+			TileSets[i * 2 + 1].SetRange(Graph, Pairs[i].Value, Radius);
+		}
+		return true;
+	});
+
+	//Union, intersection and difference counts, and the tiles of the intersection visited
+	int64 TSetSum = 0;
+	double TSetOpsSeconds = MeasureSeconds([&]() {
+		TSetSum = 0;
+		for (int32 i = 0; i < QueryCount; i++)
+		{
+			const TSet<FIntPoint>& A = TSets[i * 2];
+			const TSet<FIntPoint>& B = TSets[i * 2 + 1];
+			TSet<FIntPoint> Both = A.Intersect(B);
+			TSetSum += A.Union(B).Num() + Both.Num() + A.Difference(B).Num();
+			for (const FIntPoint& Hex : Both)
+			{
+				TSetSum += HexMath::AxialToSpiralIndex(HexMath::FAxial(Hex));
+			}
+		}
+		return true;
+	});
+
+	int64 TileSetSum = 0;
+	double TileSetOpsSeconds = MeasureSeconds([&]() {
+		TileSetSum = 0;
+		FHexTileSet Result(TileCount);
+		for (int32 i = 0; i < QueryCount; i++)
+		{
+			const FHexTileSet& A = TileSets[i * 2];
+			const FHexTileSet& B = TileSets[i * 2 + 1];
+			Result = A;
+			Result |= B;
+			TileSetSum += Result.Num();
+			Result = A;
+			Result -= B;
+			TileSetSum += Result.Num();
+			Result = A;
+			Result &= B;
+			TileSetSum += Result.Num();
+			Result.ForEach([&TileSetSum](uint32 Tile) {
+				TileSetSum += Tile;
+			});
+		}
+		return true;
+	});
+
+	LogResult(TEXT("TSet build"), TSetBuildSeconds, QueryCount * 2.0, TEXT("ranges"));
+	LogResult(TEXT("FHexTileSet build"), TileSetBuildSeconds, QueryCount * 2.0, TEXT("ranges"));
+	LogResult(TEXT("TSet set operations"), TSetOpsSeconds, QueryCount, TEXT("pairs"));
+	LogResult(TEXT("FHexTileSet set operations"), TileSetOpsSeconds, QueryCount, TEXT("pairs"));
+	UE_LOG(HexGridBenchmark, Display, TEXT("%lld tiles in %lld words. Build speedup x%.1f, set operations speedup x%.1f"), TileCount,
+		TileSets[0].GetWords().Num(), TSetBuildSeconds / FMath::Max(TileSetBuildSeconds, 1e-9), TSetOpsSeconds / FMath::Max(TileSetOpsSeconds, 1e-9));
+
+	bool Matched = TSetSum == TileSetSum;
+	for (int32 i = 0; Matched && i < TSets.Num(); i++)
+	{
+		Matched = TSets[i].Num() == TileSets[i].Num();
+	}
+	if (!Matched) {
+		UE_LOG(HexGridBenchmark, Error, TEXT("TSet and FHexTileSet results differ."));
+		return 1;
+	}
+	return 0;
+}
+
+int32 UHexGridBenchmarkCommandlet::RunBulkLoadBenchmark(const TMap<FString, FString>& ParamsMap)
+{
+	FString Dir = ParamsMap.Contains(TEXT("Dir")) ? ParamsMap[TEXT("Dir")] : FPaths::ProjectDir() / TEXT("Data");
+	FString PackageName = ParamsMap.Contains(TEXT("Asset")) ? ParamsMap[TEXT("Asset")] : FString(TEXT("/Game/HexGrid/HexGridData"));
+
+	//Timed once, a second load finds the asset in memory. It reads the package, and an inline payload with it
+	double Start = FPlatformTime::Seconds();
+	UHexGridDataAsset* Asset = LoadObject<UHexGridDataAsset>(nullptr, *(PackageName + TEXT(".") + FPackageName::GetShortName(PackageName)));
+	double AssetSeconds = FPlatformTime::Seconds() - Start;
+	if (Asset == nullptr) {
+		UE_LOG(HexGridBenchmark, Error, TEXT("Can not load %s, run the creator with -BulkAsset first."), *PackageName);
+		return 1;
+	}
+	const double Bytes = (double)Asset->GetPayloadBytes();
+
+	FStructHexTilesTable TextTiles;
+	FStructHexTileIndicesTable TextTileIndices;
+	TArray<FStructHexNeighborTable> TextNeighbors;
+	TextNeighbors.SetNum(Asset->NeighborRange);
+	double TextSeconds = MeasureSeconds([&]() {
+		bool Loaded = GridDataLoader::LoadTiles(Dir / TEXT("Tiles.data"), TextTiles)
+			&& GridDataLoader::LoadTileIndices(Dir / TEXT("TileIndices.data"), TextTileIndices);
+		for (int32 Radius = 1; Loaded && Radius <= Asset->NeighborRange; Radius++)
+		{
+			Loaded = GridDataLoader::LoadNeighbors(Dir / FString::Printf(TEXT("N%d.data"), Radius), TextNeighbors[Radius - 1]);
+		}
+		return Loaded;
+	});
+
+	FStructHexTilesTable AssetTiles;
+	FStructHexTileIndicesTable AssetTileIndices;
+	TArray<FStructHexNeighborTable> AssetNeighbors;
+	double PayloadSeconds = MeasureSeconds([&]() {
+		return Asset->LoadTables(AssetTiles, AssetTileIndices, AssetNeighbors);
+	});
+	if (TextSeconds < 0.0 || PayloadSeconds < 0.0) {
+		UE_LOG(HexGridBenchmark, Error, TEXT("Can not load the %s, run the creator with -BulkAsset again."),
+			TextSeconds < 0.0 ? TEXT("text files") : TEXT("asset payload"));
+		return 1;
+	}
+
+	FString ModeName = StaticEnum<Enum_HexGridBulkLoadMode>()->GetNameStringByValue((int64)Asset->LoadMode);
+	LogResult(TEXT("Asset package load"), AssetSeconds, Bytes, TEXT("bytes"));
+	LogResult(FString::Printf(TEXT("Asset payload %s%s"), *ModeName, Asset->IsPayloadMapped() ? TEXT(" mapped") : TEXT("")), PayloadSeconds, Bytes,
+		TEXT("bytes"));
+	LogResult(TEXT("Text files parallel loader"), TextSeconds, Bytes, TEXT("bytes"));
+	UE_LOG(HexGridBenchmark, Display, TEXT("Asset speedup x%.1f over the text files, payload only x%.1f"),
+		TextSeconds / FMath::Max(AssetSeconds + PayloadSeconds, 1e-9), TextSeconds / FMath::Max(PayloadSeconds, 1e-9));
+
+	//Same tiles and tile indices in the same order, the same neighbor lines, masked or not
+	bool Matched = AssetTiles.AxialCoords == TextTiles.AxialCoords && AssetTileIndices.AxialCoords == TextTileIndices.AxialCoords
+		&& AssetTileIndices.Indices == TextTileIndices.Indices && AssetNeighbors.Num() == TextNeighbors.Num();
+	for (int32 i = 0; Matched && i < AssetNeighbors.Num(); i++)
+	{
+		Matched = AssetNeighbors[i].Offsets == TextNeighbors[i].Offsets && AssetNeighbors[i].Tiles == TextNeighbors[i].Tiles;
+	}
+	if (!Matched) {
+		UE_LOG(HexGridBenchmark, Error, TEXT("Asset and text files hold different grids."));
+		return 1;
+	}
+	return 0;
+}
+
+int32 UHexGridBenchmarkCommandlet::RunFlowFieldBenchmark(const TMap<FString, FString>& ParamsMap)
+{
+	int32 GridRange = ParamsMap.Contains(TEXT("GridRange")) ? FCString::Atoi(*ParamsMap[TEXT("GridRange")]) : 500;
+	int32 SourceCount = ParamsMap.Contains(TEXT("Sources")) ? FMath::Max(1, FCString::Atoi(*ParamsMap[TEXT("Sources")])) : 4;
+	int32 MaxCost = ParamsMap.Contains(TEXT("MaxCost")) ? FMath::Clamp(FCString::Atoi(*ParamsMap[TEXT("MaxCost")]), 1, 255) : 1;
+	int32 AgentCount = ParamsMap.Contains(TEXT("Agents")) ? FMath::Max(1, FCString::Atoi(*ParamsMap[TEXT("Agents")])) : 1000;
+
+	TArray64<FIntPoint> AxialCoords;
+	for (const HexMath::FAxial& Hex : HexMath::Spiral(HexMath::FAxial(), GridRange))
+	{
+		AxialCoords.Add(Hex.ToIntPoint());
+	}
+	FStructHexTileGraph Graph;
+	if (!GridHpaUtility::BuildTileGraph(AxialCoords, nullptr, nullptr, Graph)) {
+		return 1;
+	}
+	const int64 TileCount = Graph.GetTileCount();
+
+	//Fixed seed, so runs compare the same sources and costs
+	FRandomStream Random(GridRange);
+	TArray<uint32> Sources;
+	for (int32 i = 0; i < SourceCount; i++)
+	{
+		Sources.Add((uint32)Random.RandRange(0, (int32)TileCount - 1));
+	}
+	TArray64<uint8> Costs;
+	Costs.SetNumUninitialized(TileCount);
+	for (int64 i = 0; i < TileCount; i++)
+	{
+		Costs[i] = (uint8)Random.RandRange(1, MaxCost);
+	}
+	const TArray64<uint8>* CostsPtr = MaxCost > 1 ? &Costs : nullptr;
+
+	//Single threaded Dijkstra over a binary heap, the search every agent ran before
+	TArray64<uint32> Reference;
+	double HeapSeconds = MeasureSeconds([&]() {
+		typedef TPair<uint32, uint32> FEntry;
+		auto EntryLess = [](const FEntry& A, const FEntry& B) { return A.Key < B.Key; };
+		TArray<FEntry> Open;
+		Reference.Init(FLOW_UNREACHED, TileCount);
+		for (uint32 Source : Sources)
+		{
+			Reference[Source] = 0;
+			Open.HeapPush(FEntry(0, Source), EntryLess);
+		}
+		while (Open.Num() > 0) {
+			FEntry Entry;
+			Open.HeapPop(Entry, EntryLess, EAllowShrinking::No);
+			if (Entry.Key != Reference[Entry.Value]) {
+				continue;
+			}
+			for (int64 j = Graph.Neighbors.Offsets[Entry.Value]; j < Graph.Neighbors.Offsets[Entry.Value + 1]; j++)
+			{
+				uint32 Neighbor = Graph.Neighbors.Ids[j];
+				uint32 Offer = Entry.Key + (CostsPtr != nullptr ? Costs[Neighbor] : 1);
+				if (Offer < Reference[Neighbor]) {
+					Reference[Neighbor] = Offer;
+					Open.HeapPush(FEntry(Offer, Neighbor), EntryLess);
+				}
+			}
+		}
+		return true;
+	});
+
+	FStructHexFlowField Field;
+	double FieldSeconds = MeasureSeconds([&]() { return GridFlowFieldUtility::Build(Graph, Sources, CostsPtr, Field); });
+	LogResult(TEXT("Heap Dijkstra"), HeapSeconds, (double)TileCount, TEXT("tiles"));
+	LogResult(TEXT("Flow field"), FieldSeconds, (double)TileCount, TEXT("tiles"));
+	UE_LOG(HexGridBenchmark, Display, TEXT("Flow field speedup x%.1f, %.1f MB stored"), HeapSeconds / FMath::Max(FieldSeconds, 1e-9),
+		GridFlowFieldUtility::EstimateFileBytes(TileCount, SourceCount) / (1024.0 * 1024.0));
+
+	//Every step of a direction has to lower the distance by the cost of the tile it leaves
+	bool Matched = FieldSeconds >= 0.0 && Field.Distances == Reference;
+	for (int64 i = 0; Matched && i < TileCount; i++)
+	{
+		uint32 Next = GridFlowFieldUtility::GetNextTile(Graph, Field, (uint32)i);
+		uint32 Cost = CostsPtr != nullptr ? Costs[i] : 1;
+		Matched = Field.Distances[i] == 0 ? Next == HPA_NONE : Next != HPA_NONE && Field.Distances[Next] + Cost == Field.Distances[i];
+	}
+
+	//Agents spread over the grid heading to the same source: one field and a walk each, against one A* each
+	TArray<uint32> Agents;
+	for (int32 i = 0; i < AgentCount; i++)
+	{
+		Agents.Add((uint32)Random.RandRange(0, (int32)TileCount - 1));
+	}
+	const TArray<uint32> Goal = { Sources[0] };
+	FStructHexFlowField GoalField;
+	TArray<uint32> WalkSteps;
+	WalkSteps.SetNum(AgentCount);
+	double WalkSeconds = MeasureSeconds([&]() {
+		if (!GridFlowFieldUtility::Build(Graph, Goal, nullptr, GoalField)) {
+			return false;
+		}
+		for (int32 i = 0; i < AgentCount; i++)
+		{
+			WalkSteps[i] = 0;
+			for (uint32 Tile = Agents[i]; Tile != Goal[0] && Tile != HPA_NONE; Tile = GridFlowFieldUtility::GetNextTile(Graph, GoalField, Tile))
+			{
+				WalkSteps[i]++;
+			}
+		}
+		return true;
+	});
+	FStructHexPathScratch Scratch;
+	TArray<FStructHexPathResult> FlatResults;
+	FlatResults.SetNum(AgentCount);
+	double FlatSeconds = MeasureSeconds([&]() {
+		for (int32 i = 0; i < AgentCount; i++)
+		{
+			GridHpaUtility::FindPathFlat(Graph, Agents[i], Goal[0], Scratch, FlatResults[i]);
+		}
+		return true;
+	});
+	for (int32 i = 0; Matched && i < AgentCount; i++)
+	{
+		Matched = FlatResults[i].Found && FlatResults[i].Cost == WalkSteps[i];
+	}
+	LogResult(TEXT("Flow field walks"), WalkSeconds, AgentCount, TEXT("agents"));
+	LogResult(TEXT("Flat A* per agent"), FlatSeconds, AgentCount, TEXT("agents"));
+	UE_LOG(HexGridBenchmark, Display, TEXT("Flow field speedup over A* x%.1f"), FlatSeconds / FMath::Max(WalkSeconds, 1e-9));
+
+	if (!Matched) {
+		UE_LOG(HexGridBenchmark, Error, TEXT("Flow field disagrees with Dijkstra or A* on distances or steps."));
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,50 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "HexGridBenchmarkCommandlet.generated.h"
+
+DECLARE_LOG_CATEGORY_EXTERN(HexGridBenchmark, Log, All);
+
+/**
+ * Benchmarks of the grid data code, run headless with
+ * UnrealEditor-Cmd CreateGridData.uproject -run=HexGridBenchmark -Bench=<Name> [-Iterations=N]
+ */
+UCLASS()
+class CREATEGRIDDATA_API UHexGridBenchmarkCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UHexGridBenchmarkCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+
+private:
+	int32 Iterations = 3;
+
+	//Returns the best of Iterations runs in seconds, or a negative value when Func fails
+	double MeasureSeconds(TFunctionRef<bool()> Func);
+	void LogResult(const FString& Name, double Seconds, double Items, const TCHAR* ItemName);
+
+	//-Bench=Loader [-Dir=<data directory>], parallel loader against ParseIntoArray
+	int32 RunLoaderBenchmark(const TMap<FString, FString>& ParamsMap);
+	//-Bench=HexMath [-GridRange=200] [-NeighborRange=5], ring iteration of HexMath against the former member functions
+	int32 RunHexMathBenchmark(const TMap<FString, FString>& ParamsMap);
+	//-Bench=Fov [-GridRange=200] [-Radius=10] [-BlockerPercent=20], line of sight stencil against tracing every line
+	int32 RunFovBenchmark(const TMap<FString, FString>& ParamsMap);
+	//-Bench=Hpa [-Dir=<data directory>] [-ClusterRadius=8] [-Queries=1000] [-BlockerPercent=20],
+	//HPA* over the abstract graph against flat A* over the N1.data adjacency, then every open neighbor pair across a cluster border
+	int32 RunHpaBenchmark(const TMap<FString, FString>& ParamsMap);
+	//-Bench=Noise [-GridRange=200] [-Octaves=5], batched simplex fBm single and multi threaded against per tile FMath::PerlinNoise2D
+	int32 RunNoiseBenchmark(const TMap<FString, FString>& ParamsMap);
+	//-Bench=TileSet [-GridRange=200] [-Radius=5] [-Queries=1000], range sets and their set operations as FHexTileSet against TSet<FIntPoint>
+	int32 RunTileSetBenchmark(const TMap<FString, FString>& ParamsMap);
+	//-Bench=BulkLoad [-Dir=<data directory>] [-Asset=/Game/HexGrid/HexGridData], UHexGridDataAsset in its saved load mode against the text files
+	int32 RunBulkLoadBenchmark(const TMap<FString, FString>& ParamsMap);
+	//-Bench=FlowField [-GridRange=500] [-Sources=4] [-MaxCost=1] [-Agents=1000], parallel flow field against a binary heap Dijkstra,
+	//and one field walked by every agent against an A* search per agent
+	int32 RunFlowFieldBenchmark(const TMap<FString, FString>& ParamsMap);
+};
@@ -3,9 +3,22 @@
 
 #include "HexGridCreator.h"
 #include "FlowControlUtility.h"
-
+#include "GridDataLoader.h"
+#include "GridDualGraphUtility.h"
+#include "GridHpaUtility.h"
+#include "GridLosUtility.h"
+#include "GridBinaryUtility.h"
+#include "GridNoiseUtility.h"
+#include "GridEstimateUtility.h"
+#include "GridFlowFieldUtility.h"
+#include "HexMath.h"
+
+#include <Async/Async.h>
 #include <Kismet/KismetTextLibrary.h>
 #include <Math/UnrealMathUtility.h>
+#include <Misc/CommandLine.h>
+#include <Misc/FileHelper.h>
+#include <Misc/Parse.h>
 #include <TimerManager.h>
 
 #include <iostream>
@@ -21,6 +34,15 @@ AHexGridCreator::AHexGridCreator()
 	//PrimaryActorTick.bCanEverTick = true;
 
 	BindDelegate();
+
+	//Elevation and moisture, moisture varies on a larger scale
+	FStructHexNoiseChannel Moisture;
+	Moisture.Name = FName(TEXT("Moisture"));
+	Moisture.Seed = 2;
+	Moisture.Octaves = 4;
+	Moisture.Frequency = 0.0001f;
+	AttributeChannels.Add(FStructHexNoiseChannel());
+	AttributeChannels.Add(Moisture);
 }
 
 // Called when the game starts or when spawned
@@ -28,11 +50,23 @@ void AHexGridCreator::BeginPlay()
 {
 	Super::BeginPlay();
 
+	ApplyCommandLineParams();
 	WorkflowState = Enum_HexGridWorkflowState::InitWorkflow;
 	CreateHexGridFlow();
 	
 }
 
+void AHexGridCreator::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	//Joins the pipeline threads and the stage task before the actor goes away
+	Pipeline.Reset();
+	if (StageTask.IsValid()) {
+		StageTask.Wait();
+	}
+	RestoreParams();
+	Super::EndPlay(EndPlayReason);
+}
+
 // Called every frame
 void AHexGridCreator::Tick(float DeltaTime)
 {
@@ -45,19 +79,297 @@ void AHexGridCreator::BindDelegate()
 	WorkflowDelegate.BindUFunction(Cast<UObject>(this), TEXT("CreateHexGridFlow"));
 }
 
+void AHexGridCreator::ApplyCommandLineParams()
+{
+	//Headless runs, e.g. -GridRange=12000 -NeighborRange=1 -LowMemoryMode -ExitWhenDone
+	const TCHAR* CommandLine = FCommandLine::Get();
+	FParse::Value(CommandLine, TEXT("TileSize="), TileSize);
+	FParse::Value(CommandLine, TEXT("GridRange="), GridRange);
+	FParse::Value(CommandLine, TEXT("NeighborRange="), NeighborRange);
+	FParse::Value(CommandLine, TEXT("Mask="), MaskPath);
+	FParse::Value(CommandLine, TEXT("MaskThreshold="), MaskThreshold);
+	FParse::Value(CommandLine, TEXT("Shard="), ShardParam);
+	FParse::Value(CommandLine, TEXT("MergeShards="), MergeShardCount);
+	if (FParse::Param(CommandLine, TEXT("LowMemoryMode"))) {
+		LowMemoryMode = true;
+	}
+	if (FParse::Param(CommandLine, TEXT("Pipeline"))) {
+		EnablePipeline = true;
+	}
+	if (FParse::Param(CommandLine, TEXT("DualGraph"))) {
+		EnableDualGraph = true;
+	}
+	if (FParse::Param(CommandLine, TEXT("LosStencil"))) {
+		EnableLosStencil = true;
+	}
+	if (FParse::Param(CommandLine, TEXT("Hpa"))) {
+		EnableHpa = true;
+	}
+	FParse::Value(CommandLine, TEXT("HpaClusterRadius="), HpaClusterRadius);
+	if (FParse::Param(CommandLine, TEXT("FlowFields"))) {
+		EnableFlowFields = true;
+	}
+	FParse::Value(CommandLine, TEXT("FlowFieldCosts="), FlowFieldCostsPath);
+	if (FParse::Param(CommandLine, TEXT("Binary"))) {
+		EnableBinaryOutputs = true;
+	}
+	if (FParse::Param(CommandLine, TEXT("Attributes"))) {
+		EnableAttributes = true;
+	}
+	if (FParse::Param(CommandLine, TEXT("BulkAsset"))) {
+		EnableBulkAsset = true;
+	}
+	FString BulkLoadModeStr;
+	if (FParse::Value(CommandLine, TEXT("BulkLoadMode="), BulkLoadModeStr)) {
+		int64 Value = StaticEnum<Enum_HexGridBulkLoadMode>()->GetValueByNameString(BulkLoadModeStr);
+		if (Value == INDEX_NONE) {
+			UE_LOG(HexGridCreator, Warning, TEXT("Unknown bulk load mode %s, use Inline, Streamed or MemoryMapped."), *BulkLoadModeStr);
+		}
+		else {
+			BulkLoadMode = (Enum_HexGridBulkLoadMode)Value;
+		}
+	}
+	ExitWhenDone = FParse::Param(CommandLine, TEXT("ExitWhenDone"));
+
+	float FrameBudgetMs;
+	if (FParse::Value(CommandLine, TEXT("FrameBudgetMs="), FrameBudgetMs)) {
+		TArray<FStructLoopData*> LoopDataList;
+		GetLoopDataList(LoopDataList);
+		for (FStructLoopData* LoopData : LoopDataList)
+		{
+			LoopData->FrameBudgetMs = FrameBudgetMs;
+		}
+	}
+}
+
 void AHexGridCreator::InitWorkflow()
 {
+	if (!InitVariants() || !CheckGridRange() || !InitShard() || !InitMask() || !CheckFootprintBudget()) {
+		ScheduleWorkflow(Enum_HexGridWorkflowState::Error);
+		return;
+	}
+
 	InitDirection();
 	InitTileParams();
 	InitLoopData();
-	InitAxialDirections();
+	InitRingOffsets();
+	if (Mask.IsValid() && LowMemoryMode) {
+		GridMaskUtility::CollectTiles(Mask, MaskRingEnds, MaskedTiles);
+	}
+
+	if (MergeShardCount > 0) {
+		//Nothing is generated, the write rate of a merge says nothing about generation
+		MeasureRates = false;
+		ScheduleWorkflow(Enum_HexGridWorkflowState::ShardMerge);
+		return;
+	}
+	if (EnablePipeline) {
+		StartPipeline();
+		return;
+	}
 
-	FTimerHandle TimerHandle;
-	WorkflowState = Enum_HexGridWorkflowState::SpiralCreateCenter;
-	GetWorldTimerManager().SetTimer(TimerHandle, WorkflowDelegate, DefaultTimerRate, false);
+	//Low memory mode keeps no tiles, writers compute each tile from its spiral index
+	WorkflowState = LowMemoryMode ? Enum_HexGridWorkflowState::WriteTiles : Enum_HexGridWorkflowState::SpiralCreateCenter;
+	MeasureRates = true;
+	ResumePending = false;
+	if (EnableCheckpoint && RestoreFromCheckpoint()) {
+		MeasureRates = false;
+	}
+	LastCheckpointTime = FPlatformTime::Seconds();
+	ScheduleWorkflow(WorkflowState);
 	UE_LOG(HexGridCreator, Log, TEXT("Init workflow done."));
 }
 
+void AHexGridCreator::InitRingOffsets()
+{
+	RingOffsets.Empty();
+	for (int32 i = 1; i <= NeighborRange; i++)
+	{
+		FStructHexTileNeighbors Ring;
+		Ring.Radius = i;
+		for (const HexMath::FAxial& Hex : HexMath::Ring(HexMath::FAxial(), i))
+		{
+			Ring.Tiles.Add(Hex.ToIntPoint());
+		}
+		RingOffsets.Add(Ring);
+	}
+}
+
+bool AHexGridCreator::CheckGridRange()
+{
+	//Checked before the mask counts its rings, the count is the full hexagon so it bounds any masked grid.
+	//Any range past MAX_uint16 is already over the limit, and bounding it first keeps the count in int64
+	bool Fits = GridRange >= 0 && NeighborRange >= 0 && GridRange <= MAX_uint16 && NeighborRange <= MAX_uint16
+		&& HexMath::GetTileCount((int64)GridRange) <= MAX_int32;
+	if (!Fits) {
+		UE_LOG(HexGridCreator, Warning, TEXT("GridRange %d with NeighborRange %d does not fit 32 bit tile indices, abort."), GridRange, NeighborRange);
+		return false;
+	}
+	return true;
+}
+
+bool AHexGridCreator::CheckFootprintBudget()
+{
+	ComputeFootprint(Variants, GridRange, NeighborRange, LowMemoryMode, FootprintEstimate);
+	UE_LOG(HexGridCreator, Log, TEXT("Estimate %lld tiles, %lld MB memory, %lld MB output, %.0f seconds."), FootprintEstimate.TileCount,
+		FootprintEstimate.PeakMemoryBytes >> 20, FootprintEstimate.TotalOutputBytes >> 20, FootprintEstimate.EstimatedSeconds);
+
+	if (MaxDiskMB > 0 && FootprintEstimate.TotalOutputBytes > ((int64)MaxDiskMB << 20)) {
+		UE_LOG(HexGridCreator, Warning, TEXT("Estimated output exceeds MaxDiskMB %d, abort."), MaxDiskMB);
+		return false;
+	}
+
+	if (MaxMemoryMB > 0 && FootprintEstimate.PeakMemoryBytes > ((int64)MaxMemoryMB << 20)) {
+		if (OverBudgetPolicy == Enum_HexGridBudgetPolicy::Abort || LowMemoryMode) {
+			UE_LOG(HexGridCreator, Warning, TEXT("Estimated memory exceeds MaxMemoryMB %d, abort."), MaxMemoryMB);
+			return false;
+		}
+
+		LowMemoryMode = true;
+		ComputeFootprint(Variants, GridRange, NeighborRange, LowMemoryMode, FootprintEstimate);
+		if (FootprintEstimate.PeakMemoryBytes > ((int64)MaxMemoryMB << 20)) {
+			UE_LOG(HexGridCreator, Warning, TEXT("Estimated memory exceeds MaxMemoryMB %d in low memory mode, abort."), MaxMemoryMB);
+			return false;
+		}
+		UE_LOG(HexGridCreator, Log, TEXT("Switch to low memory mode, estimate %lld MB memory."), FootprintEstimate.PeakMemoryBytes >> 20);
+	}
+	return true;
+}
+
+void AHexGridCreator::EstimateFootprint(FStructHexGridEstimate& Out_Estimate)
+{
+	//A query must not change the actor, so the variants and their shared ranges are resolved into copies
+	TArray<FStructHexGridVariant> EstimateVariants;
+	int32 EstimateGridRange, EstimateNeighborRange;
+	GetVariants(EstimateVariants, EstimateGridRange, EstimateNeighborRange);
+	ComputeFootprint(EstimateVariants, EstimateGridRange, EstimateNeighborRange, LowMemoryMode, Out_Estimate);
+}
+
+void AHexGridCreator::ComputeFootprint(const TArray<FStructHexGridVariant>& InVariants, int32 InGridRange, int32 InNeighborRange,
+	bool InLowMemoryMode, FStructHexGridEstimate& Out_Estimate)
+{
+	Out_Estimate = FStructHexGridEstimate();
+	Out_Estimate.TileCount = GetTileCount(InGridRange);
+	Out_Estimate.NeighborEntryCount = Out_Estimate.TileCount * GridEstimateUtility::GetNeighborCount(InNeighborRange);
+	//The pipeline keeps no tiles either, only its bounded batches
+	Out_Estimate.PeakMemoryBytes = GridEstimateUtility::EstimateTilesMemory(InGridRange, InNeighborRange, InLowMemoryMode || EnablePipeline);
+	if (Mask.IsValid()) {
+		//Tiles scale with the masked in share, low memory mode keeps their coords instead
+		if (!InLowMemoryMode && !EnablePipeline) {
+			double Share = (double)Out_Estimate.TileCount / FMath::Max<int64>(GridEstimateUtility::GetTileCount(InGridRange), 1);
+			Out_Estimate.PeakMemoryBytes = (int64)(Out_Estimate.PeakMemoryBytes * Share);
+		}
+		else if (InLowMemoryMode) {
+			Out_Estimate.PeakMemoryBytes += Out_Estimate.TileCount * (int64)sizeof(FIntPoint);
+		}
+		Out_Estimate.PeakMemoryBytes += Mask.Bits.Num() / 8;
+	}
+
+	FString RelPath;
+	int64 StageMemory = 0;
+	for (int32 i = 0; i < InVariants.Num(); i++)
+	{
+		const FStructHexGridVariant& Variant = InVariants[i];
+		int64 TileCount = GetTileCount(Variant.GridRange);
+
+		ResolveVariantPath(TilesDataPath, Variant, RelPath);
+		Out_Estimate.OutputBytes.Add(RelPath, (int64)(TileCount * GridEstimateUtility::EstimateTileLineBytes(Variant.GridRange, Variant.TileSize)));
+		ResolveVariantPath(TileIndicesDataPath, Variant, RelPath);
+		Out_Estimate.OutputBytes.Add(RelPath, (int64)(TileCount * GridEstimateUtility::EstimateTileIndicesLineBytes(Variant.GridRange)));
+		for (int32 Radius = 1; Radius <= Variant.NeighborRange; Radius++)
+		{
+			FString NeighborPath;
+			CreateNeighborPath(NeighborPath, Radius);
+			ResolveVariantPath(NeighborPath, Variant, RelPath);
+			Out_Estimate.OutputBytes.Add(RelPath, (int64)(TileCount * GridEstimateUtility::EstimateNeighborLineBytes(Variant.GridRange, Radius)));
+		}
+		if (EnableDualGraph && !Mask.IsValid()) {
+			ResolveVariantPath(DualGraphDataPath, Variant, RelPath);
+			Out_Estimate.OutputBytes.Add(RelPath, GridDualGraphUtility::EstimateFileBytes(Variant.GridRange));
+			StageMemory = FMath::Max(StageMemory, GridDualGraphUtility::EstimateBuildMemory(Variant.GridRange));
+		}
+		if (EnableHpa) {
+			ResolveVariantPath(HpaGraphDataPath, Variant, RelPath);
+			Out_Estimate.OutputBytes.Add(RelPath, GridHpaUtility::EstimateFileBytes(TileCount, HpaClusterRadius));
+			StageMemory = FMath::Max(StageMemory, GridHpaUtility::EstimateBuildMemory(TileCount, Variant.GridRange));
+		}
+		if (EnableFlowFields) {
+			for (const FStructHexFlowFieldSources& Group : FlowFieldSources)
+			{
+				ResolveFlowFieldPath(Group.Name, Variant, RelPath);
+				Out_Estimate.OutputBytes.Add(RelPath, GridFlowFieldUtility::EstimateFileBytes(TileCount, Group.Sources.Num()));
+			}
+			StageMemory = FMath::Max(StageMemory, GridFlowFieldUtility::EstimateBuildMemory(TileCount, Variant.GridRange));
+		}
+		if (EnableAttributes) {
+			ResolveVariantPath(AttributesDataPath, Variant, RelPath);
+			Out_Estimate.OutputBytes.Add(RelPath, GridNoiseUtility::GetAttributesFileBytes(TileCount, AttributeChannels.Num()));
+			if (Mask.IsValid()) {
+				StageMemory = FMath::Max(StageMemory, TileCount * (int64)sizeof(FIntPoint));
+			}
+		}
+		if (EnableBulkAsset) {
+			//The payload is built in memory, then copied into the bulk data
+			int64 PayloadBytes = GridBinaryUtility::GetPayloadBytes(TileCount, Variant.GridRange, Variant.NeighborRange);
+			ResolveVariantPackage(Variant, RelPath);
+			Out_Estimate.OutputBytes.Add(RelPath, PayloadBytes);
+			StageMemory = FMath::Max(StageMemory, PayloadBytes * 2);
+		}
+		if (EnableBinaryOutputs) {
+			ResolveVariantPath(FPaths::ChangeExtension(TilesDataPath, TEXT("bin")), Variant, RelPath);
+			Out_Estimate.OutputBytes.Add(RelPath, GridBinaryUtility::GetTilesFileBytes(TileCount));
+			for (int32 Radius = 1; Radius <= Variant.NeighborRange; Radius++)
+			{
+				FString NeighborPath;
+				CreateNeighborPath(NeighborPath, Radius);
+				ResolveVariantPath(FPaths::ChangeExtension(NeighborPath, TEXT("bin")), Variant, RelPath);
+				Out_Estimate.OutputBytes.Add(RelPath, GridBinaryUtility::GetNeighborsFileBytes(TileCount, Radius));
+			}
+			if (Mask.IsValid()) {
+				//Masked tiles and the spiral to tile index map
+				StageMemory = FMath::Max(StageMemory, TileCount * (int64)sizeof(FIntPoint)
+					+ GridEstimateUtility::GetTileCount(Variant.GridRange) * (int64)sizeof(uint32));
+			}
+		}
+	}
+	if (EnableLosStencil) {
+		//Loaded back it holds the offsets as well
+		int64 StencilBytes = GridLosUtility::EstimateFileBytes(InNeighborRange);
+		Out_Estimate.OutputBytes.Add(LosStencilDataPath, StencilBytes);
+		StageMemory = FMath::Max(StageMemory, StencilBytes + GridEstimateUtility::GetTileCount(InNeighborRange) * (int64)sizeof(FIntPoint));
+	}
+	for (const TPair<FString, int64>& Pair : Out_Estimate.OutputBytes)
+	{
+		Out_Estimate.TotalOutputBytes += Pair.Value;
+	}
+	//Optional stages run one at a time, graphs one variant at a time, on top of what the text stages hold
+	Out_Estimate.PeakMemoryBytes += StageMemory;
+
+	Out_Estimate.EstimatedSeconds = Out_Estimate.TileCount / BenchmarkRates.CenterTilesPerSecond
+		+ Out_Estimate.TotalOutputBytes / BenchmarkRates.WriteBytesPerSecond;
+	if (!InLowMemoryMode) {
+		Out_Estimate.EstimatedSeconds += Out_Estimate.NeighborEntryCount / BenchmarkRates.NeighborEntriesPerSecond;
+	}
+}
+
+double AHexGridCreator::GetStageSeconds()
+{
+	return FMath::Max(FPlatformTime::Seconds() - StageStartTime, 0.001);
+}
+
+int64 AHexGridCreator::GetWrittenBytes()
+{
+	int64 Bytes = 0;
+	for (const TPair<FString, int64>& Pair : FootprintEstimate.OutputBytes)
+	{
+		std::error_code ErrorCode;
+		FString FullPath = FPaths::ProjectDir().Append(Pair.Key);
+		uintmax_t Size = std::filesystem::file_size(std::filesystem::path(*FullPath), ErrorCode);
+		Bytes += ErrorCode ? 0 : (int64)Size;
+	}
+	return Bytes;
+}
+
 void AHexGridCreator::InitDirection()
 {
 	//Init Q,R,S
@@ -91,17 +403,99 @@ void AHexGridCreator::InitTileParams()
 void AHexGridCreator::InitLoopData()
 {
 	FlowControlUtility::InitLoopData(SpiralCreateCenterLoopData);
-	SpiralCreateCenterLoopData.IndexSaved[0] = 1;
 	FlowControlUtility::InitLoopData(SpiralCreateNeighborsLoopData);
-	SpiralCreateNeighborsLoopData.IndexSaved[1] = 1;
 	FlowControlUtility::InitLoopData(WriteTilesLoopData);
 	FlowControlUtility::InitLoopData(WriteNeighborsLoopData);
-	WriteNeighborsLoopData.IndexSaved[0] = 1;
 	FlowControlUtility::InitLoopData(WriteTileIndicesLoopData);
 }
 
+bool AHexGridCreator::InitVariants()
+{
+	int32 SharedGridRange, SharedNeighborRange;
+	if (!GetVariants(Variants, SharedGridRange, SharedNeighborRange)) {
+		return false;
+	}
+	if (BatchVariants.Num() == 0) {
+		return true;
+	}
+
+	//Generation runs on the shared ranges, RestoreParams puts the user's values back when the run ends
+	if (!HasSavedParams) {
+		SavedGridRange = GridRange;
+		SavedNeighborRange = NeighborRange;
+		HasSavedParams = true;
+	}
+	GridRange = SharedGridRange;
+	NeighborRange = SharedNeighborRange;
+	UE_LOG(HexGridCreator, Log, TEXT("Batch of %d variants, shared GridRange %d, NeighborRange %d."), Variants.Num(), GridRange, NeighborRange);
+	return true;
+}
+
+void AHexGridCreator::RestoreParams()
+{
+	if (HasSavedParams) {
+		GridRange = SavedGridRange;
+		NeighborRange = SavedNeighborRange;
+		HasSavedParams = false;
+	}
+}
+
+bool AHexGridCreator::InitMask()
+{
+	Mask = FStructHexGridMask();
+	MaskRingEnds.Empty();
+	MaskCrc = 0;
+	MaskedTiles.Empty();
+	if (MaskPath.IsEmpty()) {
+		return true;
+	}
+
+	FString FullPath = FPaths::IsRelative(MaskPath) ? FPaths::ProjectDir().Append(MaskPath) : MaskPath;
+	if (!GridMaskUtility::LoadMask(FullPath, (uint8)FMath::Clamp(MaskThreshold, 0, 255), Mask)) {
+		return false;
+	}
+
+	//Ring counts make every variant range a prefix of the compact numbering
+	GridMaskUtility::CountRings(Mask, GridRange, MaskRingEnds);
+	MaskCrc = GridMaskUtility::GetMaskCrc(Mask);
+	UE_LOG(HexGridCreator, Log, TEXT("Mask keeps %lld of %lld tiles."), MaskRingEnds.Last(), GridEstimateUtility::GetTileCount(GridRange));
+	return true;
+}
+
+
+bool AHexGridCreator::InitShard()
+{
+	Shard = FStructHexGridShard();
+	if (MergeShardCount < 0) {
+		UE_LOG(HexGridCreator, Warning, TEXT("MergeShards %d is not a shard count."), MergeShardCount);
+		return false;
+	}
+	if (ShardParam.IsEmpty() || MergeShardCount > 0) {
+		return true;
+	}
+	if (!GridShardUtility::ParseShard(ShardParam, Shard)) {
+		return false;
+	}
+
+	//Only the pipeline writes a range of the spiral, the timer driven writers always start at tile 0
+	if (Shard.IsValid() && !EnablePipeline) {
+		UE_LOG(HexGridCreator, Log, TEXT("Shards are written by the pipeline, pipeline enabled."));
+		EnablePipeline = true;
+	}
+	return true;
+}
+
+void AHexGridCreator::ScheduleWorkflow(Enum_HexGridWorkflowState State)
+{
+	WorkflowState = State;
+	StageStartTime = FPlatformTime::Seconds();
+	GetWorldTimerManager().SetTimerForNextTick(WorkflowDelegate);
+}
+
 void AHexGridCreator::CreateHexGridFlow()
 {
+	UpdateCheckpoint();
+
 	switch (WorkflowState)
 	{
 	case Enum_HexGridWorkflowState::InitWorkflow:
@@ -125,10 +519,48 @@ void AHexGridCreator::CreateHexGridFlow()
 	case Enum_HexGridWorkflowState::WriteParams:
 		WriteParamsToFile();
 		break;
+	case Enum_HexGridWorkflowState::Pipeline:
+		PollPipeline();
+		break;
+	case Enum_HexGridWorkflowState::DualGraph:
+		BuildDualGraph();
+		break;
+	case Enum_HexGridWorkflowState::LosStencil:
+		BuildLosStencil();
+		break;
+	case Enum_HexGridWorkflowState::Hpa:
+		BuildHpaGraph();
+		break;
+	case Enum_HexGridWorkflowState::Binary:
+		WriteBinaryOutputs();
+		break;
+	case Enum_HexGridWorkflowState::Attributes:
+		WriteAttributes();
+		break;
+	case Enum_HexGridWorkflowState::BulkAsset:
+		BuildBulkAssets();
+		break;
+	case Enum_HexGridWorkflowState::FlowField:
+		BuildFlowFields();
+		break;
+	case Enum_HexGridWorkflowState::ShardManifest:
+		WriteShardManifest();
+		break;
+	case Enum_HexGridWorkflowState::ShardMerge:
+		MergeShards();
+		break;
 	case Enum_HexGridWorkflowState::Done:
+		RestoreParams();
+		if (ExitWhenDone) {
+			FPlatformMisc::RequestExit(false);
+		}
 		break;
 	case Enum_HexGridWorkflowState::Error:
 		UE_LOG(HexGridCreator, Warning, TEXT("CreateHexGridFlow Error!"));
+		RestoreParams();
+		if (ExitWhenDone) {
+			FPlatformMisc::RequestExitWithStatus(false, 1);
+		}
 		break;
 	default:
 		break;
@@ -136,40 +568,128 @@ void AHexGridCreator::CreateHexGridFlow()
 
 }
 
-void AHexGridCreator::InitAxialDirections()
+void AHexGridCreator::ResetProgress()
 {
-	AxialDirectionVectors.Add(FIntPoint(1.0, 0.0));
-	AxialDirectionVectors.Add(FIntPoint(1.0, -1.0));
-	AxialDirectionVectors.Add(FIntPoint(0.0, -1.0));
-	AxialDirectionVectors.Add(FIntPoint(-1.0, 0.0));
-	AxialDirectionVectors.Add(FIntPoint(-1.0, 1.0));
-	AxialDirectionVectors.Add(FIntPoint(0.0, 1.0));
+	ProgressTarget = 0;
+	ProgressCurrent = 0;
 }
 
-FIntPoint AHexGridCreator::AxialAdd(const FIntPoint& Hex, const FIntPoint& Vec)
+int64 AHexGridCreator::GetTileCount(int32 Range)
 {
-	return Hex + Vec;
+	if (Mask.IsValid()) {
+		return Range < 0 ? 0 : MaskRingEnds[FMath::Min(Range, MaskRingEnds.Num() - 1)];
+	}
+	return GridEstimateUtility::GetTileCount(Range);
 }
 
-FIntPoint AHexGridCreator::AxialDirection(const int32 Direction)
+int64 AHexGridCreator::GetVariantsTileCount()
 {
-	return AxialDirectionVectors[Direction];
+	int64 Count = 0;
+	for (const FStructHexGridVariant& Variant : Variants)
+	{
+		Count += GetTileCount(Variant.GridRange);
+	}
+	return Count;
 }
 
-FIntPoint AHexGridCreator::AxialNeighbor(const FIntPoint& Hex, const int32 Direction)
+bool AHexGridCreator::GetVariants(TArray<FStructHexGridVariant>& Out_Variants, int32& Out_GridRange, int32& Out_NeighborRange)
 {
-	return AxialAdd(Hex, AxialDirection(Direction));
+	Out_Variants.Empty();
+	if (BatchVariants.Num() == 0) {
+		FStructHexGridVariant Variant;
+		Variant.TileSize = TileSize;
+		Variant.GridRange = GridRange;
+		Variant.NeighborRange = NeighborRange;
+		Out_Variants.Add(Variant);
+		Out_GridRange = Variant.GridRange;
+		Out_NeighborRange = Variant.NeighborRange;
+		return true;
+	}
+
+	//Topology does not depend on TileSize and smaller grids are prefixes of the spiral, so generate the largest once
+	Out_GridRange = 1;
+	Out_NeighborRange = 1;
+	TSet<FString> TilesPaths;
+	for (const FStructHexGridVariant& Variant : BatchVariants)
+	{
+		Out_GridRange = FMath::Max(Out_GridRange, Variant.GridRange);
+		Out_NeighborRange = FMath::Max(Out_NeighborRange, Variant.NeighborRange);
+
+		//Every output resolves alike, so variants sharing their Tiles.data would overwrite all of each other's files
+		FString TilesPath;
+		ResolveVariantPath(TilesDataPath, Variant, TilesPath);
+		FPaths::NormalizeFilename(TilesPath);
+		FPaths::CollapseRelativeDirectories(TilesPath);
+		bool Duplicate = false;
+		TilesPaths.Add(TilesPath, &Duplicate);
+		if (Duplicate) {
+			UE_LOG(HexGridCreator, Warning, TEXT("Several batch variants write %s, give each its own DataDirectory."), *TilesPath);
+			return false;
+		}
+	}
+	Out_Variants = BatchVariants;
+	return true;
 }
 
-FIntPoint AHexGridCreator::AxialScale(const FIntPoint& Hex, const int32 Factor)
+void AHexGridCreator::ResolveVariantPath(const FString& RelPath, int32 VariantIndex, FString& Out_Path)
 {
-	return Hex * Factor;
+	ResolveVariantPath(RelPath, Variants[VariantIndex], Out_Path);
 }
 
-void AHexGridCreator::ResetProgress()
+void AHexGridCreator::ResolveVariantPath(const FString& RelPath, const FStructHexGridVariant& Variant, FString& Out_Path)
 {
-	ProgressTarget = 0;
-	ProgressCurrent = 0;
+	Out_Path = Variant.DataDirectory.IsEmpty() ? RelPath : FPaths::Combine(Variant.DataDirectory, FPaths::GetCleanFilename(RelPath));
+}
+
+void AHexGridCreator::ResolveVariantPackage(const FStructHexGridVariant& Variant, FString& Out_PackageName)
+{
+	const FString& Directory = Variant.DataDirectory;
+	Out_PackageName = Directory.IsEmpty() ? BulkAssetPackage : BulkAssetPackage + TEXT("_") + FPaths::GetCleanFilename(Directory);
+}
+
+void AHexGridCreator::ResolveFlowFieldPath(FName GroupName, const FStructHexGridVariant& Variant, FString& Out_Path)
+{
+	FString GroupPath = FPaths::Combine(FPaths::GetPath(FlowFieldDataPath), FString::Printf(TEXT("%s_%s.%s"),
+		*FPaths::GetBaseFilename(FlowFieldDataPath), *GroupName.ToString(), *FPaths::GetExtension(FlowFieldDataPath)));
+	ResolveVariantPath(GroupPath, Variant, Out_Path);
+}
+
+void AHexGridCreator::GetParamsSignature(FString& Out_Str)
+{
+	GetGridSignature(Out_Str);
+	Out_Str.Append(*PipeDelim).Append(FString::FromInt(LowMemoryMode ? 1 : 0));
+}
+
+void AHexGridCreator::GetGridSignature(FString& Out_Str)
+{
+	Out_Str = FString::SanitizeFloat(TileSize);
+	Out_Str.Append(*PipeDelim).Append(FString::FromInt(GridRange));
+	Out_Str.Append(*PipeDelim).Append(FString::FromInt(NeighborRange));
+	//The mask content goes in as well, an image edited or differing between machines under the same path is another grid
+	if (!MaskPath.IsEmpty()) {
+		Out_Str.Append(*PipeDelim).Append(MaskPath).Append(*CommaDelim).Append(FString::FromInt(MaskThreshold));
+		Out_Str.Append(*CommaDelim).Append(FString::Printf(TEXT("%08x"), MaskCrc));
+	}
+	for (const FStructHexGridVariant& Variant : BatchVariants)
+	{
+		Out_Str.Append(*PipeDelim).Append(FString::SanitizeFloat(Variant.TileSize));
+		Out_Str.Append(*CommaDelim).Append(FString::FromInt(Variant.GridRange));
+		Out_Str.Append(*CommaDelim).Append(FString::FromInt(Variant.NeighborRange));
+		Out_Str.Append(*CommaDelim).Append(Variant.DataDirectory);
+	}
+}
+
+FIntPoint AHexGridCreator::GetTileAxial(int64 Index)
+{
+	if (LowMemoryMode) {
+		return Mask.IsValid() ? MaskedTiles[Index] : HexMath::SpiralIndexToAxial(Index).ToIntPoint();
+	}
+	return Tiles[Index].AxialCoord;
+}
+
+bool AHexGridCreator::IsTileInGrid(const FIntPoint& Hex, int32 Range)
+{
+	return HexMath::Length(HexMath::FAxial(Hex)) <= Range && (!Mask.IsValid() || Mask.Contains(Hex));
 }
 
 void AHexGridCreator::GetProgress(float& Out_Progress)
@@ -179,7 +699,7 @@ void AHexGridCreator::GetProgress(float& Out_Progress)
 		Out_Progress = 0;
 	}
 	else {
-		Rate = float(ProgressCurrent) / float(ProgressTarget);
+		Rate = float(double(ProgressCurrent) / double(ProgressTarget));
 		Rate = Rate > 1.0 ? 1.0 : Rate;
 		Out_Progress = Rate;
 	}
@@ -187,189 +707,149 @@ void AHexGridCreator::GetProgress(float& Out_Progress)
 
 void AHexGridCreator::SpiralCreateCenter()
 {
-	bool OnceLoop0 = true;
-	bool OnceLoop1 = true;
-	int32 Count = 0;
-	TArray<int32> Indices = { 0, 0, 0 };
-	bool SaveLoopFlag = false;
-
 	if (!SpiralCreateCenterLoopData.IsInitialized) {
-		SpiralCreateCenterLoopData.IsInitialized = true;
-		RingInitFlag = false;
 		InitGridCenter();
-		ProgressTarget = 6 * (1 + GridRange) * GridRange / 2;
+		ProgressTarget = GridEstimateUtility::GetNeighborCount(GridRange);
 	}
 
-	int32 i = SpiralCreateCenterLoopData.IndexSaved[0];
-	i = i < 1 ? 1 : i;
-	int32 j, k;
-
-	for (; i <= GridRange; i++)
-	{
-		Indices[0] = i;
-		if (!RingInitFlag) {
-			//Init position2D
-			RingInitFlag = true;
-			FVector2D Vec = i * TileHeight * NeighborDirVectors[RING_START_DIRECTION_INDEX];
-			TmpPosition2D.Set(Vec.X, Vec.Y);
-
-			//Init hex Axial
-			FIntPoint Point = AxialAdd(AxialScale(AxialDirection(RING_START_DIRECTION_INDEX), i), FIntPoint(0, 0));
-			TmpHex.X = Point.X;
-			TmpHex.Y = Point.Y;
-		}
-
-		j = OnceLoop0 ? SpiralCreateCenterLoopData.IndexSaved[1] : 0;
-		for (; j <= 5; j++) {
-			Indices[1] = j;
-			k = OnceLoop1 ? SpiralCreateCenterLoopData.IndexSaved[2] : 0;
-			for (; k <= i - 1; k++)
+	//Loop levels: ring radius, ring side, step on side
+	Enum_LoopResult Result = FlowControlUtility::RunNestedLoop(this, SpiralCreateCenterLoopData, 3,
+		[this](int32 Depth, const TArray<int64>& Indices) {
+			switch (Depth)
 			{
-				Indices[2] = k;
-				FlowControlUtility::SaveLoopData(this, SpiralCreateCenterLoopData, Count, Indices, WorkflowDelegate, SaveLoopFlag);
-				if (SaveLoopFlag) {
-					return;
-				}
-
-				AddRingTileAndIndex();
-				FindNeighborTileOfRing(j);
-
-				ProgressCurrent = SpiralCreateCenterLoopData.Count;
-				Count++;
+			case 0:
+				return FInt64Point(1, GridRange);
+			case 1:
+				return FInt64Point(0, 5);
+			default:
+				return FInt64Point(0, Indices[0] - 1);
 			}
-			OnceLoop1 = false;
-		}
-		RingInitFlag = false;
-		OnceLoop0 = false;
+		},
+		[this](const TArray<int64>& Indices) {
+			if (Indices[1] == 0 && Indices[2] == 0) {
+				InitCenterRing((int32)Indices[0]);
+			}
+			AddRingTileAndIndex();
+			FindNeighborTileOfRing((int32)Indices[1]);
+			return true;
+		}, WorkflowDelegate);
+
+	ProgressCurrent = SpiralCreateCenterLoopData.Count;
+	if (Result != Enum_LoopResult::Finished) {
+		return;
 	}
 
+	if (MeasureRates) {
+		MeasuredRates.CenterTilesPerSecond = Tiles.Num() / GetStageSeconds();
+	}
 	ResetProgress();
-
-	FTimerHandle TimerHandle;
-	WorkflowState = Enum_HexGridWorkflowState::SpiralCreateNeighbors;
-	GetWorldTimerManager().SetTimer(TimerHandle, WorkflowDelegate, SpiralCreateCenterLoopData.Rate, false);
+	ScheduleWorkflow(LowMemoryMode ? Enum_HexGridWorkflowState::WriteTiles : Enum_HexGridWorkflowState::SpiralCreateNeighbors);
 	UE_LOG(HexGridCreator, Log, TEXT("Spiral create center done."));
 }
 
 void AHexGridCreator::InitGridCenter()
 {
-	FStructHexTileData Data;
-	Data.AxialCoord.X = 0;
-	Data.AxialCoord.Y = 0;
-	Data.Position2D.Set(0.0, 0.0);
 	Tiles.Empty();
-	Tiles.Add(Data);
 
-	TileIndices.Empty();
-	TileIndices.Add(FIntPoint(0, 0), 0.0);
+	//The center is masked like any other tile
+	TmpHex = HexMath::FAxial();
+	AddRingTileAndIndex();
+}
 
+void AHexGridCreator::InitCenterRing(int32 Radius)
+{
+	//Init hex Axial
+	TmpHex = HexMath::RingStart(HexMath::FAxial(), Radius);
 }
 
 void AHexGridCreator::AddRingTileAndIndex()
 {
-	FStructHexTileData Data;
-	Data.AxialCoord.X = TmpHex.X;
-	Data.AxialCoord.Y = TmpHex.Y;
-	Data.Position2D.Set(TmpPosition2D.X, TmpPosition2D.Y);
-	int32 Index = Tiles.Add(Data);
+	if (Mask.IsValid() && !Mask.Contains(TmpHex.ToIntPoint())) {
+		return;
+	}
 
-	TileIndices.Add(FIntPoint(TmpHex.X, TmpHex.Y), Index);
+	FStructHexTileData Data;
+	Data.AxialCoord = TmpHex.ToIntPoint();
+	Data.Position2D = HexMath::AxialToPosition(Data.AxialCoord, TileSize);
+	//A tile's index is its spiral index, or its position in Tiles when masked, so no coord lookup is kept
+	Tiles.Add(Data);
 }
 
 void AHexGridCreator::FindNeighborTileOfRing(int32 DirIndex)
 {
-	FVector2D Pos = NeighborDirVectors[DirIndex] * TileHeight + TmpPosition2D;
-	TmpPosition2D.Set(Pos.X, Pos.Y);
-
-	FIntPoint Hex = AxialNeighbor(TmpHex, DirIndex);
-	TmpHex.X = Hex.X;
-	TmpHex.Y = Hex.Y;
+	TmpHex = HexMath::Neighbor(TmpHex, DirIndex);
 }
 
 void AHexGridCreator::SpiralCreateNeighbors()
 {
-	bool OnceLoop0 = true;
-	bool OnceLoop1 = true;
-	bool OnceLoop2 = true;
-	int32 Count = 0;
-	TArray<int32> Indices = { 0, 0, 0, 0 };
-	bool SaveLoopFlag = false;
-
 	if (!SpiralCreateNeighborsLoopData.IsInitialized) {
-		SpiralCreateNeighborsLoopData.IsInitialized = true;
-		RingInitFlag = false;
-		ProgressTarget = Tiles.Num() * 6 * (1 + NeighborRange) * NeighborRange / 2;
+		ProgressTarget = Tiles.Num() * CalNeighborsWeight(NeighborRange);
 	}
 
-	int32 TileIndex = SpiralCreateNeighborsLoopData.IndexSaved[0];
-	int32 i, j, k;
-
-	FIntPoint center;
-
-	for (; TileIndex < Tiles.Num(); TileIndex++)
-	{
-		Indices[0] = TileIndex;
-		center = Tiles[TileIndex].AxialCoord;
-		i = OnceLoop0 ? SpiralCreateNeighborsLoopData.IndexSaved[1] : 1;
-		i = i < 1 ? 1 : i;
-		for (; i <= NeighborRange; i++)
-		{
-			Indices[1] = i;
-			if (!RingInitFlag) {
-				RingInitFlag = true;
-
-				AddTileNeighbor(TileIndex, i);
-
-				FIntPoint Point = AxialAdd(AxialScale(AxialDirection(RING_START_DIRECTION_INDEX), i), center);
-				TmpHex.X = Point.X;
-				TmpHex.Y = Point.Y;
+	//Loop levels: tile, ring radius, ring side, step on side
+	Enum_LoopResult Result = FlowControlUtility::RunNestedLoop(this, SpiralCreateNeighborsLoopData, 4,
+		[this](int32 Depth, const TArray<int64>& Indices) {
+			switch (Depth)
+			{
+			case 0:
+				return FInt64Point(0, Tiles.Num() - 1);
+			case 1:
+				return FInt64Point(1, NeighborRange);
+			case 2:
+				return FInt64Point(0, 5);
+			default:
+				return FInt64Point(0, Indices[1] - 1);
 			}
-
-			j = OnceLoop1 ? SpiralCreateNeighborsLoopData.IndexSaved[2] : 0;
-			for (; j <= 5; j++) {
-				Indices[2] = j;
-				k = OnceLoop2 ? SpiralCreateNeighborsLoopData.IndexSaved[3] : 0;
-				for (; k <= i - 1; k++) {
-					Indices[3] = k;
-					FlowControlUtility::SaveLoopData(this, SpiralCreateNeighborsLoopData, Count, Indices, WorkflowDelegate, SaveLoopFlag);
-					if (SaveLoopFlag) {
-						return;
-					}
-
-					SetTileNeighbor(TileIndex, i, j);
-					ProgressCurrent = SpiralCreateNeighborsLoopData.Count;
-					Count++;
-				}
-				OnceLoop2 = false;
+		},
+		[this](const TArray<int64>& Indices) {
+			if (Indices[2] == 0 && Indices[3] == 0) {
+				InitNeighborRing(Indices[0], (int32)Indices[1]);
 			}
-			RingInitFlag = false;
-			OnceLoop1 = false;
-		}
-		OnceLoop0 = false;
+			SetTileNeighbor(Indices[0], (int32)Indices[1], (int32)Indices[2]);
+			return true;
+		}, WorkflowDelegate);
+
+	ProgressCurrent = SpiralCreateNeighborsLoopData.Count;
+	if (Result != Enum_LoopResult::Finished) {
+		return;
 	}
 
+	if (MeasureRates) {
+		MeasuredRates.NeighborEntriesPerSecond = SpiralCreateNeighborsLoopData.Count / GetStageSeconds();
+	}
 	ResetProgress();
-
-	FTimerHandle TimerHandle;
-	WorkflowState = Enum_HexGridWorkflowState::WriteTiles;
-	GetWorldTimerManager().SetTimer(TimerHandle, WorkflowDelegate, SpiralCreateNeighborsLoopData.Rate, false);
+	if (ResumePending) {
+		//Tiles are back, writing continues where the checkpoint left off
+		ResumePending = false;
+		ProgressCurrent = ResumeProgressCurrent;
+		ProgressTarget = ResumeProgressTarget;
+		ScheduleWorkflow(ResumeState);
+		UE_LOG(HexGridCreator, Log, TEXT("Tiles generated again, resume at state %d."), (int32)ResumeState);
+		return;
+	}
+	ScheduleWorkflow(Enum_HexGridWorkflowState::WriteTiles);
 	UE_LOG(HexGridCreator, Log, TEXT("Spiral create neighbors done."));
 }
 
-void AHexGridCreator::AddTileNeighbor(int32 TileIndex, int32 Radius)
+void AHexGridCreator::InitNeighborRing(int64 TileIndex, int32 Radius)
+{
+	AddTileNeighbor(TileIndex, Radius);
+
+	TmpHex = HexMath::RingStart(HexMath::FAxial(Tiles[TileIndex].AxialCoord), Radius);
+}
+
+void AHexGridCreator::AddTileNeighbor(int64 TileIndex, int32 Radius)
 {
 	FStructHexTileNeighbors neighbors;
 	neighbors.Radius = Radius;
 	Tiles[TileIndex].Neighbors.Add(neighbors);
 }
 
-void AHexGridCreator::SetTileNeighbor(int32 TileIndex, int32 Radius, int32 DirIndex)
+void AHexGridCreator::SetTileNeighbor(int64 TileIndex, int32 Radius, int32 DirIndex)
 {
-	Tiles[TileIndex].Neighbors[Radius - 1].Tiles.Add(FIntPoint(TmpHex.X, TmpHex.Y));
+	Tiles[TileIndex].Neighbors[Radius - 1].Tiles.Add(TmpHex.ToIntPoint());
 
-	FIntPoint Hex = AxialNeighbor(TmpHex, DirIndex);
-	TmpHex.X = Hex.X;
-	TmpHex.Y = Hex.Y;
+	TmpHex = HexMath::Neighbor(TmpHex, DirIndex);
 }
 
 void AHexGridCreator::CreateFilePath(const FString& RelPath, FString& FullPath)
@@ -377,79 +857,100 @@ void AHexGridCreator::CreateFilePath(const FString& RelPath, FString& FullPath)
 	FullPath = FPaths::ProjectDir().Append(RelPath);
 	FString Path = FPaths::GetPath(FullPath);
 	if (!FPaths::DirectoryExists(Path)) {
-		if (std::filesystem::create_directories(*Path)) {
+		if (std::filesystem::create_directories(std::filesystem::path(*Path))) {
 			UE_LOG(HexGridCreator, Log, TEXT("Create directory %s success."), *Path);
 		}
 	}
 }
 
-void AHexGridCreator::WriteTilesToFile()
+bool AHexGridCreator::OpenOutputFile(std::ofstream& ofs, const FString& RelPath, bool Append)
 {
 	FString FullPath;
-	CreateFilePath(TilesDataPath, FullPath);
+	CreateFilePath(RelPath, FullPath);
 
-	FTimerHandle TimerHandle;
-	std::ofstream ofs;
-	if (!WriteTilesLoopData.IsInitialized) {
-		WriteTilesLoopData.IsInitialized = true;
-		ofs.open(*FullPath, std::ios::out | std::ios::trunc);
-		ProgressTarget = Tiles.Num();
+	if (ofs.is_open()) {
+		ofs.close();
 	}
-	else {
-		ofs.open(*FullPath, std::ios::out | std::ios::app);
-	}
-	
+	ofs.open(std::filesystem::path(*FullPath), std::ios::out | (Append ? std::ios::app : std::ios::trunc));
 	if (!ofs || !ofs.is_open()) {
 		UE_LOG(HexGridCreator, Warning, TEXT("Open file %s failed!"), *FullPath);
-		WorkflowState = Enum_HexGridWorkflowState::Error;
-		GetWorldTimerManager().SetTimer(TimerHandle, WorkflowDelegate, WriteTilesLoopData.Rate, false);
-		return;
+		return false;
 	}
-
-	WriteTiles(ofs);
+	return true;
 }
 
-void AHexGridCreator::WriteTiles(std::ofstream& ofs)
+Enum_LoopResult AHexGridCreator::WriteVariantLines(FStructLoopData& LoopData, const FString& RelPath,
+	TFunctionRef<void(std::ofstream& ofs, int32 VariantIndex, int64 TileIndex)> WriteLine)
 {
-	int32 Count = 0;
-	TArray<int32> Indices = { 0 };
-	bool SaveLoopFlag = false;
-
-	int32 i = WriteTilesLoopData.IndexSaved[0];
-	for ( ; i <= Tiles.Num() - 1; i++)
-	{
-		Indices[0] = i;
-		FlowControlUtility::SaveLoopData(this, WriteTilesLoopData, Count, Indices, WorkflowDelegate, SaveLoopFlag);
-		if (SaveLoopFlag) {
-			ofs.close();
-			return;
+	//Resume appending to the file of the saved variant, a new variant truncates its file in the loop body
+	std::ofstream ofs;
+	FString VariantPath;
+	if (LoopData.IsInitialized) {
+		ResolveVariantPath(RelPath, (int32)LoopData.IndexSaved[0], VariantPath);
+		if (!OpenOutputFile(ofs, VariantPath, true)) {
+			return Enum_LoopResult::Aborted;
 		}
-		WriteTileLine(ofs, i);
-		ProgressCurrent = WriteTilesLoopData.Count;
-		Count++;
 	}
-	ofs.close();
-	FTimerHandle TimerHandle;
-	WorkflowState = Enum_HexGridWorkflowState::WriteTilesNeighbor;
-	GetWorldTimerManager().SetTimer(TimerHandle, WorkflowDelegate, WriteTilesLoopData.Rate, false);
-	UE_LOG(HexGridCreator, Log, TEXT("Write tiles done."));
 
-}
+	//Loop levels: variant, tile
+	Enum_LoopResult Result = FlowControlUtility::RunNestedLoop(this, LoopData, 2,
+		[this](int32 Depth, const TArray<int64>& Indices) {
+			return Depth == 0 ? FInt64Point(0, Variants.Num() - 1) : FInt64Point(0, GetTileCount(Variants[(int32)Indices[0]].GridRange) - 1);
+		},
+		[this, &ofs, &RelPath, &VariantPath, &WriteLine](const TArray<int64>& Indices) {
+			if (Indices[1] == 0) {
+				ResolveVariantPath(RelPath, (int32)Indices[0], VariantPath);
+				if (!OpenOutputFile(ofs, VariantPath, false)) {
+					return false;
+				}
+			}
+			WriteLine(ofs, (int32)Indices[0], Indices[1]);
+			return true;
+		}, WorkflowDelegate);
 
-void AHexGridCreator::WriteTileLine(std::ofstream& ofs, int32 Index)
-{
-	FStructHexTileData Data = Tiles[Index];
-	WriteAxialCoord(ofs, Data);
-	WritePipeDelimiter(ofs);
-	WritePosition2D(ofs, Data);
-	/*WritePipeDelimiter(ofs);
-	WriteNeighbors(ofs, Data);*/
-	WriteLineEnd(ofs);
+	ofs.close();
+	return Result;
 }
 
-void AHexGridCreator::WritePipeDelimiter(std::ofstream& ofs)
+void AHexGridCreator::WriteTilesToFile()
 {
-	ofs << TCHAR_TO_ANSI(*PipeDelim);
+	if (!WriteTilesLoopData.IsInitialized) {
+		ProgressTarget = GetVariantsTileCount();
+		WriteStartTime = FPlatformTime::Seconds();
+	}
+
+	Enum_LoopResult Result = WriteVariantLines(WriteTilesLoopData, TilesDataPath,
+		[this](std::ofstream& ofs, int32 VariantIndex, int64 TileIndex) {
+			WriteTileLine(ofs, TileIndex, Variants[VariantIndex].TileSize);
+		});
+
+	ProgressCurrent = WriteTilesLoopData.Count;
+	if (Result == Enum_LoopResult::Aborted) {
+		ScheduleWorkflow(Enum_HexGridWorkflowState::Error);
+		return;
+	}
+	if (Result == Enum_LoopResult::Yielded) {
+		return;
+	}
+
+	ScheduleWorkflow(Enum_HexGridWorkflowState::WriteTilesNeighbor);
+	UE_LOG(HexGridCreator, Log, TEXT("Write tiles done."));
+}
+
+void AHexGridCreator::WriteTileLine(std::ofstream& ofs, int64 Index, float Size)
+{
+	FIntPoint Hex = GetTileAxial(Index);
+	WriteIndicesKey(ofs, Hex);
+	WritePipeDelimiter(ofs);
+	WritePosition2D(ofs, HexMath::AxialToPosition(Hex, Size));
+	/*WritePipeDelimiter(ofs);
+	WriteNeighbors(ofs, Data);*/
+	WriteLineEnd(ofs);
+}
+
+void AHexGridCreator::WritePipeDelimiter(std::ofstream& ofs)
+{
+	ofs << TCHAR_TO_ANSI(*PipeDelim);
 }
 
 void AHexGridCreator::WriteColonDelimiter(std::ofstream& ofs)
@@ -462,9 +963,9 @@ void AHexGridCreator::WriteLineEnd(std::ofstream& ofs)
 	ofs << std::endl;
 }
 
-void AHexGridCreator::WriteIndices(std::ofstream& ofs, int32 Index)
+void AHexGridCreator::WriteIndices(std::ofstream& ofs, int64 Index)
 {
-	FString Str = FString::FromInt(Index);
+	FString Str = FString::Printf(TEXT("%lld"), Index);
 	ofs << TCHAR_TO_ANSI(*Str);
 }
 
@@ -477,9 +978,8 @@ void AHexGridCreator::WriteAxialCoord(std::ofstream& ofs, const FStructHexTileDa
 	ofs << TCHAR_TO_ANSI(*Str);
 }
 
-void AHexGridCreator::WritePosition2D(std::ofstream& ofs, const FStructHexTileData& Data)
+void AHexGridCreator::WritePosition2D(std::ofstream& ofs, const FVector2D& Pos2D)
 {
-	FVector2D Pos2D = Data.Position2D;
 	FText Txt = UKismetTextLibrary::Conv_FloatToText(Pos2D.X, ERoundingMode::HalfFromZero, false, false, 1, 324, 0, 2);
 	FString Str = UKismetTextLibrary::Conv_TextToString(Txt);
 	Str.Append(*CommaDelim);
@@ -515,39 +1015,25 @@ void AHexGridCreator::WritePosition2D(std::ofstream& ofs, const FStructHexTileDa
 
 void AHexGridCreator::WriteNeighborsToFile()
 {
-	int32 i = WriteNeighborsLoopData.IndexSaved[0];
-	FTimerHandle TimerHandle;
-	std::ofstream ofs;
-	ProgressTarget = Tiles.Num() * CalNeighborsWeight(NeighborRange);
-
-	for (; i <= NeighborRange; i++)
-	{
-		FString NeighborPath;
-		FString FullPath;
-		CreateNeighborPath(NeighborPath, i);
-		CreateFilePath(NeighborPath, FullPath);
-		
-		if (!WriteNeighborsLoopData.IsInitialized) {
-			WriteNeighborsLoopData.IsInitialized = true;
-			ofs.open(*FullPath, std::ios::out | std::ios::trunc);
-		}
-		else {
-			ofs.open(*FullPath, std::ios::out | std::ios::app);
+	if (!WriteNeighborsLoopData.IsInitialized) {
+		ProgressTarget = 0;
+		ProgressCurrent = 0;
+		for (const FStructHexGridVariant& Variant : Variants)
+		{
+			ProgressTarget += GetTileCount(Variant.GridRange) * CalNeighborsWeight(Variant.NeighborRange);
 		}
+	}
 
-		if (!ofs || !ofs.is_open()) {
-			UE_LOG(HexGridCreator, Warning, TEXT("Open file %s failed!"), *FullPath);
-			WorkflowState = Enum_HexGridWorkflowState::Error;
-			GetWorldTimerManager().SetTimer(TimerHandle, WorkflowDelegate, WriteNeighborsLoopData.Rate, false);
-			return;
-		}
-		if (!WriteNeighbors(ofs, i)) {
-			return;
-		}
+	Enum_LoopResult Result = WriteNeighbors();
+	if (Result == Enum_LoopResult::Aborted) {
+		ScheduleWorkflow(Enum_HexGridWorkflowState::Error);
+		return;
+	}
+	if (Result == Enum_LoopResult::Yielded) {
+		return;
 	}
 
-	WorkflowState = Enum_HexGridWorkflowState::WriteTileIndices;
-	GetWorldTimerManager().SetTimer(TimerHandle, WorkflowDelegate, WriteNeighborsLoopData.Rate, false);
+	ScheduleWorkflow(Enum_HexGridWorkflowState::WriteTileIndices);
 	UE_LOG(HexGridCreator, Log, TEXT("Write neighbors done."));
 }
 
@@ -556,118 +1042,107 @@ void AHexGridCreator::CreateNeighborPath(FString& NeighborPath, int32 Radius)
 	NeighborPath.Append(TilesNeighborPathPrefix).Append(FString::FromInt(Radius)).Append(FString(TEXT(".data")));
 }
 
-int32 AHexGridCreator::CalNeighborsWeight(int32 Range)
+int64 AHexGridCreator::CalNeighborsWeight(int32 Range)
 {
-	int32 weight = 0;
-	for (int32 i = 1; i <= Range; i++)
-	{
-		weight += i * 6;
-	}
-	return weight;
+	return GridEstimateUtility::GetNeighborCount(Range);
 }
 
-bool AHexGridCreator::WriteNeighbors(std::ofstream& ofs, int32 Radius)
+Enum_LoopResult AHexGridCreator::WriteNeighbors()
 {
-	int32 Count = 0;
-	TArray<int32> Indices = { Radius, 0 };
-	bool SaveLoopFlag = false;
-
-	int32 ProgressPre = Tiles.Num() * CalNeighborsWeight(Radius - 1);
-	int32 ProgressRatio = Radius * 6;
-	int32 i = WriteNeighborsLoopData.IndexSaved[1];
-	for (; i <= Tiles.Num() - 1; i++)
-	{
-		Indices[1] = i;
-		FlowControlUtility::SaveLoopData(this, WriteNeighborsLoopData, Count, Indices, WorkflowDelegate, SaveLoopFlag);
-		if (SaveLoopFlag) {
-			ofs.close();
-			return false;
+	//Resume appending to the file of the saved variant and radius, a new radius truncates its file in the loop body
+	std::ofstream ofs;
+	FString NeighborPath;
+	FString VariantPath;
+	if (WriteNeighborsLoopData.IsInitialized) {
+		CreateNeighborPath(NeighborPath, (int32)WriteNeighborsLoopData.IndexSaved[1]);
+		ResolveVariantPath(NeighborPath, (int32)WriteNeighborsLoopData.IndexSaved[0], VariantPath);
+		if (!OpenOutputFile(ofs, VariantPath, true)) {
+			return Enum_LoopResult::Aborted;
 		}
-		WriteNeighborLine(ofs, i, Radius);
-		ProgressCurrent = ProgressPre + WriteNeighborsLoopData.Count * ProgressRatio;
-		Count++;
 	}
 
-	FlowControlUtility::InitLoopData(WriteNeighborsLoopData);
+	//Loop levels: variant, radius, tile
+	Enum_LoopResult Result = FlowControlUtility::RunNestedLoop(this, WriteNeighborsLoopData, 3,
+		[this](int32 Depth, const TArray<int64>& Indices) {
+			switch (Depth)
+			{
+			case 0:
+				return FInt64Point(0, Variants.Num() - 1);
+			case 1:
+				return FInt64Point(1, Variants[(int32)Indices[0]].NeighborRange);
+			default:
+				return FInt64Point(0, GetTileCount(Variants[(int32)Indices[0]].GridRange) - 1);
+			}
+		},
+		[this, &ofs, &NeighborPath, &VariantPath](const TArray<int64>& Indices) {
+			int32 Radius = (int32)Indices[1];
+			if (Indices[2] == 0) {
+				NeighborPath.Empty();
+				CreateNeighborPath(NeighborPath, Radius);
+				ResolveVariantPath(NeighborPath, (int32)Indices[0], VariantPath);
+				if (!OpenOutputFile(ofs, VariantPath, false)) {
+					return false;
+				}
+			}
+			WriteNeighborLine(ofs, Indices[2], Radius, Variants[(int32)Indices[0]].GridRange);
+			ProgressCurrent += Radius * 6;
+			return true;
+		}, WorkflowDelegate);
+
 	ofs.close();
-	
-	FTimerHandle TimerHandle;
-	GetWorldTimerManager().SetTimer(TimerHandle, WorkflowDelegate, WriteTilesLoopData.Rate, false);
-	UE_LOG(HexGridCreator, Log, TEXT("Write neighbor N%d done."), Radius);
-	return true;
+	return Result;
 }
 
-void AHexGridCreator::WriteNeighborLine(std::ofstream& ofs, int32 Index, int32 Radius)
+void AHexGridCreator::WriteNeighborLine(std::ofstream& ofs, int64 Index, int32 Radius, int32 Range)
 {
-	FStructHexTileNeighbors Neighbors = Tiles[Index].Neighbors[Radius - 1];
-	for (int32 i = 0; i < Neighbors.Tiles.Num(); i++)
+	//Low memory mode keeps no neighbor arrays, the ring around the origin is moved to the tile instead
+	const TArray<FIntPoint>& Ring = LowMemoryMode ? RingOffsets[Radius - 1].Tiles : Tiles[Index].Neighbors[Radius - 1].Tiles;
+	FIntPoint Base = LowMemoryMode ? GetTileAxial(Index) : FIntPoint(0, 0);
+	bool First = true;
+	for (int32 i = 0; i < Ring.Num(); i++)
 	{
-		FString Str = FString::FromInt(Neighbors.Tiles[i].X);
-		Str.Append(*CommaDelim);
-		Str.Append(FString::FromInt(Neighbors.Tiles[i].Y));
-		if (i != Neighbors.Tiles.Num() - 1) {
-			Str.Append(*SpaceDelim);
+		FIntPoint Hex = Ring[i] + Base;
+		//A masked grid lists only the neighbors that are tiles of the grid
+		if (Mask.IsValid() && !IsTileInGrid(Hex, Range)) {
+			continue;
 		}
+		FString Str = First ? FString() : SpaceDelim;
+		Str.Append(FString::FromInt(Hex.X));
+		Str.Append(*CommaDelim);
+		Str.Append(FString::FromInt(Hex.Y));
 		ofs << TCHAR_TO_ANSI(*Str);
+		First = false;
 	}
 	WriteLineEnd(ofs);
 }
 
 void AHexGridCreator::WriteTileIndicesToFile()
 {
-	FString FullPath;
-	CreateFilePath(TileIndicesDataPath, FullPath);
-
-	FTimerHandle TimerHandle;
-	std::ofstream ofs;
 	if (!WriteTileIndicesLoopData.IsInitialized) {
-		WriteTileIndicesLoopData.IsInitialized = true;
-		ofs.open(*FullPath, std::ios::out | std::ios::trunc);
-		ProgressTarget = Tiles.Num();
-	}
-	else {
-		ofs.open(*FullPath, std::ios::out | std::ios::app);
+		ProgressTarget = GetVariantsTileCount();
 	}
 
-	if (!ofs || !ofs.is_open()) {
-		UE_LOG(HexGridCreator, Warning, TEXT("Open file %s failed!"), *FullPath);
-		WorkflowState = Enum_HexGridWorkflowState::Error;
-		GetWorldTimerManager().SetTimer(TimerHandle, WorkflowDelegate, WriteTileIndicesLoopData.Rate, false);
+	Enum_LoopResult Result = WriteVariantLines(WriteTileIndicesLoopData, TileIndicesDataPath,
+		[this](std::ofstream& ofs, int32 VariantIndex, int64 TileIndex) {
+			WriteTileIndicesLine(ofs, TileIndex);
+		});
+
+	ProgressCurrent = WriteTileIndicesLoopData.Count;
+	if (Result == Enum_LoopResult::Aborted) {
+		ScheduleWorkflow(Enum_HexGridWorkflowState::Error);
 		return;
 	}
-
-	WriteTileIndices(ofs);
-}
-
-void AHexGridCreator::WriteTileIndices(std::ofstream& ofs)
-{
-	int32 Count = 0;
-	TArray<int32> Indices = { 0 };
-	bool SaveLoopFlag = false;
-
-	int32 i = WriteTileIndicesLoopData.IndexSaved[0];
-	for (; i <= Tiles.Num() - 1; i++)
-	{
-		Indices[0] = i;
-		FlowControlUtility::SaveLoopData(this, WriteTileIndicesLoopData, Count, Indices, WorkflowDelegate, SaveLoopFlag);
-		if (SaveLoopFlag) {
-			ofs.close();
-			return;
-		}
-		WriteTileIndicesLine(ofs, i);
-		ProgressCurrent = WriteTileIndicesLoopData.Count;
-		Count++;
+	if (Result == Enum_LoopResult::Yielded) {
+		return;
 	}
-	ofs.close();
-	FTimerHandle TimerHandle;
-	WorkflowState = Enum_HexGridWorkflowState::WriteParams;
-	GetWorldTimerManager().SetTimer(TimerHandle, WorkflowDelegate, WriteTileIndicesLoopData.Rate, false);
+
+	ScheduleWorkflow(GetNextStage(Enum_HexGridWorkflowState::WriteTileIndices));
 	UE_LOG(HexGridCreator, Log, TEXT("Write tiles indices done."));
 }
 
-void AHexGridCreator::WriteTileIndicesLine(std::ofstream& ofs, int32 Index)
+void AHexGridCreator::WriteTileIndicesLine(std::ofstream& ofs, int64 Index)
 {
-	FIntPoint key = Tiles[Index].AxialCoord;
+	FIntPoint key = GetTileAxial(Index);
 	WriteIndicesKey(ofs, key);
 	WritePipeDelimiter(ofs);
 	WriteIndicesValue(ofs, Index);
@@ -682,53 +1157,943 @@ void AHexGridCreator::WriteIndicesKey(std::ofstream& ofs, const FIntPoint& key)
 	ofs << TCHAR_TO_ANSI(*Str);
 }
 
-void AHexGridCreator::WriteIndicesValue(std::ofstream& ofs, int32 Index)
+void AHexGridCreator::WriteIndicesValue(std::ofstream& ofs, int64 Index)
 {
-	FString Str = FString::FromInt(Index);
+	FString Str = FString::Printf(TEXT("%lld"), Index);
 	ofs << TCHAR_TO_ANSI(*Str);
 }
 
 void AHexGridCreator::WriteParamsToFile()
 {
-	FString FullPath;
-	CreateFilePath(ParamsDataPath, FullPath);
+	ProgressTarget = Variants.Num();
+	ProgressCurrent = 0;
+	for (int32 i = 0; i < Variants.Num(); i++)
+	{
+		FString RelPath;
+		ResolveVariantPath(ParamsDataPath, i, RelPath);
+		std::ofstream ofs;
+		if (!OpenOutputFile(ofs, RelPath, false)) {
+			ScheduleWorkflow(Enum_HexGridWorkflowState::Error);
+			return;
+		}
+		WriteParamsContent(ofs, Variants[i]);
+		ofs.close();
+		ProgressCurrent++;
+	}
 
-	FTimerHandle TimerHandle;
-	std::ofstream ofs;
-	ofs.open(*FullPath, std::ios::out | std::ios::trunc);
-	ProgressTarget = 1;
+	if (MeasureRates) {
+		MeasuredRates.WriteBytesPerSecond = GetWrittenBytes() / FMath::Max(FPlatformTime::Seconds() - WriteStartTime, 0.001);
+		UE_LOG(HexGridCreator, Log, TEXT("Measured rates: %.0f center tiles/s, %.0f neighbor entries/s, %.0f write bytes/s."),
+			MeasuredRates.CenterTilesPerSecond, MeasuredRates.NeighborEntriesPerSecond, MeasuredRates.WriteBytesPerSecond);
+	}
 
-	if (!ofs || !ofs.is_open()) {
-		UE_LOG(HexGridCreator, Warning, TEXT("Open file %s failed!"), *FullPath);
-		WorkflowState = Enum_HexGridWorkflowState::Error;
-		GetWorldTimerManager().SetTimer(TimerHandle, WorkflowDelegate, DefaultTimerRate, false);
+	RemoveCheckpoint();
+	ScheduleWorkflow(Enum_HexGridWorkflowState::Done);
+	UE_LOG(HexGridCreator, Log, TEXT("Write params done."));
+}
+
+void AHexGridCreator::WriteParamsContent(std::ofstream& ofs, const FStructHexGridVariant& Variant)
+{
+	FText Txt = UKismetTextLibrary::Conv_FloatToText(Variant.TileSize, ERoundingMode::HalfFromZero, false, false, 1, 324, 0, 2);
+	FString Str = UKismetTextLibrary::Conv_TextToString(Txt);
+	ofs << TCHAR_TO_ANSI(*Str);
+	WritePipeDelimiter(ofs);
+	Str = FString::FromInt(Variant.GridRange);
+	ofs << TCHAR_TO_ANSI(*Str);
+	WritePipeDelimiter(ofs);
+	Str = FString::FromInt(Variant.NeighborRange);
+	ofs << TCHAR_TO_ANSI(*Str);
+	WriteLineEnd(ofs);
+}
+
+void AHexGridCreator::GetLoopDataList(TArray<FStructLoopData*>& Out_List)
+{
+	Out_List.Empty();
+	Out_List.Add(&SpiralCreateCenterLoopData);
+	Out_List.Add(&SpiralCreateNeighborsLoopData);
+	Out_List.Add(&WriteTilesLoopData);
+	Out_List.Add(&WriteNeighborsLoopData);
+	Out_List.Add(&WriteTileIndicesLoopData);
+}
+
+bool AHexGridCreator::GetActiveOutputPath(FString& Out_RelPath)
+{
+	FString NeighborPath;
+	Out_RelPath.Empty();
+	switch (WorkflowState)
+	{
+	case Enum_HexGridWorkflowState::WriteTiles:
+		ResolveVariantPath(TilesDataPath, (int32)WriteTilesLoopData.IndexSaved[0], Out_RelPath);
+		return WriteTilesLoopData.IsInitialized;
+	case Enum_HexGridWorkflowState::WriteTilesNeighbor:
+		CreateNeighborPath(NeighborPath, FMath::Max((int32)WriteNeighborsLoopData.IndexSaved[1], 1));
+		ResolveVariantPath(NeighborPath, (int32)WriteNeighborsLoopData.IndexSaved[0], Out_RelPath);
+		return WriteNeighborsLoopData.IsInitialized;
+	case Enum_HexGridWorkflowState::WriteTileIndices:
+		ResolveVariantPath(TileIndicesDataPath, (int32)WriteTileIndicesLoopData.IndexSaved[0], Out_RelPath);
+		return WriteTileIndicesLoopData.IsInitialized;
+	default:
+		return false;
+	}
+}
+
+void AHexGridCreator::UpdateCheckpoint()
+{
+	//While the tiles of a restored checkpoint are generated again, that checkpoint stays the one to resume from
+	if (!EnableCheckpoint || ResumePending || WorkflowState < Enum_HexGridWorkflowState::SpiralCreateCenter
+		|| WorkflowState > Enum_HexGridWorkflowState::WriteParams) {
 		return;
 	}
 
-	WriteParams(ofs);
+	double Now = FPlatformTime::Seconds();
+	if (Now - LastCheckpointTime < CheckpointInterval) {
+		return;
+	}
+	LastCheckpointTime = Now;
+	WriteCheckpointToFile();
 }
 
-void AHexGridCreator::WriteParams(std::ofstream& ofs)
+void AHexGridCreator::WriteCheckpointToFile()
 {
-	WriteParamsContent(ofs);
-	ProgressCurrent = 1;
+	FString FullPath;
+	CreateFilePath(CheckpointDataPath, FullPath);
+	FString TmpPath = FullPath + TEXT(".tmp");
+
+	//Write to a temp file first, so a crash while writing never corrupts the last checkpoint
+	std::ofstream ofs;
+	ofs.open(std::filesystem::path(*TmpPath), std::ios::out | std::ios::trunc);
+	if (!ofs || !ofs.is_open()) {
+		UE_LOG(HexGridCreator, Warning, TEXT("Open file %s failed!"), *TmpPath);
+		return;
+	}
+	WriteCheckpointContent(ofs);
 	ofs.close();
-	FTimerHandle TimerHandle;
-	WorkflowState = Enum_HexGridWorkflowState::Done;
-	GetWorldTimerManager().SetTimer(TimerHandle, WorkflowDelegate, DefaultTimerRate, false);
-	UE_LOG(HexGridCreator, Log, TEXT("Write params done."));
+
+	std::error_code ErrorCode;
+	std::filesystem::rename(*TmpPath, *FullPath, ErrorCode);
+	if (ErrorCode) {
+		UE_LOG(HexGridCreator, Warning, TEXT("Save checkpoint %s failed!"), *FullPath);
+		return;
+	}
+	UE_LOG(HexGridCreator, Log, TEXT("Save checkpoint at state %d."), (int32)WorkflowState);
 }
 
-void AHexGridCreator::WriteParamsContent(std::ofstream& ofs)
+void AHexGridCreator::WriteCheckpointContent(std::ofstream& ofs)
 {
-	FText Txt = UKismetTextLibrary::Conv_FloatToText(TileSize, ERoundingMode::HalfFromZero, false, false, 1, 324, 0, 2);
-	FString Str = UKismetTextLibrary::Conv_TextToString(Txt);
+	//Header
+	FString Str = FString(TEXT("HexGridCheckpoint"));
+	Str.Append(*PipeDelim).Append(FString::FromInt(CHECKPOINT_VERSION));
 	ofs << TCHAR_TO_ANSI(*Str);
-	WritePipeDelimiter(ofs);
-	Str = FString::FromInt(GridRange);
+	WriteLineEnd(ofs);
+
+	//Params
+	GetParamsSignature(Str);
 	ofs << TCHAR_TO_ANSI(*Str);
-	WritePipeDelimiter(ofs);
-	Str = FString::FromInt(NeighborRange);
+	WriteLineEnd(ofs);
+
+	//Workflow state
+	Str = FString::FromInt((int32)WorkflowState);
+	ofs << TCHAR_TO_ANSI(*Str);
+	WriteLineEnd(ofs);
+
+	//Loop data
+	TArray<FStructLoopData*> LoopDataList;
+	GetLoopDataList(LoopDataList);
+	for (FStructLoopData* LoopData : LoopDataList)
+	{
+		FlowControlUtility::LoopDataToString(*LoopData, Str);
+		ofs << TCHAR_TO_ANSI(*Str);
+		WriteLineEnd(ofs);
+	}
+
+	//Progress
+	Str = FString::Printf(TEXT("%lld"), ProgressCurrent);
+	Str.Append(*PipeDelim).Append(FString::Printf(TEXT("%lld"), ProgressTarget));
 	ofs << TCHAR_TO_ANSI(*Str);
 	WriteLineEnd(ofs);
-}
\ No newline at end of file
+
+	//Byte offset of the file being written
+	FString RelPath;
+	int64 Offset = 0;
+	if (GetActiveOutputPath(RelPath)) {
+		std::error_code ErrorCode;
+		FString FullPath = FPaths::ProjectDir().Append(RelPath);
+		uintmax_t Size = std::filesystem::file_size(*FullPath, ErrorCode);
+		Offset = ErrorCode ? 0 : (int64)Size;
+	}
+	else {
+		RelPath.Empty();
+	}
+	Str = RelPath;
+	Str.Append(*PipeDelim).Append(FString::Printf(TEXT("%lld"), Offset));
+	ofs << TCHAR_TO_ANSI(*Str);
+	WriteLineEnd(ofs);
+}
+
+bool AHexGridCreator::ReadCheckpointLines(TArray<FString>& Out_Lines)
+{
+	FString FullPath = FPaths::ProjectDir().Append(CheckpointDataPath);
+	if (!FPaths::FileExists(FullPath)) {
+		return false;
+	}
+
+	FString Header = FString(TEXT("HexGridCheckpoint"));
+	Header.Append(*PipeDelim).Append(FString::FromInt(CHECKPOINT_VERSION));
+	if (!FFileHelper::LoadFileToStringArray(Out_Lines, *FullPath) || Out_Lines.Num() < 10 || Out_Lines[0] != Header) {
+		UE_LOG(HexGridCreator, Warning, TEXT("Checkpoint %s is invalid, restart workflow."), *FullPath);
+		return false;
+	}
+	return true;
+}
+
+bool AHexGridCreator::RestoreFromCheckpoint()
+{
+	TArray<FString> Lines;
+	if (!ReadCheckpointLines(Lines)) {
+		return false;
+	}
+
+	//Params must match, otherwise the checkpoint belongs to another grid
+	FString Signature;
+	GetParamsSignature(Signature);
+	if (Lines[1] != Signature) {
+		UE_LOG(HexGridCreator, Warning, TEXT("Checkpoint params mismatch, restart workflow."));
+		return false;
+	}
+
+	int32 State = FCString::Atoi(*Lines[2]);
+	if (State < (int32)Enum_HexGridWorkflowState::SpiralCreateCenter || State > (int32)Enum_HexGridWorkflowState::WriteParams) {
+		UE_LOG(HexGridCreator, Warning, TEXT("Checkpoint state %d is invalid, restart workflow."), State);
+		return false;
+	}
+
+	//Parse everything before touching the current loop data
+	TArray<FStructLoopData*> LoopDataList;
+	GetLoopDataList(LoopDataList);
+	TArray<FStructLoopData> Restored;
+	for (int32 i = 0; i < LoopDataList.Num(); i++)
+	{
+		FStructLoopData Data = *LoopDataList[i];
+		if (!FlowControlUtility::LoopDataFromString(Lines[3 + i], Data)) {
+			UE_LOG(HexGridCreator, Warning, TEXT("Checkpoint loop data %d is invalid, restart workflow."), i);
+			return false;
+		}
+		Restored.Add(Data);
+	}
+
+	Enum_HexGridWorkflowState PreState = WorkflowState;
+	WorkflowState = (Enum_HexGridWorkflowState)State;
+	for (int32 i = 0; i < LoopDataList.Num(); i++)
+	{
+		*LoopDataList[i] = Restored[i];
+	}
+
+	if (!RestoreOutputFile(Lines[9])) {
+		WorkflowState = PreState;
+		InitLoopData();
+		return false;
+	}
+
+	TArray<FString> Progress;
+	Lines[8].ParseIntoArray(Progress, *PipeDelim, false);
+	ResetProgress();
+	if (Progress.Num() == 2) {
+		ProgressCurrent = FCString::Atoi64(*Progress[0]);
+		ProgressTarget = FCString::Atoi64(*Progress[1]);
+	}
+
+	//In-memory tiles are generated again by the time budgeted spiral stages, like in a fresh run
+	switch (WorkflowState)
+	{
+	case Enum_HexGridWorkflowState::SpiralCreateCenter:
+	case Enum_HexGridWorkflowState::SpiralCreateNeighbors:
+		//Nothing of these stages is on disk, generation starts over
+		ResetProgress();
+		WorkflowState = Enum_HexGridWorkflowState::SpiralCreateCenter;
+		break;
+	case Enum_HexGridWorkflowState::WriteParams:
+		break;
+	default:
+		//Low memory mode keeps no tiles, they are computed from the spiral index
+		if (!LowMemoryMode) {
+			ResumePending = true;
+			ResumeState = WorkflowState;
+			ResumeProgressCurrent = ProgressCurrent;
+			ResumeProgressTarget = ProgressTarget;
+			ResetProgress();
+			WorkflowState = Enum_HexGridWorkflowState::SpiralCreateCenter;
+		}
+		break;
+	}
+	if (WorkflowState == Enum_HexGridWorkflowState::SpiralCreateCenter) {
+		FlowControlUtility::InitLoopData(SpiralCreateCenterLoopData);
+		FlowControlUtility::InitLoopData(SpiralCreateNeighborsLoopData);
+	}
+
+	UE_LOG(HexGridCreator, Log, TEXT("Restore from checkpoint at state %d."), (int32)(ResumePending ? ResumeState : WorkflowState));
+	return true;
+}
+
+bool AHexGridCreator::RestoreOutputFile(const FString& Line)
+{
+	TArray<FString> Parts;
+	Line.ParseIntoArray(Parts, *PipeDelim, false);
+	if (Parts.Num() != 2) {
+		return false;
+	}
+
+	FString RelPath;
+	if (!GetActiveOutputPath(RelPath)) {
+		return Parts[0].IsEmpty();
+	}
+	if (Parts[0] != RelPath) {
+		UE_LOG(HexGridCreator, Warning, TEXT("Checkpoint output %s mismatch, restart workflow."), *Parts[0]);
+		return false;
+	}
+
+	//Drop anything written after the checkpoint was taken
+	FString FullPath = FPaths::ProjectDir().Append(RelPath);
+	int64 Offset = FCString::Atoi64(*Parts[1]);
+	std::error_code ErrorCode;
+	uintmax_t Size = std::filesystem::file_size(*FullPath, ErrorCode);
+	if (ErrorCode || (int64)Size < Offset) {
+		UE_LOG(HexGridCreator, Warning, TEXT("Checkpoint output %s is shorter than %lld bytes, restart workflow."), *FullPath, Offset);
+		return false;
+	}
+	std::filesystem::resize_file(*FullPath, (uintmax_t)Offset, ErrorCode);
+	return !ErrorCode;
+}
+
+void AHexGridCreator::RemoveCheckpoint()
+{
+	FString FullPath = FPaths::ProjectDir().Append(CheckpointDataPath);
+	std::error_code ErrorCode;
+	std::filesystem::remove(*FullPath, ErrorCode);
+}
+
+void AHexGridCreator::StartPipeline()
+{
+	TArray<FStructPipelineFile> Files;
+	TArray<FString> RelPaths;
+	GetPipelineFiles(Files, RelPaths);
+
+	//A shard writes its range of every file next to the file, the merge puts the parts together
+	int64 TileBegin = 0;
+	int64 TileEnd = MAX_int64;
+	if (Shard.IsValid()) {
+		GridShardUtility::GetTileRange(GetTileCount(GridRange), Shard, TileBegin, TileEnd);
+		for (FStructPipelineFile& File : Files)
+		{
+			File.FullPath = GridShardUtility::GetShardPath(File.FullPath, Shard);
+		}
+		UE_LOG(HexGridCreator, Log, TEXT("Shard %d of %d writes tiles %lld .. %lld."), Shard.Index, Shard.Count, TileBegin, TileEnd - 1);
+	}
+
+	Pipeline = MakeUnique<FHexGridPipeline>(PipelineSettings, Files, Mask.IsValid() ? &Mask : nullptr, TileBegin, TileEnd);
+	Pipeline->Start();
+	ProgressTarget = Pipeline->GetTileCount();
+	ProgressCurrent = 0;
+	WriteStartTime = FPlatformTime::Seconds();
+	ScheduleWorkflow(Enum_HexGridWorkflowState::Pipeline);
+	UE_LOG(HexGridCreator, Log, TEXT("Pipeline started with %d files."), Files.Num());
+}
+
+void AHexGridCreator::PollPipeline()
+{
+	ProgressCurrent = Pipeline->GetTilesWritten();
+	if (Pipeline->HasFailed()) {
+		Pipeline.Reset();
+		ScheduleWorkflow(Enum_HexGridWorkflowState::Error);
+		return;
+	}
+	if (!Pipeline->IsFinished()) {
+		GetWorldTimerManager().SetTimerForNextTick(WorkflowDelegate);
+		return;
+	}
+
+	UE_LOG(HexGridCreator, Log, TEXT("Pipeline done, %lld bytes in %.2f seconds."), Pipeline->GetBytesWritten(), GetStageSeconds());
+	Pipeline.Reset();
+	ResetProgress();
+	//Optional stages and params need every tile, they run after the merge
+	ScheduleWorkflow(Shard.IsValid() ? Enum_HexGridWorkflowState::ShardManifest : GetNextStage(Enum_HexGridWorkflowState::Pipeline));
+}
+
+void AHexGridCreator::GetPipelineFiles(TArray<FStructPipelineFile>& Out_Files, TArray<FString>& Out_RelPaths)
+{
+	//Every variant writes Tiles, N1..N{r} and TileIndices from the same spiral
+	Out_Files.Empty();
+	Out_RelPaths.Empty();
+	for (int32 i = 0; i < Variants.Num(); i++)
+	{
+		AddPipelineFile(Out_Files, Out_RelPaths, TilesDataPath, i, Enum_PipelineOutput::Tiles, 0);
+		for (int32 Radius = 1; Radius <= Variants[i].NeighborRange; Radius++)
+		{
+			FString NeighborPath;
+			CreateNeighborPath(NeighborPath, Radius);
+			AddPipelineFile(Out_Files, Out_RelPaths, NeighborPath, i, Enum_PipelineOutput::Neighbors, Radius);
+		}
+		AddPipelineFile(Out_Files, Out_RelPaths, TileIndicesDataPath, i, Enum_PipelineOutput::TileIndices, 0);
+	}
+}
+
+void AHexGridCreator::AddPipelineFile(TArray<FStructPipelineFile>& Out_Files, TArray<FString>& Out_RelPaths, const FString& RelPath,
+	int32 VariantIndex, Enum_PipelineOutput Type, int32 Radius)
+{
+	FString& VariantPath = Out_RelPaths.AddDefaulted_GetRef();
+	ResolveVariantPath(RelPath, VariantIndex, VariantPath);
+	FStructPipelineFile& File = Out_Files.AddDefaulted_GetRef();
+	CreateFilePath(VariantPath, File.FullPath);
+	File.Type = Type;
+	File.TileCount = GetTileCount(Variants[VariantIndex].GridRange);
+	File.GridRange = Variants[VariantIndex].GridRange;
+	File.TileSize = Variants[VariantIndex].TileSize;
+	File.Radius = Radius;
+}
+
+Enum_HexGridWorkflowState AHexGridCreator::GetNextStage(Enum_HexGridWorkflowState Finished)
+{
+	//Optional stages run in this order after the text outputs, WriteParams comes last
+	const TPair<Enum_HexGridWorkflowState, bool> OptionalStages[] = {
+		{ Enum_HexGridWorkflowState::DualGraph, EnableDualGraph },
+		{ Enum_HexGridWorkflowState::LosStencil, EnableLosStencil },
+		{ Enum_HexGridWorkflowState::Hpa, EnableHpa },
+		{ Enum_HexGridWorkflowState::Binary, EnableBinaryOutputs },
+		{ Enum_HexGridWorkflowState::Attributes, EnableAttributes },
+		{ Enum_HexGridWorkflowState::BulkAsset, EnableBulkAsset },
+		{ Enum_HexGridWorkflowState::FlowField, EnableFlowFields }
+	};
+
+	bool Passed = Finished == Enum_HexGridWorkflowState::WriteTileIndices || Finished == Enum_HexGridWorkflowState::Pipeline
+		|| Finished == Enum_HexGridWorkflowState::ShardMerge;
+	for (const TPair<Enum_HexGridWorkflowState, bool>& Stage : OptionalStages)
+	{
+		if (Passed && Stage.Value) {
+			return Stage.Key;
+		}
+		Passed |= Stage.Key == Finished;
+	}
+	return Enum_HexGridWorkflowState::WriteParams;
+}
+
+void AHexGridCreator::StartStageTask(TFunction<bool()>&& Task)
+{
+	ResetProgress();
+	StageTask = Async(EAsyncExecution::Thread, MoveTemp(Task));
+}
+
+bool AHexGridCreator::PollStageTask(bool& Out_Succeeded)
+{
+	if (!StageTask.IsReady()) {
+		GetWorldTimerManager().SetTimerForNextTick(WorkflowDelegate);
+		return false;
+	}
+	Out_Succeeded = StageTask.Get();
+	StageTask.Reset();
+	return true;
+}
+
+void AHexGridCreator::BuildDualGraph()
+{
+	if (Mask.IsValid()) {
+		//Graph ids follow the spiral of the full hexagon and would not match the compact tile indices
+		UE_LOG(HexGridCreator, Warning, TEXT("Dual graph does not support masked grids yet, skipped."));
+		ScheduleWorkflow(GetNextStage(Enum_HexGridWorkflowState::DualGraph));
+		return;
+	}
+
+	if (!StageTask.IsValid()) {
+		//One graph per variant, the task only sees copies so it never touches the actor
+		TArray<TPair<int32, FString>> Jobs;
+		for (int32 i = 0; i < Variants.Num(); i++)
+		{
+			FString RelPath;
+			ResolveVariantPath(DualGraphDataPath, i, RelPath);
+			TPair<int32, FString>& Job = Jobs.Emplace_GetRef(Variants[i].GridRange, FString());
+			CreateFilePath(RelPath, Job.Value);
+		}
+		StartStageTask([Jobs]() {
+			for (const TPair<int32, FString>& Job : Jobs)
+			{
+				FStructHexDualGraph Graph;
+				if (!GridDualGraphUtility::Build(Job.Key, Graph) || !GridDualGraphUtility::WriteToFile(Graph, Job.Value)) {
+					return false;
+				}
+			}
+			return true;
+		});
+	}
+
+	bool Succeeded;
+	if (!PollStageTask(Succeeded)) {
+		return;
+	}
+	if (!Succeeded) {
+		ScheduleWorkflow(Enum_HexGridWorkflowState::Error);
+		return;
+	}
+
+	UE_LOG(HexGridCreator, Log, TEXT("Build dual graph done in %.2f seconds."), GetStageSeconds());
+	ScheduleWorkflow(GetNextStage(Enum_HexGridWorkflowState::DualGraph));
+}
+
+void AHexGridCreator::BuildLosStencil()
+{
+	if (!StageTask.IsValid()) {
+		//Offsets do not depend on the tile, one stencil covers every variant and a masked grid alike
+		FString FullPath;
+		CreateFilePath(LosStencilDataPath, FullPath);
+		int32 Range = NeighborRange;
+		StartStageTask([Range, FullPath]() {
+			FStructHexLosStencil Stencil;
+			return GridLosUtility::Build(Range, Stencil) && GridLosUtility::WriteToFile(Stencil, FullPath);
+		});
+	}
+
+	bool Succeeded;
+	if (!PollStageTask(Succeeded)) {
+		return;
+	}
+	if (!Succeeded) {
+		ScheduleWorkflow(Enum_HexGridWorkflowState::Error);
+		return;
+	}
+
+	UE_LOG(HexGridCreator, Log, TEXT("Build line of sight stencil done in %.2f seconds."), GetStageSeconds());
+	ScheduleWorkflow(GetNextStage(Enum_HexGridWorkflowState::LosStencil));
+}
+
+void AHexGridCreator::BuildHpaGraph()
+{
+	if (!StageTask.IsValid()) {
+		//Tiles are read back from the written files, which covers low memory mode, the pipeline and masks alike
+		TArray<TPair<FString, FString>> Jobs;
+		for (int32 i = 0; i < Variants.Num(); i++)
+		{
+			FString RelPath;
+			TPair<FString, FString>& Job = Jobs.AddDefaulted_GetRef();
+			ResolveVariantPath(TilesDataPath, i, RelPath);
+			Job.Key = FPaths::ProjectDir().Append(RelPath);
+			ResolveVariantPath(HpaGraphDataPath, i, RelPath);
+			CreateFilePath(RelPath, Job.Value);
+		}
+		int32 ClusterRadius = HpaClusterRadius;
+		StartStageTask([Jobs, ClusterRadius]() {
+			for (const TPair<FString, FString>& Job : Jobs)
+			{
+				FStructHexTilesTable Table;
+				FStructHexTileGraph TileGraph;
+				FStructHexHpaGraph Graph;
+				if (!GridDataLoader::LoadTiles(Job.Key, Table) || !GridHpaUtility::BuildTileGraph(Table.AxialCoords, nullptr, nullptr, TileGraph)
+					|| !GridHpaUtility::Build(TileGraph, ClusterRadius, Graph) || !GridHpaUtility::WriteToFile(Graph, Job.Value)) {
+					return false;
+				}
+			}
+			return true;
+		});
+	}
+
+	bool Succeeded;
+	if (!PollStageTask(Succeeded)) {
+		return;
+	}
+	if (!Succeeded) {
+		ScheduleWorkflow(Enum_HexGridWorkflowState::Error);
+		return;
+	}
+
+	UE_LOG(HexGridCreator, Log, TEXT("Build HPA graph done in %.2f seconds."), GetStageSeconds());
+	ScheduleWorkflow(GetNextStage(Enum_HexGridWorkflowState::Hpa));
+}
+
+
+void AHexGridCreator::WriteBinaryOutputs()
+{
+	if (!StageTask.IsValid()) {
+		struct FBinaryJob
+		{
+			int32 GridRange;
+			float TileSize;
+			TArray<int64> RingEnds;
+			FString TilesPath;
+			TArray<FString> NeighborPaths;
+		};
+		TArray<FBinaryJob> Jobs;
+		for (int32 i = 0; i < Variants.Num(); i++)
+		{
+			const FStructHexGridVariant& Variant = Variants[i];
+			FString RelPath;
+			FBinaryJob& Job = Jobs.AddDefaulted_GetRef();
+			Job.GridRange = Variant.GridRange;
+			Job.TileSize = Variant.TileSize;
+			if (Mask.IsValid()) {
+				//Every grid range is a prefix of the spiral, so the variant keeps the first ring ends
+				Job.RingEnds.Append(MaskRingEnds.GetData(), FMath::Min(Variant.GridRange + 1, MaskRingEnds.Num()));
+			}
+			ResolveVariantPath(FPaths::ChangeExtension(TilesDataPath, TEXT("bin")), i, RelPath);
+			CreateFilePath(RelPath, Job.TilesPath);
+			for (int32 Radius = 1; Radius <= Variant.NeighborRange; Radius++)
+			{
+				FString NeighborPath;
+				CreateNeighborPath(NeighborPath, Radius);
+				ResolveVariantPath(FPaths::ChangeExtension(NeighborPath, TEXT("bin")), i, RelPath);
+				CreateFilePath(RelPath, Job.NeighborPaths.AddDefaulted_GetRef());
+			}
+		}
+		//The task owns a copy of the mask, it never touches the actor
+		FStructHexGridMask TaskMask = Mask;
+		StartStageTask([Jobs, TaskMask]() {
+			for (const FBinaryJob& Job : Jobs)
+			{
+				TArray64<FIntPoint> Tiles;
+				TArray64<uint32> SpiralTiles;
+				if (TaskMask.IsValid()) {
+					GridMaskUtility::CollectTiles(TaskMask, Job.RingEnds, Tiles);
+					GridMaskUtility::CollectSpiralTiles(Tiles, Job.GridRange, SpiralTiles);
+				}
+				const TArray64<FIntPoint>* TilesPtr = TaskMask.IsValid() ? &Tiles : nullptr;
+				const TArray64<uint32>* SpiralTilesPtr = TaskMask.IsValid() ? &SpiralTiles : nullptr;
+				if (!GridBinaryUtility::WriteTiles(Job.TilesPath, Job.GridRange, Job.TileSize, TilesPtr)) {
+					return false;
+				}
+				for (int32 Radius = 1; Radius <= Job.NeighborPaths.Num(); Radius++)
+				{
+					if (!GridBinaryUtility::WriteNeighbors(Job.NeighborPaths[Radius - 1], Job.GridRange, Radius, TilesPtr, SpiralTilesPtr)) {
+						return false;
+					}
+				}
+			}
+			return true;
+		});
+	}
+
+	bool Succeeded;
+	if (!PollStageTask(Succeeded)) {
+		return;
+	}
+	if (!Succeeded) {
+		ScheduleWorkflow(Enum_HexGridWorkflowState::Error);
+		return;
+	}
+
+	UE_LOG(HexGridCreator, Log, TEXT("Write binary outputs done in %.2f seconds."), GetStageSeconds());
+	ScheduleWorkflow(GetNextStage(Enum_HexGridWorkflowState::Binary));
+}
+
+
+void AHexGridCreator::WriteAttributes()
+{
+	if (!StageTask.IsValid()) {
+		struct FAttributesJob
+		{
+			int32 GridRange;
+			float TileSize;
+			TArray<int64> RingEnds;
+			FString Path;
+		};
+		TArray<FAttributesJob> Jobs;
+		for (int32 i = 0; i < Variants.Num(); i++)
+		{
+			const FStructHexGridVariant& Variant = Variants[i];
+			FString RelPath;
+			FAttributesJob& Job = Jobs.AddDefaulted_GetRef();
+			Job.GridRange = Variant.GridRange;
+			Job.TileSize = Variant.TileSize;
+			if (Mask.IsValid()) {
+				Job.RingEnds.Append(MaskRingEnds.GetData(), FMath::Min(Variant.GridRange + 1, MaskRingEnds.Num()));
+			}
+			ResolveVariantPath(AttributesDataPath, i, RelPath);
+			CreateFilePath(RelPath, Job.Path);
+		}
+		FStructHexGridMask TaskMask = Mask;
+		TArray<FStructHexNoiseChannel> Channels = AttributeChannels;
+		StartStageTask([Jobs, TaskMask, Channels]() {
+			for (const FAttributesJob& Job : Jobs)
+			{
+				//Columns follow the tile index, so a masked grid evaluates its tiles in Tiles.data order
+				TArray64<FIntPoint> Tiles;
+				if (TaskMask.IsValid()) {
+					GridMaskUtility::CollectTiles(TaskMask, Job.RingEnds, Tiles);
+				}
+				if (!GridNoiseUtility::WriteAttributes(Job.Path, Job.GridRange, Job.TileSize, Channels, TaskMask.IsValid() ? &Tiles : nullptr)) {
+					return false;
+				}
+			}
+			return true;
+		});
+	}
+
+	bool Succeeded;
+	if (!PollStageTask(Succeeded)) {
+		return;
+	}
+	if (!Succeeded) {
+		ScheduleWorkflow(Enum_HexGridWorkflowState::Error);
+		return;
+	}
+
+	UE_LOG(HexGridCreator, Log, TEXT("Write attributes done in %.2f seconds."), GetStageSeconds());
+	ScheduleWorkflow(GetNextStage(Enum_HexGridWorkflowState::Attributes));
+}
+
+
+void AHexGridCreator::BuildBulkAssets()
+{
+#if WITH_EDITOR
+	if (!StageTask.IsValid()) {
+		TSharedRef<TArray<FBulkAssetJob>> Jobs = MakeShared<TArray<FBulkAssetJob>>();
+		for (int32 i = 0; i < Variants.Num(); i++)
+		{
+			FBulkAssetJob& Job = Jobs->AddDefaulted_GetRef();
+			Job.Variant = Variants[i];
+			ResolveVariantPackage(Variants[i], Job.PackageName);
+			if (Mask.IsValid()) {
+				Job.RingEnds.Append(MaskRingEnds.GetData(), FMath::Min(Job.Variant.GridRange + 1, MaskRingEnds.Num()));
+			}
+		}
+		BulkAssetJobs = Jobs;
+		FStructHexGridMask TaskMask = Mask;
+		StartStageTask([Jobs, TaskMask]() {
+			for (FBulkAssetJob& Job : *Jobs)
+			{
+				TArray64<FIntPoint> Tiles;
+				TArray64<uint32> SpiralTiles;
+				if (TaskMask.IsValid()) {
+					GridMaskUtility::CollectTiles(TaskMask, Job.RingEnds, Tiles);
+					GridMaskUtility::CollectSpiralTiles(Tiles, Job.Variant.GridRange, SpiralTiles);
+				}
+				Job.TileCount = TaskMask.IsValid() ? Tiles.Num() : HexMath::GetTileCount(Job.Variant.GridRange);
+				if (!GridBinaryUtility::BuildPayload(Job.Variant.GridRange, Job.Variant.TileSize, Job.Variant.NeighborRange,
+					TaskMask.IsValid() ? &Tiles : nullptr, TaskMask.IsValid() ? &SpiralTiles : nullptr, Job.Payload, Job.Sections)) {
+					return false;
+				}
+			}
+			return true;
+		});
+	}
+
+	bool Succeeded;
+	if (!PollStageTask(Succeeded)) {
+		return;
+	}
+	//Packages are created and saved on the game thread
+	for (int32 i = 0; Succeeded && i < BulkAssetJobs->Num(); i++)
+	{
+		const FBulkAssetJob& Job = (*BulkAssetJobs)[i];
+		Succeeded = UHexGridDataAsset::SaveAsset(Job.PackageName, Job.Variant, Job.TileCount, BulkLoadMode, Job.Payload, Job.Sections);
+	}
+	BulkAssetJobs.Reset();
+	if (!Succeeded) {
+		ScheduleWorkflow(Enum_HexGridWorkflowState::Error);
+		return;
+	}
+
+	UE_LOG(HexGridCreator, Log, TEXT("Build bulk assets done in %.2f seconds."), GetStageSeconds());
+	ScheduleWorkflow(GetNextStage(Enum_HexGridWorkflowState::BulkAsset));
+#else
+	UE_LOG(HexGridCreator, Warning, TEXT("Bulk assets can only be saved by an editor build."));
+	ScheduleWorkflow(Enum_HexGridWorkflowState::Error);
+#endif
+}
+
+
+void AHexGridCreator::BuildFlowFields()
+{
+	if (!StageTask.IsValid()) {
+		struct FFlowFieldJob
+		{
+			FString TilesPath;
+			FString CostsPath;
+			TArray<FString> Paths;
+		};
+		TArray<FFlowFieldJob> Jobs;
+		for (int32 i = 0; i < Variants.Num(); i++)
+		{
+			FString RelPath;
+			FFlowFieldJob& Job = Jobs.AddDefaulted_GetRef();
+			ResolveVariantPath(TilesDataPath, i, RelPath);
+			Job.TilesPath = FPaths::ProjectDir().Append(RelPath);
+			if (!FlowFieldCostsPath.IsEmpty()) {
+				ResolveVariantPath(FlowFieldCostsPath, i, RelPath);
+				Job.CostsPath = FPaths::ProjectDir().Append(RelPath);
+			}
+			for (const FStructHexFlowFieldSources& Group : FlowFieldSources)
+			{
+				ResolveFlowFieldPath(Group.Name, Variants[i], RelPath);
+				CreateFilePath(RelPath, Job.Paths.AddDefaulted_GetRef());
+			}
+		}
+		TArray<FStructHexFlowFieldSources> Groups = FlowFieldSources;
+		StartStageTask([Jobs, Groups]() {
+			for (const FFlowFieldJob& Job : Jobs)
+			{
+				//One graph and one cost table per variant, shared by all of its groups
+				FStructHexTilesTable Table;
+				FStructHexTileGraph TileGraph;
+				if (!GridDataLoader::LoadTiles(Job.TilesPath, Table) || !GridHpaUtility::BuildTileGraph(Table.AxialCoords, nullptr, nullptr, TileGraph)) {
+					return false;
+				}
+				TArray64<uint8> Costs;
+				if (!Job.CostsPath.IsEmpty() && !FFileHelper::LoadFileToArray(Costs, *Job.CostsPath)) {
+					UE_LOG(HexGridCreator, Warning, TEXT("Can not read flow field costs %s."), *Job.CostsPath);
+					return false;
+				}
+
+				for (int32 i = 0; i < Groups.Num(); i++)
+				{
+					TArray<uint32> Sources;
+					for (const FIntPoint& Hex : Groups[i].Sources)
+					{
+						uint32 Tile = TileGraph.FindTile(Hex);
+						if (Tile == HPA_NONE) {
+							UE_LOG(HexGridCreator, Warning, TEXT("Flow field source (%d, %d) of %s is no tile of %s, skipped."), Hex.X, Hex.Y,
+								*Groups[i].Name.ToString(), *Job.TilesPath);
+							continue;
+						}
+						Sources.Add(Tile);
+					}
+					FStructHexFlowField Field;
+					if (!GridFlowFieldUtility::Build(TileGraph, Sources, Job.CostsPath.IsEmpty() ? nullptr : &Costs, Field)
+						|| !GridFlowFieldUtility::WriteToFile(Field, Job.Paths[i])) {
+						return false;
+					}
+				}
+			}
+			return true;
+		});
+	}
+
+	bool Succeeded;
+	if (!PollStageTask(Succeeded)) {
+		return;
+	}
+	if (!Succeeded) {
+		ScheduleWorkflow(Enum_HexGridWorkflowState::Error);
+		return;
+	}
+
+	UE_LOG(HexGridCreator, Log, TEXT("Build flow fields done in %.2f seconds."), GetStageSeconds());
+	ScheduleWorkflow(GetNextStage(Enum_HexGridWorkflowState::FlowField));
+}
+
+
+void AHexGridCreator::WriteShardManifest()
+{
+	if (!StageTask.IsValid()) {
+		FStructHexShardManifest Manifest;
+		TArray<FString> PartPaths;
+		GetGridSignature(Manifest.Signature);
+		Manifest.Shard = Shard;
+		GetShardFiles(PartPaths, Manifest.Files);
+		int64 TileBegin, TileEnd;
+		GridShardUtility::GetTileRange(GetTileCount(GridRange), Shard, TileBegin, TileEnd);
+		for (int32 i = 0; i < PartPaths.Num(); i++)
+		{
+			//Smaller variants end inside or before the range of the shard
+			FStructHexShardFile& File = Manifest.Files[i];
+			File.TileBegin = FMath::Min(TileBegin, File.TileCount);
+			File.TileEnd = FMath::Min(TileEnd, File.TileCount);
+			PartPaths[i] = GridShardUtility::GetShardPath(PartPaths[i], Shard);
+		}
+		FString ManifestPath;
+		CreateFilePath(GridShardUtility::GetShardPath(ShardManifestPath, Shard), ManifestPath);
+
+		StartStageTask([Manifest, PartPaths, ManifestPath]() {
+			FStructHexShardManifest Hashed = Manifest;
+			for (int32 i = 0; i < PartPaths.Num(); i++)
+			{
+				if (!GridShardUtility::HashFile(PartPaths[i], Hashed.Files[i].Bytes, Hashed.Files[i].Crc)) {
+					return false;
+				}
+			}
+			return GridShardUtility::WriteManifest(ManifestPath, Hashed);
+		});
+	}
+
+	bool Succeeded;
+	if (!PollStageTask(Succeeded)) {
+		return;
+	}
+	if (!Succeeded) {
+		ScheduleWorkflow(Enum_HexGridWorkflowState::Error);
+		return;
+	}
+
+	UE_LOG(HexGridCreator, Log, TEXT("Shard %d of %d done, merge with -MergeShards=%d once every shard is done."), Shard.Index,
+		Shard.Count, Shard.Count);
+	ScheduleWorkflow(Enum_HexGridWorkflowState::Done);
+}
+
+void AHexGridCreator::MergeShards()
+{
+	if (!StageTask.IsValid()) {
+		FString Signature;
+		TArray<FString> FullPaths;
+		TArray<FStructHexShardFile> ExpectedFiles;
+		TArray<FString> ManifestPaths;
+		GetGridSignature(Signature);
+		GetShardFiles(FullPaths, ExpectedFiles);
+		for (int32 i = 0; i < MergeShardCount; i++)
+		{
+			FStructHexGridShard ManifestShard;
+			ManifestShard.Index = i;
+			ManifestShard.Count = MergeShardCount;
+			ManifestPaths.Add(FPaths::ProjectDir().Append(GridShardUtility::GetShardPath(ShardManifestPath, ManifestShard)));
+		}
+
+		StartStageTask([Signature, FullPaths, ExpectedFiles, ManifestPaths]() {
+			//Every manifest is read and checked before a single byte is merged
+			TArray<FStructHexShardManifest> Manifests;
+			for (const FString& ManifestPath : ManifestPaths)
+			{
+				if (!GridShardUtility::ReadManifest(ManifestPath, Manifests.AddDefaulted_GetRef())) {
+					return false;
+				}
+			}
+			if (!GridShardUtility::ValidateManifests(Manifests, Signature, ExpectedFiles)
+				|| !GridShardUtility::MergeFiles(Manifests, FullPaths)) {
+				return false;
+			}
+
+			//Parts go only once every file is in place, a failed merge can be retried as it is
+			std::error_code ErrorCode;
+			for (int32 i = 0; i < Manifests.Num(); i++)
+			{
+				for (const FString& FullPath : FullPaths)
+				{
+					std::filesystem::remove(std::filesystem::path(*GridShardUtility::GetShardPath(FullPath, Manifests[i].Shard)), ErrorCode);
+				}
+				std::filesystem::remove(std::filesystem::path(*ManifestPaths[i]), ErrorCode);
+			}
+			return true;
+		});
+	}
+
+	bool Succeeded;
+	if (!PollStageTask(Succeeded)) {
+		return;
+	}
+	if (!Succeeded) {
+		ScheduleWorkflow(Enum_HexGridWorkflowState::Error);
+		return;
+	}
+
+	UE_LOG(HexGridCreator, Log, TEXT("Merge %d shards done in %.2f seconds."), MergeShardCount, GetStageSeconds());
+	ScheduleWorkflow(GetNextStage(Enum_HexGridWorkflowState::ShardMerge));
+}
+
+void AHexGridCreator::GetShardFiles(TArray<FString>& Out_FullPaths, TArray<FStructHexShardFile>& Out_Files)
+{
+	//Shards split exactly the files of the pipeline
+	TArray<FStructPipelineFile> PipelineFiles;
+	TArray<FString> RelPaths;
+	GetPipelineFiles(PipelineFiles, RelPaths);
+	Out_FullPaths.Empty();
+	Out_Files.Empty();
+	for (int32 i = 0; i < PipelineFiles.Num(); i++)
+	{
+		Out_FullPaths.Add(PipelineFiles[i].FullPath);
+		FStructHexShardFile& File = Out_Files.AddDefaulted_GetRef();
+		File.RelPath = RelPaths[i];
+		File.TileCount = PipelineFiles[i].TileCount;
+	}
+}
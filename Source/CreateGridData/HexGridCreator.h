@@ -3,8 +3,15 @@
 #pragma once
 
 #include "StructDefine.h"
+#include "FlowControlUtility.h"
+#include "GridMaskUtility.h"
+#include "GridShardUtility.h"
+#include "HexGridDataAsset.h"
+#include "HexGridPipeline.h"
+#include "HexMath.h"
 
 #include "CoreMinimal.h"
+#include "Async/Future.h"
 #include "GameFramework/Actor.h"
 #include "HexGridCreator.generated.h"
 
@@ -21,10 +28,30 @@ enum class Enum_HexGridWorkflowState : uint8
 	WriteTileIndices,
 	WriteParams,
 	Done,
-	Error
+	Error,
+	//Create and write stages running on worker threads, see FHexGridPipeline
+	Pipeline,
+	//Optional stages after the text outputs, each built on a worker thread
+	DualGraph,
+	LosStencil,
+	Hpa,
+	Binary,
+	Attributes,
+	BulkAsset,
+	FlowField,
+	//Multi process runs, see GridShardUtility
+	ShardManifest,
+	ShardMerge
 };
 
-#define RING_START_DIRECTION_INDEX	4
+UENUM(BlueprintType)
+enum class Enum_HexGridBudgetPolicy : uint8
+{
+	Abort,
+	LowMemoryMode
+};
+
+#define CHECKPOINT_VERSION	2
 
 UCLASS()
 class CREATEGRIDDATA_API AHexGridCreator : public AActor
@@ -54,17 +81,28 @@ private:
 	//delegate
 	FTimerDynamicDelegate WorkflowDelegate;
 
-	TArray<FStructHexTileData> Tiles;
-	TMap<FIntPoint, int32> TileIndices;
+	TArray64<FStructHexTileData> Tiles;
 
-	//Flag for spiral ring
-	bool RingInitFlag = false;
+	//Variants written by this run, a single one made of the params when not in batch mode
+	TArray<FStructHexGridVariant> Variants;
+	//GridRange and NeighborRange as set by the user, a batch run replaces them by the shared ranges until it ends
+	bool HasSavedParams = false;
+	int32 SavedGridRange = 0;
+	int32 SavedNeighborRange = 0;
 
-	TArray<FIntPoint> AxialDirectionVectors;
+	//Neighbor rings around the origin, translated per tile in low memory mode
+	TArray<FStructHexTileNeighbors> RingOffsets;
+
+	//Mask, tiles outside it are skipped and the rest numbered compactly in spiral order
+	FStructHexGridMask Mask;
+	TArray<int64> MaskRingEnds;
+	//Part of the grid signature, 0 without a mask
+	uint32 MaskCrc = 0;
+	//Masked in tiles in spiral order, kept in low memory mode only
+	TArray64<FIntPoint> MaskedTiles;
 
 	//Save temp data for SpiralCreateCenter and SpiralCreateNeighbors
-	FVector2D TmpPosition2D;
-	FIntPoint TmpHex;
+	HexMath::FAxial TmpHex;
 
 	//Temp data for create vertices
 	TArray<FVector> OuterVectors;
@@ -73,6 +111,32 @@ private:
 	//Temp data for create triangles
 	TArray<int32> TriArr0, TriArr1, TriArr2, TriArr3;
 
+	//Checkpoint
+	double LastCheckpointTime = 0.0;
+	//Write state of a restored checkpoint, reached once the spiral stages generated the tiles again
+	bool ResumePending = false;
+	Enum_HexGridWorkflowState ResumeState = Enum_HexGridWorkflowState::WriteTiles;
+	int64 ResumeProgressCurrent = 0;
+	int64 ResumeProgressTarget = 0;
+
+	//Calibration
+	bool MeasureRates = true;
+	double StageStartTime = 0.0;
+	double WriteStartTime = 0.0;
+
+	//Command line
+	bool ExitWhenDone = false;
+
+	//Shard, -Shard=i/N writes one part of every text output, -MergeShards=N joins the parts of N shards
+	FString ShardParam;
+	FStructHexGridShard Shard;
+	int32 MergeShardCount = 0;
+
+	TUniquePtr<FHexGridPipeline> Pipeline;
+
+	//Worker thread of the running optional stage
+	TFuture<bool> StageTask;
+
 protected:
 	//Params
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Custom|Params", meta = (ClampMin = "0.0"))
@@ -84,6 +148,10 @@ protected:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Custom|Params", meta = (ClampMin = "1"))
 		int32 NeighborRange = 5;
 
+	//Batch, when not empty the topology is generated once for the largest variant and every variant is written from it
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Custom|Batch")
+		TArray<FStructHexGridVariant> BatchVariants;
+
 	//Path
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Custom|Path")
 		FString TilesDataPath = FString(TEXT("Data/Tiles.data"));
@@ -95,9 +163,125 @@ protected:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Custom|Path")
 		FString ParamsDataPath = FString(TEXT("Data/Params.data"));
 
-	//Timer
-	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Custom|Timer")
-		float DefaultTimerRate = 0.01f;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Custom|Path")
+		FString CheckpointDataPath = FString(TEXT("Data/Checkpoint.data"));
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Custom|Path")
+		FString DualGraphDataPath = FString(TEXT("Data/DualGraph.data"));
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Custom|Path")
+		FString LosStencilDataPath = FString(TEXT("Data/LosStencil.data"));
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Custom|Path")
+		FString HpaGraphDataPath = FString(TEXT("Data/HpaGraph.data"));
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Custom|Path")
+		FString AttributesDataPath = FString(TEXT("Data/Attributes.bin"));
+
+	//Every source group writes FlowField_<Name>.bin in this directory
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Custom|Path")
+		FString FlowFieldDataPath = FString(TEXT("Data/FlowField.bin"));
+
+	//Long package name of the bulk data asset, batch variants append the name of their data directory
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Custom|Path")
+		FString BulkAssetPackage = FString(TEXT("/Game/HexGrid/HexGridData"));
+
+	//Every shard writes its manifest here with a .shard-i-of-N suffix, like its parts of the outputs
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Custom|Path")
+		FString ShardManifestPath = FString(TEXT("Data/Shard.manifest"));
+
+	//Mask image in axial space, relative to the project directory. Empty generates the full hexagon, see GridMaskUtility
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Custom|Mask")
+		FString MaskPath;
+
+	//Gray value from which a pixel is masked in, .pbm masks ignore it
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Custom|Mask", meta = (ClampMin = "0", ClampMax = "255"))
+		int32 MaskThreshold = 128;
+
+	//Topology, corner and edge ids with their adjacency in binary form, see GridDualGraphUtility
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Custom|Topology")
+		bool EnableDualGraph = false;
+
+	//Line of sight to every offset within NeighborRange, shared by all variants, see GridLosUtility
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Custom|Topology")
+		bool EnableLosStencil = false;
+
+	//Fixed width .bin twins of Tiles.data and every N{r}.data, written through mapped files, see GridBinaryUtility
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Custom|Topology")
+		bool EnableBinaryOutputs = false;
+
+	//Noise channels per tile as float columns indexed by tile index, see GridNoiseUtility
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Custom|Attributes")
+		bool EnableAttributes = false;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Custom|Attributes")
+		TArray<FStructHexNoiseChannel> AttributeChannels;
+
+	//Tiles, tile indices and neighbors as a UHexGridDataAsset that cooks into the game's containers, editor only
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Custom|Asset")
+		bool EnableBulkAsset = false;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Custom|Asset")
+		Enum_HexGridBulkLoadMode BulkLoadMode = Enum_HexGridBulkLoadMode::Inline;
+
+	//HPA* abstract graph built from the written Tiles.data of every variant, see GridHpaUtility
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Custom|Pathfinding")
+		bool EnableHpa = false;
+
+	//Radius of the super hex clusters
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Custom|Pathfinding", meta = (ClampMin = "1"))
+		int32 HpaClusterRadius = 8;
+
+	//Distance and direction fields towards every group of FlowFieldSources, see GridFlowFieldUtility
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Custom|Pathfinding")
+		bool EnableFlowFields = false;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Custom|Pathfinding")
+		TArray<FStructHexFlowFieldSources> FlowFieldSources;
+
+	//Raw cost per tile index, paid on leaving the tile, one byte each with 0 for impassable, relative to the project directory and
+	//resolved per variant like the outputs. Empty costs 1 everywhere
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Custom|Pathfinding")
+		FString FlowFieldCostsPath;
+
+	//Checkpoint
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Custom|Checkpoint")
+		bool EnableCheckpoint = true;
+
+	//Seconds between two checkpoints
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Custom|Checkpoint", meta = (ClampMin = "1.0"))
+		float CheckpointInterval = 30.0f;
+
+	//Pipeline, overlaps tile generation, formatting and file writing on worker threads, no checkpoints are written
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Custom|Pipeline")
+		bool EnablePipeline = false;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Custom|Pipeline")
+		FStructHexGridPipelineSettings PipelineSettings;
+
+	//Budget, a limit of 0 means unlimited
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Custom|Budget", meta = (ClampMin = "0"))
+		int32 MaxMemoryMB = 0;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Custom|Budget", meta = (ClampMin = "0"))
+		int32 MaxDiskMB = 0;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Custom|Budget")
+		Enum_HexGridBudgetPolicy OverBudgetPolicy = Enum_HexGridBudgetPolicy::Abort;
+
+	//Skip SpiralCreateNeighbors and build neighbor lines from ring offsets while writing
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Custom|Budget")
+		bool LowMemoryMode = false;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Custom|Budget")
+		FStructHexGridBenchmarkRates BenchmarkRates;
+
+	UPROPERTY(BlueprintReadOnly)
+		FStructHexGridEstimate FootprintEstimate;
+
+	//Rates of the last run, copy them to BenchmarkRates to calibrate the estimate
+	UPROPERTY(BlueprintReadOnly)
+		FStructHexGridBenchmarkRates MeasuredRates;
 
 	//Loop BP
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Custom|Loop")
@@ -117,18 +301,25 @@ protected:
 
 
 	UPROPERTY(BlueprintReadOnly)
-		int32 ProgressTarget = 0;
+		int64 ProgressTarget = 0;
 	UPROPERTY(BlueprintReadOnly)
-		int32 ProgressCurrent = 0;
+		int64 ProgressCurrent = 0;
 
 private:
 	//Timer delegate
 	void BindDelegate();
+	void ApplyCommandLineParams();
 
 	//Init
 	void InitDirection();
 	void InitTileParams();
 	void InitLoopData();
+	bool InitVariants();
+	bool CheckGridRange();
+	void RestoreParams();
+	bool InitMask();
+	bool InitShard();
+	void ScheduleWorkflow(Enum_HexGridWorkflowState State);
 
 	//Workflow
 	UFUNCTION()
@@ -136,69 +327,140 @@ private:
 
 	//Init workflow
 	void InitWorkflow();
+	void InitRingOffsets();
 
-	//Hex axial coordinate function
-	void InitAxialDirections();
-	FIntPoint AxialAdd(const FIntPoint& Hex, const FIntPoint& Vec);
-	FIntPoint AxialDirection(const int32 Direction);
-	FIntPoint AxialNeighbor(const FIntPoint& Hex, const int32 Direction);
-	FIntPoint AxialScale(const FIntPoint& Hex, const int32 Factor);
+	//Budget
+	bool CheckFootprintBudget();
+	//Estimate of a run over InVariants, reads the params but changes nothing
+	void ComputeFootprint(const TArray<FStructHexGridVariant>& InVariants, int32 InGridRange, int32 InNeighborRange, bool InLowMemoryMode,
+		FStructHexGridEstimate& Out_Estimate);
+	double GetStageSeconds();
+	int64 GetWrittenBytes();
 
 	void ResetProgress();
 
+	//Batch
+	int64 GetTileCount(int32 Range);
+	int64 GetVariantsTileCount();
+	//Variants of the params and the ranges generated for them, false when two variants would write the same files
+	bool GetVariants(TArray<FStructHexGridVariant>& Out_Variants, int32& Out_GridRange, int32& Out_NeighborRange);
+	void ResolveVariantPath(const FString& RelPath, int32 VariantIndex, FString& Out_Path);
+	void ResolveVariantPath(const FString& RelPath, const FStructHexGridVariant& Variant, FString& Out_Path);
+	void GetParamsSignature(FString& Out_Str);
+	//Params that shape the outputs, the signature without the run mode
+	void GetGridSignature(FString& Out_Str);
+	FIntPoint GetTileAxial(int64 Index);
+	bool IsTileInGrid(const FIntPoint& Hex, int32 Range);
+
 	//Create center
 	void InitGridCenter();
 	void SpiralCreateCenter();
+	void InitCenterRing(int32 Radius);
 	void AddRingTileAndIndex();
 	void FindNeighborTileOfRing(int32 DirIndex);
 
 	//Create neighbors
 	void SpiralCreateNeighbors();
-	void AddTileNeighbor(int32 TileIndex, int32 Radius);
-	void SetTileNeighbor(int32 TileIndex, int32 Radius, int32 DirIndex);
+	void InitNeighborRing(int64 TileIndex, int32 Radius);
+	void AddTileNeighbor(int64 TileIndex, int32 Radius);
+	void SetTileNeighbor(int64 TileIndex, int32 Radius, int32 DirIndex);
 
 	//For write data
 	void CreateFilePath(const FString& RelPath, FString& FullPath);
+	bool OpenOutputFile(std::ofstream& ofs, const FString& RelPath, bool Append);
+	Enum_LoopResult WriteVariantLines(FStructLoopData& LoopData, const FString& RelPath,
+		TFunctionRef<void(std::ofstream& ofs, int32 VariantIndex, int64 TileIndex)> WriteLine);
 	void WritePipeDelimiter(std::ofstream& ofs);
 	void WriteColonDelimiter(std::ofstream& ofs);
 	void WriteLineEnd(std::ofstream& ofs);
 
 	//Write hex tiles data to file
 	void WriteTilesToFile();
-	void WriteTiles(std::ofstream& ofs);
-	void WriteTileLine(std::ofstream& ofs, int32 Index);
-	void WriteIndices(std::ofstream& ofs, int32 Index);
+	void WriteTileLine(std::ofstream& ofs, int64 Index, float Size);
+	void WriteIndices(std::ofstream& ofs, int64 Index);
 	void WriteAxialCoord(std::ofstream& ofs, const FStructHexTileData& Data);
-	void WritePosition2D(std::ofstream& ofs, const FStructHexTileData& Data);
+	void WritePosition2D(std::ofstream& ofs, const FVector2D& Pos2D);
 	//void WriteNeighbors(std::ofstream& ofs, const FStructHexTileData& Data);
 	//void WriteNeighborsInfo(std::ofstream& ofs, const FStructHexTileNeighbors& Neighbors);
 
 	//Write neighbors to file
 	void WriteNeighborsToFile();
 	void CreateNeighborPath(FString& NeighborPath, int32 Radius);
-	int32 CalNeighborsWeight(int32 Range);
-	bool WriteNeighbors(std::ofstream& ofs, int32 Radius);
-	void WriteNeighborLine(std::ofstream& ofs, int32 Index, int32 Radius);
+	int64 CalNeighborsWeight(int32 Range);
+	Enum_LoopResult WriteNeighbors();
+	void WriteNeighborLine(std::ofstream& ofs, int64 Index, int32 Radius, int32 Range);
 
 	//Write tile indices data to file
 	void WriteTileIndicesToFile();
-	void WriteTileIndices(std::ofstream& ofs);
-	void WriteTileIndicesLine(std::ofstream& ofs, int32 Index);
+	void WriteTileIndicesLine(std::ofstream& ofs, int64 Index);
 	void WriteIndicesKey(std::ofstream& ofs, const FIntPoint& key);
-	void WriteIndicesValue(std::ofstream& ofs, int32 Index);
+	void WriteIndicesValue(std::ofstream& ofs, int64 Index);
 
 	//Write info data to file
 	void WriteParamsToFile();
-	void WriteParams(std::ofstream& ofs);
-	void WriteParamsContent(std::ofstream& ofs);
+	void WriteParamsContent(std::ofstream& ofs, const FStructHexGridVariant& Variant);
+
+	//Checkpoint
+	void GetLoopDataList(TArray<FStructLoopData*>& Out_List);
+	bool GetActiveOutputPath(FString& Out_RelPath);
+	void UpdateCheckpoint();
+	void WriteCheckpointToFile();
+	void WriteCheckpointContent(std::ofstream& ofs);
+	bool RestoreFromCheckpoint();
+	bool ReadCheckpointLines(TArray<FString>& Out_Lines);
+	bool RestoreOutputFile(const FString& Line);
+	void RemoveCheckpoint();
+
+	//Pipeline
+	void StartPipeline();
+	void PollPipeline();
+	void GetPipelineFiles(TArray<FStructPipelineFile>& Out_Files, TArray<FString>& Out_RelPaths);
+	void AddPipelineFile(TArray<FStructPipelineFile>& Out_Files, TArray<FString>& Out_RelPaths, const FString& RelPath,
+		int32 VariantIndex, Enum_PipelineOutput Type, int32 Radius);
+
+	//Shard
+	void WriteShardManifest();
+	void MergeShards();
+	void GetShardFiles(TArray<FString>& Out_FullPaths, TArray<FStructHexShardFile>& Out_Files);
+
+	//Optional stages
+	Enum_HexGridWorkflowState GetNextStage(Enum_HexGridWorkflowState Finished);
+	void StartStageTask(TFunction<bool()>&& Task);
+	//Returns true once the task finished, reschedules the workflow until then
+	bool PollStageTask(bool& Out_Succeeded);
+	void BuildDualGraph();
+	void BuildLosStencil();
+	void BuildHpaGraph();
+	void WriteBinaryOutputs();
+	void WriteAttributes();
+	void BuildBulkAssets();
+	void BuildFlowFields();
+	void ResolveFlowFieldPath(FName GroupName, const FStructHexGridVariant& Variant, FString& Out_Path);
+	void ResolveVariantPackage(const FStructHexGridVariant& Variant, FString& Out_PackageName);
+
+	//Payloads are built by the stage task, the assets are saved on the game thread
+	struct FBulkAssetJob
+	{
+		FStructHexGridVariant Variant;
+		FString PackageName;
+		TArray<int64> RingEnds;
+		int64 TileCount = 0;
+		TArray64<uint8> Payload;
+		TArray<FStructHexGridBulkSection> Sections;
+	};
+	TSharedPtr<TArray<FBulkAssetJob>> BulkAssetJobs;
 
 protected:
 	// Called when the game starts or when spawned
 	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 
 	UFUNCTION(BlueprintCallable)
 	void GetProgress(float& Out_Progress);
 
+	UFUNCTION(BlueprintCallable)
+	void EstimateFootprint(FStructHexGridEstimate& Out_Estimate);
+
 public:	
 	// Called every frame
 	virtual void Tick(float DeltaTime) override;
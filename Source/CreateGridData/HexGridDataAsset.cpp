@@ -0,0 +1,152 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "HexGridDataAsset.h"
+#include "GridBinaryUtility.h"
+#include "GridDataLoader.h"
+
+#if WITH_EDITOR
+#include <Misc/PackageName.h>
+#include <UObject/Package.h>
+#include <UObject/SavePackage.h>
+#endif
+
+DEFINE_LOG_CATEGORY(HexGridAsset);
+
+void UHexGridDataAsset::Serialize(FArchive& Ar)
+{
+	Super::Serialize(Ar);
+	//Tagged properties come first, so LoadMode is known when the payload is reached
+	Payload.Serialize(Ar, this, LoadMode == Enum_HexGridBulkLoadMode::MemoryMapped);
+}
+
+#if WITH_EDITOR
+bool UHexGridDataAsset::SaveAsset(const FString& PackageName, const FStructHexGridVariant& Variant, int64 InTileCount, Enum_HexGridBulkLoadMode Mode,
+	const TArray64<uint8>& InPayload, const TArray<FStructHexGridBulkSection>& InSections)
+{
+	FText Reason;
+	if (!FPackageName::IsValidLongPackageName(PackageName, false, &Reason)) {
+		UE_LOG(HexGridAsset, Warning, TEXT("%s is no valid package name: %s"), *PackageName, *Reason.ToString());
+		return false;
+	}
+	UPackage* Package = CreatePackage(*PackageName);
+	Package->FullyLoad();
+	FString AssetName = FPackageName::GetShortName(PackageName);
+	UHexGridDataAsset* Asset = FindObject<UHexGridDataAsset>(Package, *AssetName);
+	if (Asset == nullptr) {
+		Asset = NewObject<UHexGridDataAsset>(Package, FName(*AssetName), RF_Public | RF_Standalone);
+	}
+	Asset->GridRange = Variant.GridRange;
+	Asset->TileSize = Variant.TileSize;
+	Asset->NeighborRange = Variant.NeighborRange;
+	Asset->TileCount = InTileCount;
+	Asset->LoadMode = Mode;
+	Asset->Sections = InSections;
+
+	//Inline keeps the payload in the package, the other modes in a bulk file of its own that the cook aligns for mapping
+	Asset->Payload.ClearBulkDataFlags(BULKDATA_ForceInlinePayload | BULKDATA_Force_NOT_InlinePayload | BULKDATA_MemoryMappedPayload);
+	uint32 Flags = Mode == Enum_HexGridBulkLoadMode::Inline ? BULKDATA_ForceInlinePayload : BULKDATA_Force_NOT_InlinePayload;
+	if (Mode == Enum_HexGridBulkLoadMode::MemoryMapped) {
+		Flags |= BULKDATA_MemoryMappedPayload;
+	}
+	Asset->Payload.SetBulkDataFlags(Flags);
+	Asset->Payload.Lock(LOCK_READ_WRITE);
+	FMemory::Memcpy(Asset->Payload.Realloc(InPayload.Num()), InPayload.GetData(), InPayload.Num());
+	Asset->Payload.Unlock();
+	Asset->MarkPackageDirty();
+
+	FString FileName = FPackageName::LongPackageNameToFilename(PackageName, FPackageName::GetAssetPackageExtension());
+	FSavePackageArgs SaveArgs;
+	SaveArgs.TopLevelFlags = RF_Public | RF_Standalone;
+	if (!UPackage::SavePackage(Package, Asset, *FileName, SaveArgs)) {
+		UE_LOG(HexGridAsset, Warning, TEXT("Save package %s failed!"), *FileName);
+		return false;
+	}
+	return true;
+}
+#endif
+
+const FStructHexGridBulkSection* UHexGridDataAsset::FindSection(FName Name) const
+{
+	return Sections.FindByPredicate([Name](const FStructHexGridBulkSection& Section) { return Section.Name == Name; });
+}
+
+bool UHexGridDataAsset::LoadTables(FStructHexTilesTable& Out_Tiles, FStructHexTileIndicesTable& Out_TileIndices,
+	TArray<FStructHexNeighborTable>& Out_Neighbors)
+{
+	//Tiles, TileIndices, then one section per radius
+	const int64 Bytes = Payload.GetBulkDataSize();
+	if (Sections.Num() != NeighborRange + 2 || Sections.ContainsByPredicate([Bytes](const FStructHexGridBulkSection& Section) {
+		return Section.Offset < 0 || Section.Bytes < 0 || Section.Offset + Section.Bytes > Bytes;
+	})) {
+		UE_LOG(HexGridAsset, Warning, TEXT("Sections of %s do not match its payload of %lld bytes."), *GetPathName(), Bytes);
+		return false;
+	}
+
+	TArray<const uint8*> SectionData;
+	if (LoadMode != Enum_HexGridBulkLoadMode::Streamed) {
+		const uint8* Data = static_cast<const uint8*>(Payload.LockReadOnly());
+		if (Data == nullptr) {
+			Payload.Unlock();
+			UE_LOG(HexGridAsset, Warning, TEXT("Loading the payload of %s failed!"), *GetPathName());
+			return false;
+		}
+		for (const FStructHexGridBulkSection& Section : Sections)
+		{
+			SectionData.Add(Data + Section.Offset);
+		}
+		bool Decoded = DecodeSections(SectionData, Out_Tiles, Out_TileIndices, Out_Neighbors);
+		Payload.Unlock();
+		return Decoded;
+	}
+
+	TArray<IBulkDataIORequest*> Requests;
+	for (const FStructHexGridBulkSection& Section : Sections)
+	{
+		Requests.Add(StreamSection(Section.Name, nullptr));
+	}
+	bool Read = true;
+	for (IBulkDataIORequest* Request : Requests)
+	{
+		//A request that failed completes without results
+		SectionData.Add(Request != nullptr && Request->WaitCompletion() ? Request->GetReadResults() : nullptr);
+		Read &= SectionData.Last() != nullptr;
+	}
+	if (!Read) {
+		UE_LOG(HexGridAsset, Warning, TEXT("Streaming the payload of %s failed!"), *GetPathName());
+	}
+	bool Decoded = Read && DecodeSections(SectionData, Out_Tiles, Out_TileIndices, Out_Neighbors);
+	for (int32 i = 0; i < Requests.Num(); i++)
+	{
+		FMemory::Free(const_cast<uint8*>(SectionData[i]));
+		delete Requests[i];
+	}
+	return Decoded;
+}
+
+IBulkDataIORequest* UHexGridDataAsset::StreamSection(FName Name, FBulkDataIORequestCallBack* OnDone) const
+{
+	const FStructHexGridBulkSection* Section = FindSection(Name);
+	if (Section == nullptr || Section->Offset + Section->Bytes > Payload.GetBulkDataSize()) {
+		UE_LOG(HexGridAsset, Warning, TEXT("%s has no section %s."), *GetPathName(), *Name.ToString());
+		return nullptr;
+	}
+	return Payload.CreateStreamingRequest(Section->Offset, Section->Bytes, AIOP_Normal, OnDone, nullptr);
+}
+
+bool UHexGridDataAsset::DecodeSections(const TArray<const uint8*>& SectionData, FStructHexTilesTable& Out_Tiles,
+	FStructHexTileIndicesTable& Out_TileIndices, TArray<FStructHexNeighborTable>& Out_Neighbors) const
+{
+	if (!GridBinaryUtility::ReadTiles(SectionData[0], Sections[0].Bytes, Out_Tiles)
+		|| !GridBinaryUtility::ReadTileIndices(SectionData[1], Sections[1].Bytes, Out_TileIndices)) {
+		return false;
+	}
+	Out_Neighbors.SetNum(NeighborRange);
+	for (int32 Radius = 1; Radius <= NeighborRange; Radius++)
+	{
+		if (!GridBinaryUtility::ReadNeighbors(SectionData[Radius + 1], Sections[Radius + 1].Bytes, Out_Tiles.AxialCoords, Out_Neighbors[Radius - 1])) {
+			return false;
+		}
+	}
+	return true;
+}
@@ -0,0 +1,83 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "StructDefine.h"
+
+#include "CoreMinimal.h"
+#include "Engine/DataAsset.h"
+#include "Serialization/BulkData.h"
+#include "HexGridDataAsset.generated.h"
+
+DECLARE_LOG_CATEGORY_EXTERN(HexGridAsset, Log, All);
+
+struct FStructHexTilesTable;
+struct FStructHexTileIndicesTable;
+struct FStructHexNeighborTable;
+
+UENUM(BlueprintType)
+enum class Enum_HexGridBulkLoadMode : uint8
+{
+	//Payload is stored in the package and loaded with the asset
+	Inline,
+	//Payload is stored next to the package and read on request with async IO
+	Streamed,
+	//Like Streamed, the payload is mapped when the asset loads where the platform and container allow it
+	MemoryMapped
+};
+
+/**
+ * Grid outputs as a cookable asset. Tiles, TileIndices and N1 .. N{NeighborRange} are laid out as by
+ * GridBinaryUtility::BuildPayload in one FByteBulkData, so they cook into pak and IoStore containers and
+ * load through the engine's IO instead of being shipped and parsed as loose text files.
+ */
+UCLASS(BlueprintType)
+class CREATEGRIDDATA_API UHexGridDataAsset : public UDataAsset
+{
+	GENERATED_BODY()
+
+public:
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Grid")
+		int32 GridRange = 0;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Grid")
+		float TileSize = 0.0f;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Grid")
+		int32 NeighborRange = 0;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Grid")
+		int64 TileCount = 0;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Payload")
+		Enum_HexGridBulkLoadMode LoadMode = Enum_HexGridBulkLoadMode::Inline;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Payload")
+		TArray<FStructHexGridBulkSection> Sections;
+
+	virtual void Serialize(FArchive& Ar) override;
+
+#if WITH_EDITOR
+	//Creates or replaces the asset of PackageName with the payload of GridBinaryUtility::BuildPayload and saves its package
+	static bool SaveAsset(const FString& PackageName, const FStructHexGridVariant& Variant, int64 InTileCount, Enum_HexGridBulkLoadMode Mode,
+		const TArray64<uint8>& InPayload, const TArray<FStructHexGridBulkSection>& InSections);
+#endif
+
+	const FStructHexGridBulkSection* FindSection(FName Name) const;
+	int64 GetPayloadBytes() const { return Payload.GetBulkDataSize(); }
+	bool IsPayloadMapped() const { return Payload.IsDataMemoryMapped(); }
+
+	//Every section into the tables of GridDataLoader. Inline and mapped payloads are read in place,
+	//a streamed payload is read with one async request per section, all in flight at once
+	bool LoadTables(FStructHexTilesTable& Out_Tiles, FStructHexTileIndicesTable& Out_TileIndices, TArray<FStructHexNeighborTable>& Out_Neighbors);
+
+	//Async read of one section, for code that only needs a part of the payload. The caller deletes the request
+	//once it completed, its GetReadResults() memory is the caller's to free with FMemory::Free
+	IBulkDataIORequest* StreamSection(FName Name, FBulkDataIORequestCallBack* OnDone) const;
+
+private:
+	FByteBulkData Payload;
+
+	bool DecodeSections(const TArray<const uint8*>& SectionData, FStructHexTilesTable& Out_Tiles, FStructHexTileIndicesTable& Out_TileIndices,
+		TArray<FStructHexNeighborTable>& Out_Neighbors) const;
+};
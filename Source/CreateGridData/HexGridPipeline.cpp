@@ -0,0 +1,412 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "HexGridPipeline.h"
+#include "GridMaskUtility.h"
+#include "GridTextUtility.h"
+#include "HexMath.h"
+
+#include <HAL/Event.h>
+#include <HAL/Runnable.h>
+#include <HAL/RunnableThread.h>
+#include <Misc/ScopeLock.h>
+
+#include <fstream>
+#include <filesystem>
+
+DEFINE_LOG_CATEGORY(HexGridPipeline);
+
+class FPipelineRunnable : public FRunnable
+{
+public:
+	FPipelineRunnable(TFunction<void()>&& InBody) : Body(MoveTemp(InBody)) {}
+
+	virtual uint32 Run() override
+	{
+		Body();
+		return 0;
+	}
+
+private:
+	TFunction<void()> Body;
+};
+
+FHexGridPipeline::FHexGridPipeline(const FStructHexGridPipelineSettings& InSettings, const TArray<FStructPipelineFile>& InFiles,
+	const FStructHexGridMask* InMask, int64 InTileBegin, int64 InTileEnd)
+	: Settings(InSettings), Files(InFiles), Mask(InMask)
+{
+	Settings.BatchTiles = FMath::Max(Settings.BatchTiles, 64);
+	Settings.MaxBatchesInFlight = FMath::Max(Settings.MaxBatchesInFlight, 1);
+
+	int32 NeighborRange = 0;
+	int64 TileCount = 0;
+	for (const FStructPipelineFile& File : Files)
+	{
+		TileCount = FMath::Max(TileCount, File.TileCount);
+		NeighborRange = FMath::Max(NeighborRange, File.Radius);
+	}
+	TileEnd = FMath::Min(InTileEnd, TileCount);
+	TileBegin = FMath::Clamp<int64>(InTileBegin, 0, TileEnd);
+	BatchCount = (TileEnd - TileBegin + Settings.BatchTiles - 1) / Settings.BatchTiles;
+	WriterCount = FMath::Clamp(Settings.WriterThreads, 1, FMath::Max(Files.Num(), 1));
+
+	//Same ring order as InitRingOffsets
+	for (int32 Radius = 1; Radius <= NeighborRange; Radius++)
+	{
+		TArray<FIntPoint>& Ring = RingOffsets.AddDefaulted_GetRef();
+		for (const HexMath::FAxial& Hex : HexMath::Ring(HexMath::FAxial(), Radius))
+		{
+			Ring.Add(Hex.ToIntPoint());
+		}
+	}
+}
+
+FHexGridPipeline::~FHexGridPipeline()
+{
+	Cancel();
+	FBatch* Batch;
+	while (FormatQueue.Dequeue(Batch)) {
+		delete Batch;
+	}
+	for (const TPair<int64, FBatch*>& Pair : FormattedBatches)
+	{
+		delete Pair.Value;
+	}
+	for (TArray<FEvent*>* Events : { &ProducerEvents, &FormatEvents, &WriterEvents })
+	{
+		for (FEvent* Event : *Events)
+		{
+			FPlatformProcess::ReturnSynchEventToPool(Event);
+		}
+		Events->Empty();
+	}
+}
+
+void FHexGridPipeline::Start()
+{
+	int32 FormatCount = Settings.FormatThreads > 0 ? Settings.FormatThreads
+		: FMath::Max(1, FPlatformMisc::NumberOfWorkerThreadsToSpawn() - WriterCount);
+	//All events exist before the first thread may notify them
+	ProducerEvents.Add(FPlatformProcess::GetSynchEventFromPool(false));
+	for (int32 i = 0; i < FormatCount; i++)
+	{
+		FormatEvents.Add(FPlatformProcess::GetSynchEventFromPool(false));
+	}
+	for (int32 i = 0; i < WriterCount; i++)
+	{
+		WriterEvents.Add(FPlatformProcess::GetSynchEventFromPool(false));
+	}
+
+	AddThread(TEXT("HexGridProducer"), [this]() { ProduceBatches(); });
+	for (int32 i = 0; i < FormatCount; i++)
+	{
+		AddThread(*FString::Printf(TEXT("HexGridFormat%d"), i), [this, i]() { FormatBatches(i); });
+	}
+	for (int32 i = 0; i < WriterCount; i++)
+	{
+		AddThread(*FString::Printf(TEXT("HexGridWriter%d"), i), [this, i]() { WriteBatches(i); });
+	}
+	UE_LOG(HexGridPipeline, Log, TEXT("Pipeline of tiles %lld .. %lld in %lld batches, %d format and %d writer threads."),
+		TileBegin, TileEnd - 1, BatchCount, FormatCount, WriterCount);
+}
+
+void FHexGridPipeline::Cancel()
+{
+	{
+		FScopeLock Lock(&Mutex);
+		Cancelled = true;
+	}
+	NotifyAll();
+
+	for (TUniquePtr<FRunnableThread>& Thread : Threads)
+	{
+		Thread->WaitForCompletion();
+	}
+	Threads.Empty();
+	Runnables.Empty();
+}
+
+bool FHexGridPipeline::IsFinished() const
+{
+	return RunningThreads == 0;
+}
+
+bool FHexGridPipeline::HasFailed() const
+{
+	return Failed;
+}
+
+int64 FHexGridPipeline::GetTileCount() const
+{
+	return TileEnd - TileBegin;
+}
+
+int64 FHexGridPipeline::GetTilesWritten() const
+{
+	return TilesWritten;
+}
+
+int64 FHexGridPipeline::GetBytesWritten() const
+{
+	return BytesWritten;
+}
+
+void FHexGridPipeline::ProduceBatches()
+{
+	//Same walk as SpiralCreateCenter. Without a mask a tile range starts at its first tile,
+	//with a mask it walks up to it, as masked out hexes take no index
+	HexMath::TSpiralIterator<int32> Spiral(HexMath::FAxial(), Mask == nullptr ? TileBegin : 0);
+	for (int64 Skipped = Spiral.GetIndex(); Skipped < TileBegin; ++Spiral)
+	{
+		if (Mask == nullptr || Mask->Contains((*Spiral).ToIntPoint())) {
+			Skipped++;
+		}
+	}
+	for (int64 Sequence = 0; Sequence < BatchCount; Sequence++)
+	{
+		bool Reserved = WaitUntil(ProducerEvents[0], [this]() {
+			if (BatchesInFlight >= Settings.MaxBatchesInFlight) {
+				return false;
+			}
+			BatchesInFlight++;
+			return true;
+		});
+		if (!Reserved) {
+			return;
+		}
+
+		FBatch* Batch = new FBatch();
+		Batch->Sequence = Sequence;
+		Batch->Begin = TileBegin + Sequence * Settings.BatchTiles;
+		int64 End = FMath::Min(Batch->Begin + Settings.BatchTiles, TileEnd);
+		Batch->Hexes.Reserve(End - Batch->Begin);
+		for (int64 i = Batch->Begin; i < End; i++)
+		{
+			//Masked out hexes take no index, the spiral runs ahead of the tile index
+			while (Mask != nullptr && !Mask->Contains((*Spiral).ToIntPoint())) {
+				++Spiral;
+			}
+			Batch->Hexes.Add((*Spiral).ToIntPoint());
+			++Spiral;
+		}
+
+		{
+			FScopeLock Lock(&Mutex);
+			FormatQueue.Enqueue(Batch);
+		}
+		Notify(FormatEvents);
+	}
+
+	{
+		FScopeLock Lock(&Mutex);
+		ProducerDone = true;
+	}
+	Notify(FormatEvents);
+}
+
+void FHexGridPipeline::FormatBatches(int32 FormatIndex)
+{
+	while (true) {
+		FBatch* Batch = nullptr;
+		bool Taken = WaitUntil(FormatEvents[FormatIndex], [this, &Batch]() { return FormatQueue.Dequeue(Batch) || ProducerDone; });
+		//No batch after the wait means the producer is done
+		if (!Taken || Batch == nullptr) {
+			return;
+		}
+
+		Batch->Buffers.SetNum(Files.Num());
+		for (int32 i = 0; i < Files.Num(); i++)
+		{
+			FormatFile(Files[i], *Batch, Batch->Buffers[i]);
+		}
+		Batch->PendingWriters = WriterCount;
+
+		{
+			FScopeLock Lock(&Mutex);
+			FormattedBatches.Add(Batch->Sequence, Batch);
+		}
+		Notify(WriterEvents);
+	}
+}
+
+void FHexGridPipeline::WriteBatches(int32 WriterIndex)
+{
+	//Files are dealt to the writers round robin, each writer appends its files in batch order
+	TArray<int32> FileIndices;
+	TArray<TUniquePtr<std::ofstream>> Streams;
+	for (int32 i = WriterIndex; i < Files.Num(); i += WriterCount)
+	{
+		TUniquePtr<std::ofstream>& ofs = Streams.Add_GetRef(MakeUnique<std::ofstream>());
+		ofs->open(std::filesystem::path(*Files[i].FullPath), std::ios::out | std::ios::trunc);
+		if (!ofs->is_open()) {
+			Fail(FString::Printf(TEXT("Open file %s failed!"), *Files[i].FullPath));
+			return;
+		}
+		FileIndices.Add(i);
+	}
+
+	for (int64 Sequence = 0; Sequence < BatchCount; Sequence++)
+	{
+		FBatch* Batch = nullptr;
+		bool Taken = WaitUntil(WriterEvents[WriterIndex], [this, Sequence, &Batch]() {
+			FBatch** Found = FormattedBatches.Find(Sequence);
+			Batch = Found != nullptr ? *Found : nullptr;
+			return Batch != nullptr;
+		});
+		if (!Taken) {
+			return;
+		}
+
+		for (int32 i = 0; i < FileIndices.Num(); i++)
+		{
+			//The lines are ASCII, the conversion copies them byte for byte
+			const FString& Buffer = Batch->Buffers[FileIndices[i]];
+			auto Ansi = StringCast<ANSICHAR>(*Buffer, Buffer.Len());
+			Streams[i]->write(Ansi.Get(), Ansi.Length());
+			if (!*Streams[i]) {
+				Fail(FString::Printf(TEXT("Write file %s failed!"), *Files[FileIndices[i]].FullPath));
+				return;
+			}
+			BytesWritten += Ansi.Length();
+		}
+		ReleaseBatch(Batch);
+	}
+
+	for (int32 i = 0; i < FileIndices.Num(); i++)
+	{
+		Streams[i]->close();
+		if (!*Streams[i]) {
+			Fail(FString::Printf(TEXT("Close file %s failed!"), *Files[FileIndices[i]].FullPath));
+			return;
+		}
+	}
+}
+
+void FHexGridPipeline::FormatFile(const FStructPipelineFile& File, const FBatch& Batch, FString& Out_Buffer)
+{
+	int64 End = FMath::Min(Batch.Begin + Batch.Hexes.Num(), File.TileCount);
+	for (int64 i = Batch.Begin; i < End; i++)
+	{
+		const FIntPoint& Hex = Batch.Hexes[i - Batch.Begin];
+		switch (File.Type)
+		{
+		case Enum_PipelineOutput::Tiles:
+		{
+			//Narrowed to float like the Conv_FloatToText argument
+			FVector2D Position = HexMath::AxialToPosition(Hex, File.TileSize);
+			GridTextUtility::AppendAxial(Out_Buffer, Hex);
+			Out_Buffer.AppendChar(TEXT('|'));
+			GridTextUtility::AppendFloat(Out_Buffer, (float)Position.X);
+			Out_Buffer.AppendChar(TEXT(','));
+			GridTextUtility::AppendFloat(Out_Buffer, (float)Position.Y);
+			break;
+		}
+		case Enum_PipelineOutput::TileIndices:
+			GridTextUtility::AppendAxial(Out_Buffer, Hex);
+			Out_Buffer.AppendChar(TEXT('|'));
+			GridTextUtility::AppendInt(Out_Buffer, i);
+			break;
+		case Enum_PipelineOutput::Neighbors:
+		{
+			const TArray<FIntPoint>& Ring = RingOffsets[File.Radius - 1];
+			bool First = true;
+			for (int32 j = 0; j < Ring.Num(); j++)
+			{
+				FIntPoint Neighbor = Hex + Ring[j];
+				if (Mask != nullptr && (HexMath::Length(HexMath::FAxial(Neighbor)) > File.GridRange || !Mask->Contains(Neighbor))) {
+					continue;
+				}
+				if (!First) {
+					Out_Buffer.AppendChar(TEXT(' '));
+				}
+				GridTextUtility::AppendAxial(Out_Buffer, Neighbor);
+				First = false;
+			}
+			break;
+		}
+		default:
+			break;
+		}
+		Out_Buffer.AppendChar(TEXT('\n'));
+	}
+}
+
+void FHexGridPipeline::ReleaseBatch(FBatch* Batch)
+{
+	bool Written;
+	{
+		FScopeLock Lock(&Mutex);
+		Written = --Batch->PendingWriters == 0;
+		if (Written) {
+			FormattedBatches.Remove(Batch->Sequence);
+			BatchesInFlight--;
+		}
+	}
+
+	if (Written) {
+		TilesWritten += Batch->Hexes.Num();
+		delete Batch;
+		Notify(ProducerEvents);
+	}
+}
+
+void FHexGridPipeline::Fail(const FString& Reason)
+{
+	UE_LOG(HexGridPipeline, Warning, TEXT("%s"), *Reason);
+	{
+		FScopeLock Lock(&Mutex);
+		Failed = true;
+		Cancelled = true;
+	}
+	NotifyAll();
+}
+
+bool FHexGridPipeline::WaitUntil(FEvent* Event, TFunctionRef<bool()> Ready)
+{
+	while (true) {
+		{
+			FScopeLock Lock(&Mutex);
+			if (Cancelled) {
+				return false;
+			}
+			if (Ready()) {
+				return true;
+			}
+		}
+		Event->Wait();
+	}
+}
+
+void FHexGridPipeline::Notify(const TArray<FEvent*>& Events)
+{
+	//Every waiter rechecks its own condition, a trigger without work is only a spurious wake up
+	for (FEvent* Event : Events)
+	{
+		Event->Trigger();
+	}
+}
+
+void FHexGridPipeline::NotifyAll()
+{
+	Notify(ProducerEvents);
+	Notify(FormatEvents);
+	Notify(WriterEvents);
+}
+
+void FHexGridPipeline::AddThread(const TCHAR* Name, TFunction<void()>&& Body)
+{
+	RunningThreads++;
+	FPipelineRunnable* Runnable = new FPipelineRunnable([this, Body = MoveTemp(Body)]() {
+		Body();
+		RunningThreads--;
+	});
+	Runnables.Emplace(Runnable);
+
+	FRunnableThread* Thread = FRunnableThread::Create(Runnable, Name);
+	if (Thread == nullptr) {
+		RunningThreads--;
+		Fail(FString::Printf(TEXT("Create thread %s failed!"), Name));
+		return;
+	}
+	Threads.Emplace(Thread);
+}
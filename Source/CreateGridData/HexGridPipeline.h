@@ -0,0 +1,115 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Containers/Queue.h"
+#include "HAL/CriticalSection.h"
+#include "StructDefine.h"
+
+#include <atomic>
+
+class FEvent;
+class FRunnable;
+class FRunnableThread;
+struct FStructHexGridMask;
+
+DECLARE_LOG_CATEGORY_EXTERN(HexGridPipeline, Log, All);
+
+enum class Enum_PipelineOutput : uint8
+{
+	Tiles,
+	TileIndices,
+	Neighbors
+};
+
+//One output file of the pipeline, holds the first TileCount tiles of the spiral
+struct FStructPipelineFile
+{
+	FString FullPath;
+	Enum_PipelineOutput Type = Enum_PipelineOutput::Tiles;
+	int64 TileCount = 0;
+	float TileSize = 0.0f;
+	int32 Radius = 0;
+	//Bounds the neighbors listed when the grid is masked
+	int32 GridRange = 0;
+};
+
+/**
+ * Producer/consumer pipeline writing the text outputs of AHexGridCreator on worker threads.
+ * A producer walks the spiral into batches of tiles, format workers turn every batch into the
+ * lines of all output files, writer threads append the formatted batches in spiral order.
+ * Batches in flight are bounded, so memory does not grow with the grid.
+ * With a mask the producer skips masked out hexes and neighbor lines list existing tiles only.
+ * A tile range limits every file to the tiles from TileBegin to TileEnd - 1, the part a shard writes.
+ */
+class CREATEGRIDDATA_API FHexGridPipeline
+{
+public:
+	FHexGridPipeline(const FStructHexGridPipelineSettings& InSettings, const TArray<FStructPipelineFile>& InFiles,
+		const FStructHexGridMask* InMask = nullptr, int64 InTileBegin = 0, int64 InTileEnd = MAX_int64);
+	~FHexGridPipeline();
+
+	void Start();
+	//Stops all threads and waits for them, safe to call more than once
+	void Cancel();
+
+	bool IsFinished() const;
+	bool HasFailed() const;
+	int64 GetTileCount() const;
+	int64 GetTilesWritten() const;
+	int64 GetBytesWritten() const;
+
+private:
+	struct FBatch
+	{
+		int64 Sequence = 0;
+		int64 Begin = 0;
+		TArray<FIntPoint> Hexes;
+		TArray<FString> Buffers;
+		int32 PendingWriters = 0;
+	};
+
+	void ProduceBatches();
+	void FormatBatches(int32 FormatIndex);
+	void WriteBatches(int32 WriterIndex);
+	void FormatFile(const FStructPipelineFile& File, const FBatch& Batch, FString& Out_Buffer);
+	//Runs Ready under the lock until it returns true, waiting on Event in between. False once cancelled
+	bool WaitUntil(FEvent* Event, TFunctionRef<bool()> Ready);
+	void Notify(const TArray<FEvent*>& Events);
+	void NotifyAll();
+	void ReleaseBatch(FBatch* Batch);
+	void Fail(const FString& Reason);
+	void AddThread(const TCHAR* Name, TFunction<void()>&& Body);
+
+	FStructHexGridPipelineSettings Settings;
+	TArray<FStructPipelineFile> Files;
+	//Owned by the caller, outlives the pipeline
+	const FStructHexGridMask* Mask = nullptr;
+	TArray<TArray<FIntPoint>> RingOffsets;
+	int64 TileBegin = 0;
+	int64 TileEnd = 0;
+	int64 BatchCount = 0;
+	int32 WriterCount = 1;
+
+	//Guards the queues below, batches are formatted and written outside the lock
+	FCriticalSection Mutex;
+	//One auto reset event per thread, a waiter checks its condition under the lock before it waits,
+	//so a trigger between the check and the wait is kept by the event and not lost
+	TArray<FEvent*> ProducerEvents;
+	TArray<FEvent*> FormatEvents;
+	TArray<FEvent*> WriterEvents;
+	TQueue<FBatch*> FormatQueue;
+	TMap<int64, FBatch*> FormattedBatches;
+	int32 BatchesInFlight = 0;
+	bool ProducerDone = false;
+
+	std::atomic<bool> Cancelled{ false };
+	std::atomic<bool> Failed{ false };
+	std::atomic<int32> RunningThreads{ 0 };
+	std::atomic<int64> TilesWritten{ 0 };
+	std::atomic<int64> BytesWritten{ 0 };
+
+	TArray<TUniquePtr<FRunnable>> Runnables;
+	TArray<TUniquePtr<FRunnableThread>> Threads;
+};
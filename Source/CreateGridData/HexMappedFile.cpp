@@ -0,0 +1,188 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "HexMappedFile.h"
+#include <Async/ParallelFor.h>
+
+#if PLATFORM_WINDOWS
+#include "Windows/AllowWindowsPlatformTypes.h"
+#include <windows.h>
+#include "Windows/HideWindowsPlatformTypes.h"
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#include <filesystem>
+
+DEFINE_LOG_CATEGORY(HexMappedWriter);
+
+FHexMappedFile::~FHexMappedFile()
+{
+	Abandon();
+}
+
+bool FHexMappedFile::Open(const FString& InFullPath, int64 InSize)
+{
+	Abandon();
+	FullPath = InFullPath;
+	TempPath = InFullPath + TEXT(".tmp");
+	Size = InSize;
+	IsOpen = true;
+
+#if PLATFORM_WINDOWS
+	HANDLE File = CreateFileW(*TempPath, GENERIC_READ | GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+	FileHandle = File == INVALID_HANDLE_VALUE ? nullptr : File;
+	LARGE_INTEGER End;
+	End.QuadPart = Size;
+	bool Sized = FileHandle != nullptr && SetFilePointerEx(File, End, nullptr, FILE_BEGIN) && SetEndOfFile(File);
+	if (Sized && Size > 0) {
+		MappingHandle = CreateFileMappingW(File, nullptr, PAGE_READWRITE, (DWORD)(Size >> 32), (DWORD)Size, nullptr);
+		Data = MappingHandle != nullptr ? (uint8*)MapViewOfFile(MappingHandle, FILE_MAP_WRITE, 0, 0, (SIZE_T)Size) : nullptr;
+	}
+#else
+	FileDescriptor = open(TCHAR_TO_UTF8(*TempPath), O_RDWR | O_CREAT | O_TRUNC, 0644);
+	bool Sized = FileDescriptor >= 0 && ftruncate(FileDescriptor, (off_t)Size) == 0;
+#if PLATFORM_LINUX
+	//Reserve the blocks now, so a full disk fails here instead of faulting a worker in the middle of a write
+	Sized = Sized && (Size == 0 || posix_fallocate(FileDescriptor, 0, (off_t)Size) == 0);
+#endif
+	if (Sized && Size > 0) {
+		void* Mapped = mmap(nullptr, (size_t)Size, PROT_READ | PROT_WRITE, MAP_SHARED, FileDescriptor, 0);
+		Data = Mapped == MAP_FAILED ? nullptr : (uint8*)Mapped;
+	}
+#endif
+
+	if (!Sized || (Size > 0 && Data == nullptr)) {
+		UE_LOG(HexMappedWriter, Warning, TEXT("Map %s with %lld bytes failed!"), *TempPath, Size);
+		Abandon();
+		return false;
+	}
+	return true;
+}
+
+bool FHexMappedFile::Commit()
+{
+	if (!IsOpen) {
+		return false;
+	}
+	if (!Close(true)) {
+		UE_LOG(HexMappedWriter, Warning, TEXT("Flush %s failed!"), *TempPath);
+		Abandon();
+		return false;
+	}
+
+	std::error_code ErrorCode;
+	std::filesystem::rename(std::filesystem::path(*TempPath), std::filesystem::path(*FullPath), ErrorCode);
+	if (ErrorCode) {
+		UE_LOG(HexMappedWriter, Warning, TEXT("Rename %s to %s failed!"), *TempPath, *FullPath);
+		Abandon();
+		return false;
+	}
+	IsOpen = false;
+	return true;
+}
+
+void FHexMappedFile::Abandon()
+{
+	if (!IsOpen) {
+		return;
+	}
+	Close(false);
+	std::error_code ErrorCode;
+	std::filesystem::remove(std::filesystem::path(*TempPath), ErrorCode);
+	IsOpen = false;
+}
+
+int64 FHexMappedFile::GetSectionsBytes(const TArray<TPair<const void*, int64>>& Sections)
+{
+	int64 Bytes = 0;
+	for (const TPair<const void*, int64>& Section : Sections)
+	{
+		Bytes += Section.Value;
+	}
+	return Bytes;
+}
+
+void FHexMappedFile::WriteSections(const TArray<TPair<const void*, int64>>& Sections)
+{
+	check(GetSectionsBytes(Sections) == Size);
+
+	//Cut every section into chunks that know their target offset, small sections become one chunk
+	struct FCopyChunk
+	{
+		const uint8* Source;
+		int64 Offset;
+		int64 Bytes;
+	};
+	TArray<FCopyChunk> Chunks;
+	int64 Offset = 0;
+	for (const TPair<const void*, int64>& Section : Sections)
+	{
+		for (int64 Begin = 0; Begin < Section.Value; Begin += MAPPED_COPY_CHUNK_BYTES)
+		{
+			Chunks.Add({ (const uint8*)Section.Key + Begin, Offset + Begin, FMath::Min<int64>(MAPPED_COPY_CHUNK_BYTES, Section.Value - Begin) });
+		}
+		Offset += Section.Value;
+	}
+	uint8* Target = Data;
+	ParallelFor(Chunks.Num(), [&Chunks, Target](int32 Index) {
+		FMemory::Memcpy(Target + Chunks[Index].Offset, Chunks[Index].Source, Chunks[Index].Bytes);
+	});
+}
+
+bool FHexMappedFile::Close(bool Flush)
+{
+	bool Flushed = true;
+#if PLATFORM_WINDOWS
+	if (Data != nullptr) {
+		Flushed = !Flush || FlushViewOfFile(Data, 0);
+		UnmapViewOfFile(Data);
+	}
+	if (MappingHandle != nullptr) {
+		CloseHandle(MappingHandle);
+	}
+	if (FileHandle != nullptr) {
+		Flushed = Flushed && (!Flush || FlushFileBuffers(FileHandle));
+		CloseHandle(FileHandle);
+	}
+	MappingHandle = nullptr;
+	FileHandle = nullptr;
+#else
+	if (Data != nullptr) {
+		Flushed = !Flush || msync(Data, (size_t)Size, MS_SYNC) == 0;
+		munmap(Data, (size_t)Size);
+	}
+	if (FileDescriptor >= 0) {
+		close(FileDescriptor);
+	}
+	FileDescriptor = -1;
+#endif
+	Data = nullptr;
+	return Flushed;
+}
+
+bool FHexFileReader::Open(const FString& FullPath)
+{
+	std::error_code ErrorCode;
+	Size = (int64)std::filesystem::file_size(std::filesystem::path(*FullPath), ErrorCode);
+	Stream.open(std::filesystem::path(*FullPath), std::ios::in | std::ios::binary);
+	if (ErrorCode || !Stream.is_open()) {
+		Size = 0;
+		Remaining = 0;
+		return false;
+	}
+	Remaining = Size;
+	return true;
+}
+
+bool FHexFileReader::ReadBytes(void* Out_Data, int64 Bytes)
+{
+	if (Bytes < 0 || Bytes > Remaining) {
+		return false;
+	}
+	Stream.read(reinterpret_cast<char*>(Out_Data), (std::streamsize)Bytes);
+	Remaining -= Bytes;
+	return (bool)Stream;
+}
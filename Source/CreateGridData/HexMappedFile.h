@@ -0,0 +1,87 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+#include <fstream>
+
+DECLARE_LOG_CATEGORY_EXTERN(HexMappedWriter, Log, All);
+
+//Bytes copied by one ParallelFor task in WriteSections
+#define MAPPED_COPY_CHUNK_BYTES	(4 << 20)
+
+/**
+ * Output file whose size is known before it is written.
+ * Open creates FullPath.tmp at its final size and maps it shared, workers then write disjoint slices of
+ * GetData() with no buffers or locks. Commit flushes the mapping once and renames the file over FullPath,
+ * so readers see the old file or the complete new one, never a part. A file not committed is removed.
+ */
+class CREATEGRIDDATA_API FHexMappedFile
+{
+public:
+	FHexMappedFile() = default;
+	~FHexMappedFile();
+	FHexMappedFile(const FHexMappedFile&) = delete;
+	FHexMappedFile& operator=(const FHexMappedFile&) = delete;
+
+	bool Open(const FString& InFullPath, int64 InSize);
+	bool Commit();
+	void Abandon();
+
+	uint8* GetData() const { return Data; }
+	int64 GetSize() const { return Size; }
+
+	//Data and byte count of every section, laid out back to back from the start of the file
+	static int64 GetSectionsBytes(const TArray<TPair<const void*, int64>>& Sections);
+	//Copies the sections in chunks with ParallelFor, the file must be opened with GetSectionsBytes
+	void WriteSections(const TArray<TPair<const void*, int64>>& Sections);
+
+private:
+	//Unmaps and closes, flushing first when asked. Returns false when the flush failed
+	bool Close(bool Flush);
+
+	FString FullPath;
+	FString TempPath;
+	uint8* Data = nullptr;
+	int64 Size = 0;
+	bool IsOpen = false;
+#if PLATFORM_WINDOWS
+	void* FileHandle = nullptr;
+	void* MappingHandle = nullptr;
+#else
+	int32 FileDescriptor = -1;
+#endif
+};
+
+/**
+ * Input file read front to back, the counterpart of FHexMappedFile for the binary formats.
+ * Every read is checked against the bytes left in the file, so a damaged count fails the read
+ * and never triggers a huge allocation.
+ */
+class CREATEGRIDDATA_API FHexFileReader
+{
+public:
+	bool Open(const FString& FullPath);
+
+	bool ReadBytes(void* Out_Data, int64 Bytes);
+
+	//Sizes Out_Array to Num elements and fills it from the file
+	template<typename TArrayType>
+	bool ReadArray(TArrayType& Out_Array, int64 Num)
+	{
+		if (Num < 0 || Num > Remaining / (int64)sizeof(Out_Array[0])) {
+			return false;
+		}
+		Out_Array.SetNumUninitialized(Num);
+		return ReadBytes(Out_Array.GetData(), Num * (int64)sizeof(Out_Array[0]));
+	}
+
+	int64 GetSize() const { return Size; }
+	int64 GetRemaining() const { return Remaining; }
+
+private:
+	std::ifstream Stream;
+	int64 Size = 0;
+	int64 Remaining = 0;
+};
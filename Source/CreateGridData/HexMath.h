@@ -0,0 +1,443 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Header only hex math on axial coordinates, shared by the creator and runtime code.
+ * Layout as written by AHexGridCreator: axial Q along 30 degrees, axial R along 90 degrees,
+ * ring r starts at direction 4 scaled by r and walks sides 0..5 with r steps each.
+ */
+namespace HexMath
+{
+	//Axial direction vectors, direction i + 1 is direction i rotated by one step
+	inline constexpr int32 DirectionQ[6] = { 1, 1, 0, -1, -1, 0 };
+	inline constexpr int32 DirectionR[6] = { 0, -1, -1, 0, 1, 1 };
+	inline constexpr int32 RingStartDirection = 4;
+
+	template<typename T>
+	struct TAxial
+	{
+		T Q = 0;
+		T R = 0;
+
+		constexpr TAxial() = default;
+		constexpr TAxial(T InQ, T InR) : Q(InQ), R(InR) {}
+		explicit TAxial(const FIntPoint& Point) : Q((T)Point.X), R((T)Point.Y) {}
+
+		FIntPoint ToIntPoint() const { return FIntPoint((int32)Q, (int32)R); }
+
+		constexpr T S() const { return (T)(-Q - R); }
+		constexpr TAxial operator+(const TAxial& Other) const { return TAxial((T)(Q + Other.Q), (T)(R + Other.R)); }
+		constexpr TAxial operator-(const TAxial& Other) const { return TAxial((T)(Q - Other.Q), (T)(R - Other.R)); }
+		constexpr TAxial operator*(T Factor) const { return TAxial((T)(Q * Factor), (T)(R * Factor)); }
+		constexpr TAxial& operator+=(const TAxial& Other) { Q = (T)(Q + Other.Q); R = (T)(R + Other.R); return *this; }
+		constexpr bool operator==(const TAxial& Other) const { return Q == Other.Q && R == Other.R; }
+		constexpr bool operator!=(const TAxial& Other) const { return !(*this == Other); }
+	};
+
+	template<typename T>
+	struct TCube
+	{
+		T Q = 0;
+		T R = 0;
+		T S = 0;
+
+		constexpr TCube() = default;
+		constexpr TCube(T InQ, T InR, T InS) : Q(InQ), R(InR), S(InS) {}
+		constexpr explicit TCube(const TAxial<T>& Hex) : Q(Hex.Q), R(Hex.R), S(Hex.S()) {}
+
+		constexpr TAxial<T> ToAxial() const { return TAxial<T>(Q, R); }
+	};
+
+	typedef TAxial<int16> FAxial16;
+	typedef TAxial<int32> FAxial;
+	typedef TAxial<int64> FAxial64;
+	typedef TCube<int16> FCube16;
+	typedef TCube<int32> FCube;
+	typedef TCube<int64> FCube64;
+
+	template<typename T>
+	constexpr TAxial<T> Direction(int32 Index)
+	{
+		return TAxial<T>((T)DirectionQ[Index], (T)DirectionR[Index]);
+	}
+
+	template<typename T>
+	constexpr TAxial<T> Neighbor(const TAxial<T>& Hex, int32 Index)
+	{
+		return Hex + Direction<T>(Index);
+	}
+
+	//Index of the direction vector Step, INDEX_NONE when Step is no unit step
+	template<typename T>
+	constexpr int32 DirectionIndex(const TAxial<T>& Step)
+	{
+		for (int32 i = 0; i < 6; i++)
+		{
+			if (Step.Q == DirectionQ[i] && Step.R == DirectionR[i]) {
+				return i;
+			}
+		}
+		return INDEX_NONE;
+	}
+
+	template<typename T>
+	constexpr T Abs(T Value)
+	{
+		return Value < 0 ? (T)-Value : Value;
+	}
+
+	//Distance to the origin
+	template<typename T>
+	constexpr T Length(const TAxial<T>& Hex)
+	{
+		return (T)((Abs(Hex.Q) + Abs(Hex.R) + Abs(Hex.S())) / 2);
+	}
+
+	template<typename T>
+	constexpr T Distance(const TAxial<T>& A, const TAxial<T>& B)
+	{
+		return Length(A - B);
+	}
+
+	//World position of the tile center, axial Q along 30 degrees, axial R along 90 degrees, in units of TileSize
+	template<typename T>
+	FVector2D AxialToPosition(const TAxial<T>& Hex, double TileSize)
+	{
+		return FVector2D(TileSize * 1.5 * Hex.Q, TileSize * FMath::Sqrt(3.0) * (0.5 * Hex.Q + Hex.R));
+	}
+
+	inline FVector2D AxialToPosition(const FIntPoint& Hex, double TileSize)
+	{
+		return AxialToPosition(TAxial<int32>(Hex), TileSize);
+	}
+
+	//Rotates around the origin by Steps direction steps, direction i goes to direction i + Steps
+	template<typename T>
+	constexpr TAxial<T> Rotate(const TAxial<T>& Hex, int32 Steps)
+	{
+		TAxial<T> Result = Hex;
+		for (int32 i = ((Steps % 6) + 6) % 6; i > 0; i--)
+		{
+			Result = TAxial<T>((T)(Result.Q + Result.R), (T)-Result.Q);
+		}
+		return Result;
+	}
+
+	//First hex of ring Radius around Center
+	template<typename T, typename TRadius>
+	constexpr TAxial<T> RingStart(const TAxial<T>& Center, TRadius Radius)
+	{
+		return Center + Direction<T>(RingStartDirection) * (T)Radius;
+	}
+
+	//Tiles of a hexagon grid of radius Range: 1 + 3R(R+1)
+	constexpr int64 GetTileCount(int64 Range)
+	{
+		return Range < 0 ? 0 : 1 + 3 * Range * (Range + 1);
+	}
+
+	//Ring of the tile at spiral index Index
+	inline int64 SpiralIndexToRing(int64 Index)
+	{
+		if (Index <= 0) {
+			return 0;
+		}
+		//Smallest k with 1 + 3k(k+1) > Index, fix up float error of the closed form
+		int64 Ring = (int64)((3.0 + FMath::Sqrt(12.0 * (double)Index - 3.0)) / 6.0);
+		while (GetTileCount(Ring) <= Index) {
+			Ring++;
+		}
+		while (Ring > 1 && GetTileCount(Ring - 1) > Index) {
+			Ring--;
+		}
+		return Ring;
+	}
+
+	template<typename T = int32>
+	TAxial<T> SpiralIndexToAxial(int64 Index)
+	{
+		int64 Ring = SpiralIndexToRing(Index);
+		if (Ring == 0) {
+			return TAxial<T>();
+		}
+
+		int64 Offset = Index - GetTileCount(Ring - 1);
+		int32 Side = (int32)(Offset / Ring);
+		int64 Step = Offset % Ring;
+		TAxial<int64> Hex = RingStart(TAxial<int64>(), Ring);
+		for (int32 i = 0; i < Side; i++)
+		{
+			Hex += Direction<int64>(i) * Ring;
+		}
+		Hex += Direction<int64>(Side) * Step;
+		return TAxial<T>((T)Hex.Q, (T)Hex.R);
+	}
+
+	template<typename T>
+	constexpr int64 AxialToSpiralIndex(const TAxial<T>& Hex)
+	{
+		int64 Q = Hex.Q;
+		int64 R = Hex.R;
+		int64 Ring = Length(TAxial<int64>(Q, R));
+		if (Ring == 0) {
+			return 0;
+		}
+
+		//Side s runs from corner s to corner s + 1, corner 0 is the ring start (-k, k)
+		int32 Side;
+		int64 Step;
+		if (R == Ring && Q < 0) {
+			Side = 0;
+			Step = Q + Ring;
+		}
+		else if (Q + R == Ring && Q >= 0 && R > 0) {
+			Side = 1;
+			Step = Q;
+		}
+		else if (Q == Ring && R <= 0 && R > -Ring) {
+			Side = 2;
+			Step = -R;
+		}
+		else if (R == -Ring && Q > 0) {
+			Side = 3;
+			Step = Ring - Q;
+		}
+		else if (Q + R == -Ring && Q <= 0 && Q > -Ring) {
+			Side = 4;
+			Step = -Q;
+		}
+		else {
+			Side = 5;
+			Step = R;
+		}
+		return GetTileCount(Ring - 1) + Side * Ring + Step;
+	}
+
+	/**
+	 * Walks ring Radius around Center in spiral order.
+	 * for (const HexMath::FAxial& Hex : HexMath::Ring(Center, Radius))
+	 */
+	template<typename T>
+	class TRingIterator
+	{
+	public:
+		constexpr TRingIterator(const TAxial<T>& InHex, T InRadius, int32 InSide)
+			: Hex(InHex), Radius(InRadius), Side(InSide) {}
+
+		constexpr const TAxial<T>& operator*() const { return Hex; }
+		constexpr int32 GetSide() const { return Side; }
+
+		constexpr TRingIterator& operator++()
+		{
+			if (Radius == 0) {
+				Side = 6;
+				return *this;
+			}
+			Hex += Direction<T>(Side);
+			if (++Step == Radius) {
+				Step = 0;
+				Side++;
+			}
+			return *this;
+		}
+
+		constexpr bool operator!=(const TRingIterator& Other) const { return Side != Other.Side || Step != Other.Step; }
+
+	private:
+		TAxial<T> Hex;
+		T Radius = 0;
+		int32 Side = 0;
+		T Step = 0;
+	};
+
+	template<typename T>
+	struct TRingRange
+	{
+		TAxial<T> Center;
+		T Radius = 0;
+
+		constexpr TRingIterator<T> begin() const { return TRingIterator<T>(RingStart(Center, Radius), Radius, 0); }
+		constexpr TRingIterator<T> end() const { return TRingIterator<T>(RingStart(Center, Radius), Radius, 6); }
+	};
+
+	template<typename T, typename TRadius>
+	constexpr TRingRange<T> Ring(const TAxial<T>& Center, TRadius Radius)
+	{
+		return TRingRange<T>{ Center, (T)Radius };
+	}
+
+	/**
+	 * Walks the spiral around Center: the center, then rings 1, 2, ... in ring order.
+	 * Without an end the iterator runs forever, which suits producers that stop at a tile count.
+	 */
+	template<typename T>
+	class TSpiralIterator
+	{
+	public:
+		constexpr TSpiralIterator() = default;
+		//Starts at spiral index InIndex, positioned like SpiralIndexToAxial so it can walk on from there
+		explicit TSpiralIterator(const TAxial<T>& InCenter, int64 InIndex = 0)
+			: Center(InCenter), Hex(InCenter), Index(InIndex)
+		{
+			int64 Ring = SpiralIndexToRing(InIndex);
+			if (Ring == 0) {
+				return;
+			}
+			int64 Offset = InIndex - GetTileCount(Ring - 1);
+			RingIndex = (T)Ring;
+			Side = (int32)(Offset / Ring);
+			Step = (T)(Offset % Ring);
+			Hex = Center + SpiralIndexToAxial<T>(InIndex);
+		}
+
+		constexpr const TAxial<T>& operator*() const { return Hex; }
+		constexpr int64 GetIndex() const { return Index; }
+		constexpr T GetRing() const { return RingIndex; }
+
+		constexpr TSpiralIterator& operator++()
+		{
+			Index++;
+			if (RingIndex == 0 || (Side == 5 && Step == RingIndex - 1)) {
+				RingIndex++;
+				Side = 0;
+				Step = 0;
+				Hex = RingStart(Center, RingIndex);
+				return *this;
+			}
+			Hex += Direction<T>(Side);
+			if (++Step == RingIndex) {
+				Step = 0;
+				Side++;
+			}
+			return *this;
+		}
+
+		constexpr bool operator!=(const TSpiralIterator& Other) const { return Index != Other.Index; }
+
+	private:
+		TAxial<T> Center;
+		TAxial<T> Hex;
+		int64 Index = 0;
+		T RingIndex = 0;
+		int32 Side = 0;
+		T Step = 0;
+	};
+
+	template<typename T>
+	struct TSpiralRange
+	{
+		TAxial<T> Center;
+		T Range = 0;
+
+		TSpiralIterator<T> begin() const { return TSpiralIterator<T>(Center); }
+		TSpiralIterator<T> end() const { return TSpiralIterator<T>(Center, GetTileCount(Range)); }
+	};
+
+	template<typename T, typename TRange>
+	constexpr TSpiralRange<T> Spiral(const TAxial<T>& Center, TRange Range)
+	{
+		return TSpiralRange<T>{ Center, (T)Range };
+	}
+
+	/**
+	 * Corner i of a hex is shared with the neighbors in directions i and i + 1, edge i with the neighbor
+	 * in direction i, so edge i runs from corner i - 1 to corner i. Every corner is owned by one of its
+	 * three hexes as corner 0 or 1 and every edge by one of its two hexes as edge 0, 1 or 2, which makes
+	 * (Owner, Type) an integer key that all hexes around the corner or edge agree on.
+	 */
+	inline constexpr int32 CornerOwnerDirection[6] = { -1, -1, 3, 4, 4, 5 };
+	inline constexpr int32 CornerOwnerType[6] = { 0, 1, 0, 1, 0, 1 };
+	//The other end of the three edges at a corner of type 0 or 1, as owner direction from the corner owner
+	inline constexpr int32 CornerNeighborDirection[2][3] = { { 5, -1, 0 }, { -1, 3, 2 } };
+	//The hexes on either side of the edge to corner neighbor i, as CornerHex indices
+	inline constexpr int32 CornerNeighborHexes[3][2] = { { 0, 1 }, { 0, 2 }, { 1, 2 } };
+
+	template<typename T>
+	struct TFeatureKey
+	{
+		TAxial<T> Owner;
+		int32 Type = 0;
+
+		constexpr bool operator==(const TFeatureKey& Other) const { return Owner == Other.Owner && Type == Other.Type; }
+		constexpr bool operator!=(const TFeatureKey& Other) const { return !(*this == Other); }
+	};
+
+	template<typename T>
+	constexpr TFeatureKey<T> CornerKey(const TAxial<T>& Hex, int32 Corner)
+	{
+		int32 OwnerDirection = CornerOwnerDirection[Corner];
+		return TFeatureKey<T>{ OwnerDirection < 0 ? Hex : Neighbor(Hex, OwnerDirection), CornerOwnerType[Corner] };
+	}
+
+	template<typename T>
+	constexpr TFeatureKey<T> EdgeKey(const TAxial<T>& Hex, int32 Edge)
+	{
+		return Edge < 3 ? TFeatureKey<T>{ Hex, Edge } : TFeatureKey<T>{ Neighbor(Hex, Edge), Edge - 3 };
+	}
+
+	//Hex 0 is the owner, hex 1 the neighbor across the edge
+	template<typename T>
+	constexpr TAxial<T> EdgeHex(const TFeatureKey<T>& Edge, int32 Side)
+	{
+		return Side == 0 ? Edge.Owner : Neighbor(Edge.Owner, Edge.Type);
+	}
+
+	//Hex 0 is the owner, hexes 1 and 2 follow in corner order
+	template<typename T>
+	constexpr TAxial<T> CornerHex(const TFeatureKey<T>& Corner, int32 Index)
+	{
+		return Index == 0 ? Corner.Owner : Neighbor(Corner.Owner, Corner.Type + Index - 1);
+	}
+
+	template<typename T>
+	constexpr TFeatureKey<T> EdgeCorner(const TFeatureKey<T>& Edge, int32 End)
+	{
+		return CornerKey(Edge.Owner, End == 0 ? (Edge.Type + 5) % 6 : Edge.Type);
+	}
+
+	//Corners one edge away, the joining edge lies between the two hexes the corners share
+	template<typename T>
+	constexpr TFeatureKey<T> CornerNeighbor(const TFeatureKey<T>& Corner, int32 Index)
+	{
+		int32 OwnerDirection = CornerNeighborDirection[Corner.Type][Index];
+		return TFeatureKey<T>{ OwnerDirection < 0 ? Corner.Owner : Neighbor(Corner.Owner, OwnerDirection), 1 - Corner.Type };
+	}
+
+	template<typename T>
+	TAxial<T> CubeRound(double Q, double R, double S)
+	{
+		double RoundQ = FMath::RoundHalfFromZero(Q);
+		double RoundR = FMath::RoundHalfFromZero(R);
+		double RoundS = FMath::RoundHalfFromZero(S);
+		double DiffQ = FMath::Abs(RoundQ - Q);
+		double DiffR = FMath::Abs(RoundR - R);
+		double DiffS = FMath::Abs(RoundS - S);
+		if (DiffQ > DiffR && DiffQ > DiffS) {
+			RoundQ = -RoundR - RoundS;
+		}
+		else if (DiffR > DiffS) {
+			RoundR = -RoundQ - RoundS;
+		}
+		return TAxial<T>((T)RoundQ, (T)RoundR);
+	}
+
+	//Hexes on the line from A to B, both included, Distance(A, B) + 1 in total
+	template<typename T>
+	void Line(const TAxial<T>& A, const TAxial<T>& B, TArray<TAxial<T>>& Out_Hexes)
+	{
+		T Count = Distance(A, B);
+		Out_Hexes.Reset(Count + 1);
+		//Nudge both ends off the hex edges and corners, by a different amount per axis so a tie between two
+		//axes breaks the same way wherever the line starts and the line stays translation invariant
+		const double AQ = A.Q + 1e-6, AR = A.R + 2e-6, AS = A.S() - 3e-6;
+		const double BQ = B.Q + 1e-6, BR = B.R + 2e-6, BS = B.S() - 3e-6;
+		for (T i = 0; i <= Count; i++)
+		{
+			double Alpha = Count == 0 ? 0.0 : (double)i / (double)Count;
+			Out_Hexes.Add(CubeRound<T>(AQ + (BQ - AQ) * Alpha, AR + (BR - AR) * Alpha, AS + (BS - AS) * Alpha));
+		}
+	}
+}
@@ -0,0 +1,123 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "HexTileSet.h"
+#include "GridHpaUtility.h"
+
+void FHexTileSet::Init(int64 InTileCount)
+{
+	TileCount = InTileCount;
+	Words.Init(0, (InTileCount + 63) / 64);
+}
+
+void FHexTileSet::Reset()
+{
+	FMemory::Memzero(Words.GetData(), Words.Num() * sizeof(uint64));
+}
+
+int64 FHexTileSet::Num() const
+{
+	int64 Count = 0;
+	for (int64 i = 0; i < Words.Num(); i++)
+	{
+		Count += FMath::CountBits(Words[i]);
+	}
+	return Count;
+}
+
+bool FHexTileSet::IsEmpty() const
+{
+	uint64 Any = 0;
+	for (int64 i = 0; i < Words.Num(); i++)
+	{
+		Any |= Words[i];
+	}
+	return Any == 0;
+}
+
+int64 FHexTileSet::CountIntersection(const FHexTileSet& Other) const
+{
+	check(TileCount == Other.TileCount);
+	int64 Count = 0;
+	for (int64 i = 0; i < Words.Num(); i++)
+	{
+		Count += FMath::CountBits(Words[i] & Other.Words[i]);
+	}
+	return Count;
+}
+
+FHexTileSet& FHexTileSet::operator|=(const FHexTileSet& Other)
+{
+	check(TileCount == Other.TileCount);
+	uint64* RESTRICT Dst = Words.GetData();
+	const uint64* RESTRICT Src = Other.Words.GetData();
+	for (int64 i = 0; i < Words.Num(); i++)
+	{
+		Dst[i] |= Src[i];
+	}
+	return *this;
+}
+
+FHexTileSet& FHexTileSet::operator&=(const FHexTileSet& Other)
+{
+	check(TileCount == Other.TileCount);
+	uint64* RESTRICT Dst = Words.GetData();
+	const uint64* RESTRICT Src = Other.Words.GetData();
+	for (int64 i = 0; i < Words.Num(); i++)
+	{
+		Dst[i] &= Src[i];
+	}
+	return *this;
+}
+
+FHexTileSet& FHexTileSet::operator-=(const FHexTileSet& Other)
+{
+	check(TileCount == Other.TileCount);
+	uint64* RESTRICT Dst = Words.GetData();
+	const uint64* RESTRICT Src = Other.Words.GetData();
+	for (int64 i = 0; i < Words.Num(); i++)
+	{
+		Dst[i] &= ~Src[i];
+	}
+	return *this;
+}
+
+bool FHexTileSet::operator==(const FHexTileSet& Other) const
+{
+	//Same tile count means the same word count, and the bits past it are zero in both
+	return TileCount == Other.TileCount && FMemory::Memcmp(Words.GetData(), Other.Words.GetData(), Words.Num() * sizeof(uint64)) == 0;
+}
+
+void FHexTileSet::ToArray(TArray<uint32>& Out_Tiles) const
+{
+	Out_Tiles.Reset(Num());
+	ForEach([&Out_Tiles](uint32 Tile) {
+		Out_Tiles.Add(Tile);
+	});
+}
+
+void FHexTileSet::SetRange(const FStructHexTileGraph& Graph, uint32 Center, int32 Radius)
+{
+	check(TileCount == Graph.GetTileCount() && Center < TileCount);
+	Reset();
+	TArray<uint32, TInlineAllocator<64>> Frontier;
+	TArray<uint32, TInlineAllocator<64>> Next;
+	Frontier.Add(Center);
+	Add(Center);
+	for (int32 Step = 0; Step < Radius && Frontier.Num() > 0; Step++)
+	{
+		Next.Reset();
+		for (uint32 Tile : Frontier)
+		{
+			for (int64 i = Graph.Neighbors.Offsets[Tile]; i < Graph.Neighbors.Offsets[Tile + 1]; i++)
+			{
+				uint32 Neighbor = Graph.Neighbors.Ids[i];
+				if (!Contains(Neighbor)) {
+					Add(Neighbor);
+					Next.Add(Neighbor);
+				}
+			}
+		}
+		Swap(Frontier, Next);
+	}
+}
@@ -0,0 +1,81 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+struct FStructHexTileGraph;
+
+/**
+ * Set of tiles of one grid as a dense bitset over tile indices, bit i of word i / 64 is tile i.
+ * Sets of the same grid combine word by word with no hashing. The word loops have no branches,
+ * so the compiler turns them into SIMD code, and the popcount runs on the hardware instruction.
+ * Bits past the tile count are always zero, so counts and comparisons can take whole words.
+ */
+class CREATEGRIDDATA_API FHexTileSet
+{
+public:
+	FHexTileSet() = default;
+	explicit FHexTileSet(int64 InTileCount) { Init(InTileCount); }
+
+	//Empty set of a grid of InTileCount tiles
+	void Init(int64 InTileCount);
+	//Removes every tile and keeps the tile count
+	void Reset();
+
+	int64 GetTileCount() const { return TileCount; }
+	//Tile must be below the tile count, the words past it are not allocated and Num relies on the padding bits staying clear
+	bool Contains(uint32 Tile) const
+	{
+		check(Tile < TileCount);
+		return (Words[Tile >> 6] >> (Tile & 63)) & 1;
+	}
+	void Add(uint32 Tile)
+	{
+		check(Tile < TileCount);
+		Words[Tile >> 6] |= (uint64)1 << (Tile & 63);
+	}
+	void Remove(uint32 Tile)
+	{
+		check(Tile < TileCount);
+		Words[Tile >> 6] &= ~((uint64)1 << (Tile & 63));
+	}
+
+	int64 Num() const;
+	bool IsEmpty() const;
+	//Num of the intersection, without building it
+	int64 CountIntersection(const FHexTileSet& Other) const;
+
+	//Both sets must be of the same grid
+	FHexTileSet& operator|=(const FHexTileSet& Other);
+	FHexTileSet& operator&=(const FHexTileSet& Other);
+	FHexTileSet& operator-=(const FHexTileSet& Other);
+	bool operator==(const FHexTileSet& Other) const;
+	bool operator!=(const FHexTileSet& Other) const { return !(*this == Other); }
+
+	//Calls Func with every tile of the set in ascending order, skipping empty words
+	template<typename FuncType>
+	void ForEach(FuncType&& Func) const
+	{
+		for (int64 i = 0; i < Words.Num(); i++)
+		{
+			uint64 Word = Words[i];
+			while (Word != 0) {
+				Func((uint32)(i * 64 + FMath::CountTrailingZeros64(Word)));
+				Word &= Word - 1;
+			}
+		}
+	}
+	void ToArray(TArray<uint32>& Out_Tiles) const;
+
+	//Replaces the set with the tiles within Radius steps of Center over the ring 1 adjacency of the graph.
+	//Without blocked tiles that is the hexagon of Radius clipped to the grid, with them the movement range.
+	//Every ring is one step of a breadth first search, the set itself marks the tiles already reached
+	void SetRange(const FStructHexTileGraph& Graph, uint32 Center, int32 Radius);
+
+	const TArray64<uint64>& GetWords() const { return Words; }
+
+private:
+	int64 TileCount = 0;
+	TArray64<uint64> Words;
+};
@@ -31,26 +31,164 @@ struct FStructHexTileData
 };
 
 USTRUCT(BlueprintType)
-struct FStructLoopData
+struct FStructHexGridVariant
 {
 	GENERATED_BODY()
 
-	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite)
-		int32 LoopCountLimit = 3000;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, meta = (ClampMin = "0.0"))
+		float TileSize = 500.0;
 
-	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite)
-		float Rate = 0.01f;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, meta = (ClampMin = "1"))
+		int32 GridRange = 10;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, meta = (ClampMin = "1"))
+		int32 NeighborRange = 5;
+
+	//Relative to the project directory, file names come from the path params. Empty uses the path params as they are.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+		FString DataDirectory;
+};
+
+USTRUCT(BlueprintType)
+struct FStructHexGridBenchmarkRates
+{
+	GENERATED_BODY()
+
+	//Wall clock rates of a sliced run, so they already include the frame budget of the loops
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, meta = (ClampMin = "1.0"))
+		float CenterTilesPerSecond = 200000.0f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, meta = (ClampMin = "1.0"))
+		float NeighborEntriesPerSecond = 2000000.0f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, meta = (ClampMin = "1.0"))
+		float WriteBytesPerSecond = 4000000.0f;
+};
+
+USTRUCT(BlueprintType)
+struct FStructHexGridPipelineSettings
+{
+	GENERATED_BODY()
+
+	//Tiles per batch handed from the producer to the format workers
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, meta = (ClampMin = "64"))
+		int32 BatchTiles = 16384;
+
+	//Batches produced but not yet written, bounds the memory of the queues
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, meta = (ClampMin = "1"))
+		int32 MaxBatchesInFlight = 32;
+
+	//0 uses the worker thread count of the platform
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, meta = (ClampMin = "0"))
+		int32 FormatThreads = 0;
+
+	//Every output file is owned by one writer thread
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, meta = (ClampMin = "1"))
+		int32 WriterThreads = 2;
+};
+
+//fBm of simplex noise over tile positions, one float per tile in the attributes file, see GridNoiseUtility
+USTRUCT(BlueprintType)
+struct FStructHexNoiseChannel
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+		FName Name = FName(TEXT("Elevation"));
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+		int32 Seed = 1;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, meta = (ClampMin = "1", ClampMax = "16"))
+		int32 Octaves = 5;
+
+	//Cycles per world unit of the first octave
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, meta = (ClampMin = "0.0"))
+		float Frequency = 0.0002f;
+
+	//Frequency factor from one octave to the next
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, meta = (ClampMin = "1.0"))
+		float Lacunarity = 2.0f;
+
+	//Amplitude factor from one octave to the next
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, meta = (ClampMin = "0.0", ClampMax = "1.0"))
+		float Gain = 0.5f;
+};
+
+USTRUCT(BlueprintType)
+struct FStructHexFlowFieldSources
+{
+	GENERATED_BODY()
+
+	//Names the output file, FlowField_<Name>.bin
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+		FName Name = FName(TEXT("Base"));
+
+	//Axial coords of the tiles the field leads to, coords that are no tile of a variant are skipped
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+		TArray<FIntPoint> Sources;
+};
+
+//Named slice of the payload of UHexGridDataAsset, laid out like the .bin file of the same name
+USTRUCT(BlueprintType)
+struct FStructHexGridBulkSection
+{
+	GENERATED_BODY()
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+		FName Name;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+		int64 Offset = 0;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+		int64 Bytes = 0;
+};
+
+USTRUCT(BlueprintType)
+struct FStructHexGridEstimate
+{
+	GENERATED_BODY()
+
+	UPROPERTY(BlueprintReadOnly)
+		int64 TileCount = 0;
+
+	UPROPERTY(BlueprintReadOnly)
+		int64 NeighborEntryCount = 0;
+
+	UPROPERTY(BlueprintReadOnly)
+		int64 PeakMemoryBytes = 0;
+
+	//Relative output path to its expected size
+	UPROPERTY(BlueprintReadOnly)
+		TMap<FString, int64> OutputBytes;
+
+	UPROPERTY(BlueprintReadOnly)
+		int64 TotalOutputBytes = 0;
+
+	UPROPERTY(BlueprintReadOnly)
+		float EstimatedSeconds = 0.0f;
+};
+
+USTRUCT(BlueprintType)
+struct FStructLoopData
+{
+	GENERATED_BODY()
+
+	//Milliseconds a loop may run per frame before it yields to the next tick
+	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite, meta = (ClampMin = "0.1"))
+		float FrameBudgetMs = 8.0f;
 
 	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite, meta = (ClampMin = "1"))
 		int32 LoopDepthLimit = 4;
 
 	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite)
-		TArray<int32> IndexSaved = {};
+		TArray<int64> IndexSaved = {};
 
 	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite)
 		bool IsInitialized = false;
 
 	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite, meta = (ClampMin = "0"))
-		int32 Count = 0;
+		int64 Count = 0;
 
 };